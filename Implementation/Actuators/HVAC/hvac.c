@@ -7,9 +7,18 @@
 #include "json-senml.h"
 #include "coap-observe-client.h"
 
+#ifdef WATERMARK
+#include "watermark.h"
+#endif
+
+#ifdef BENCH
+#include "bench.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #define LOG_MODULE "App"
 #define LOG_LEVEL LOG_LEVEL_APP
@@ -21,6 +30,14 @@
 // Discovery resource exposed by the CoAP server
 #define DISCOVERY_RESOURCE "/discovery"
 
+// Room where the node is deployed (set with make ROOM=<id>)
+#ifndef ROOM_ID
+#define ROOM_ID 0
+#endif
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+#define ROOM_ID_STR STRINGIFY(ROOM_ID)
+
 // Resource exposed by the TemperatureAndHumidity sensor
 #define TEMPERATUREANDHUMIDITY_RESOURCE "temperatureandhumidity"
 // Resource exposed by the CO sensor
@@ -42,45 +59,260 @@ static coap_endpoint_t coap_server;
 static coap_message_t request[1];       
 static int retry_requests = MAX_REQUESTS;
 
-// Observe the temperatureandhumidity resource 
-static coap_observee_t *temperatureandhumidity_resource;
-// Observe the co resource
-static coap_observee_t *co_resource;
-
+// Maximum number of sensors of each type observed in the room
+#define MAX_ROOM_SENSORS 4
+
+// A sensor which does not report for this interval is considered stale
+// and its values are no longer used (the sensors sample every 11-12s)
+#define SENSOR_STALE_TIMEOUT 40*CLOCK_SECOND
+// Interval between two checks of the health of the sensors
+#define SENSOR_HEALTH_CHECK_INTERVAL 10*CLOCK_SECOND
+static struct etimer health_timer;
+
+// Interval between two discoveries of the sensors of the room: the sensors
+// registered after the HVAC are observed, the failed and stale ones observed again
+#define SENSOR_DISCOVERY_INTERVAL 60*CLOCK_SECOND
+// The sensors are expected to go quiet while the room sleeps: a stale sensor
+// is observed again after a backoff, doubled at every attempt up to this one
+#define SENSOR_STALE_MAX_BACKOFF 8*SENSOR_DISCOVERY_INTERVAL
+static struct etimer discovery_timer;
+// The sensors are discovered again at the next health check
+static bool rediscover = true;
+// Healthy sensors of the room at the last health check
+static int num_healthy_sensors = 0;
+
+// Aggregation of the values reported by the sensors of the room
+#define AGGREGATION_MEAN 0
+#define AGGREGATION_MAX 1
+#define AGGREGATION_MEDIAN 2
+
+#ifndef TEMPERATURE_AGGREGATION
+#define TEMPERATURE_AGGREGATION AGGREGATION_MEDIAN
+#endif
+#ifndef HUMIDITY_AGGREGATION
+#define HUMIDITY_AGGREGATION AGGREGATION_MEDIAN
+#endif
+#ifndef CO_AGGREGATION
+#define CO_AGGREGATION AGGREGATION_MAX
+#endif
+
+// Aggregate of a value over the healthy sensors of the room. The values
+// are kept sorted, so that a notification updates the aggregate without
+// scanning all the sensors of the room.
+typedef struct {
+  int aggregation;
+  double sorted[MAX_ROOM_SENSORS];
+  int count;
+  double sum;
+} room_aggregate_t;
+
+static room_aggregate_t co_aggregate = { .aggregation = CO_AGGREGATION };
+static room_aggregate_t temperature_aggregate = { .aggregation = TEMPERATURE_AGGREGATION };
+static room_aggregate_t humidity_aggregate = { .aggregation = HUMIDITY_AGGREGATION };
+
+// Aggregates fed by each type of sensor, in the order of room_sensor_t.values
+static room_aggregate_t *co_aggregates[] = { &co_aggregate };
+static room_aggregate_t *temperatureandhumidity_aggregates[] = { &temperature_aggregate, &humidity_aggregate };
+
+// Health of a sensor of the room
+typedef enum {
+  SENSOR_UNKNOWN,   // No value reported yet
+  SENSOR_OK,        // Values are used by the aggregates
+  SENSOR_STALE,     // No value reported for SENSOR_STALE_TIMEOUT
+  SENSOR_FAILED     // Observation refused or lost
+} sensor_health_t;
+
+// Sensor of the room observed by the HVAC
+typedef struct {
+  char ip[40];
+  coap_endpoint_t endpoint;
+  coap_observee_t *observee;
+  // Aggregates fed by the sensor
+  room_aggregate_t **aggregates;
+  int num_values;
+  // Last values reported by the sensor
+  double values[2];
+  // Time of the last report
+  clock_time_t last_update;
+  sensor_health_t health;
+  // A value has been reported since the last prediction
+  bool received;
+  // Time of the last observe request and wait before observing again the sensor when stale
+  clock_time_t observed;
+  clock_time_t backoff;
+} room_sensor_t;
+
+// CO sensors of the room
+static room_sensor_t co_sensors[MAX_ROOM_SENSORS];
+static int num_co_sensors = 0;
+// TemperatureAndHumidity sensors of the room
+static room_sensor_t temperatureandhumidity_sensors[MAX_ROOM_SENSORS];
+static int num_temperatureandhumidity_sensors = 0;
+
+// Room values used by the prediction
 double current_temperature = -1.0;
 double current_humidity = -1.0;
 double current_co = -1.0;
 
-static bool temperature_received = false;
-static bool humidity_received = false;
-static bool co_received = false;
-
 // Used to prevent stalls when one 
 // sensor is in sleep mode while the 
-// other sensor continues sending data, 
-// even though it should also be in sleep mode.
+// other sensors continue sending data, 
+// even though they should also be in sleep mode.
 #define MAX_DETECTOR_SENSOR_OFF 3
 static int detector_sensor_off = 0;
 
 PROCESS(hvac_process, "HVAC process");
 AUTOSTART_PROCESSES(&hvac_process);
 
-// Callback for the CO sensor
+// Insert a value in the aggregate, keeping the values sorted
+static void aggregate_insert(room_aggregate_t *aggregate, double value)
+{
+  int i = aggregate->count;
+
+  while(i > 0 && aggregate->sorted[i - 1] > value){
+    aggregate->sorted[i] = aggregate->sorted[i - 1];
+    i--;
+  }
+  aggregate->sorted[i] = value;
+  aggregate->count++;
+  aggregate->sum += value;
+}
+
+// Remove a value previously inserted in the aggregate
+static void aggregate_remove(room_aggregate_t *aggregate, double value)
+{
+  int i = 0;
+
+  while(i < aggregate->count && aggregate->sorted[i] != value){
+    i++;
+  }
+  if(i == aggregate->count){
+    return;
+  }
+  for(; i < aggregate->count - 1; i++){
+    aggregate->sorted[i] = aggregate->sorted[i + 1];
+  }
+  aggregate->count--;
+  // Avoid accumulating rounding errors when the room is empty
+  aggregate->sum = aggregate->count > 0 ? aggregate->sum - value : 0;
+}
+
+// Current value of the aggregate, -1 if no sensor is healthy
+static double aggregate_value(const room_aggregate_t *aggregate)
+{
+  int middle = aggregate->count / 2;
+
+  if(aggregate->count == 0){
+    return -1.0;
+  }
+
+  switch(aggregate->aggregation){
+    case AGGREGATION_MAX:
+      return aggregate->sorted[aggregate->count - 1];
+    case AGGREGATION_MEDIAN:
+      if(aggregate->count % 2 == 1){
+        return aggregate->sorted[middle];
+      }
+      return (aggregate->sorted[middle - 1] + aggregate->sorted[middle]) / 2;
+    default:
+      return aggregate->sum / aggregate->count;
+  }
+}
+
+// Store the new values of a sensor and update the aggregates of the room
+static void sensor_update(room_sensor_t *sensor, const double *values)
+{
+  for(int i = 0; i < sensor->num_values; i++){
+    if(sensor->health == SENSOR_OK){
+      aggregate_remove(sensor->aggregates[i], sensor->values[i]);
+    }
+    sensor->values[i] = values[i];
+    aggregate_insert(sensor->aggregates[i], values[i]);
+  }
+
+  sensor->health = SENSOR_OK;
+  sensor->last_update = clock_time();
+  sensor->received = true;
+  sensor->backoff = SENSOR_DISCOVERY_INTERVAL;
+}
+
+// Change the health of a sensor, removing its values from the aggregates
+// of the room if it is no longer healthy
+static void sensor_set_health(room_sensor_t *sensor, sensor_health_t health)
+{
+  if(sensor->health == SENSOR_OK && health != SENSOR_OK){
+    for(int i = 0; i < sensor->num_values; i++){
+      aggregate_remove(sensor->aggregates[i], sensor->values[i]);
+    }
+    sensor->received = false;
+  }
+  sensor->health = health;
+}
+
+// Mark as stale the healthy sensors which did not report recently
+static void check_sensors_health(room_sensor_t *sensors, int num_sensors)
+{
+  for(int i = 0; i < num_sensors; i++){
+    if(sensors[i].health == SENSOR_OK && clock_time() - sensors[i].last_update > SENSOR_STALE_TIMEOUT){
+      LOG_INFO("[HVAC] Sensor %s is stale\n", sensors[i].ip);
+      sensor_set_health(&sensors[i], SENSOR_STALE);
+    }
+  }
+}
+
+// True if every healthy sensor of the table reported since the last prediction
+static bool all_sensors_received(room_sensor_t *sensors, int num_sensors)
+{
+  for(int i = 0; i < num_sensors; i++){
+    if(sensors[i].health == SENSOR_OK && !sensors[i].received){
+      return false;
+    }
+  }
+  return true;
+}
+
+// Trigger a new prediction with the aggregated values of the room
+// when all the healthy sensors of the room reported a new value
+static void update_room(void)
+{
+  int num_sensors = num_co_sensors + num_temperatureandhumidity_sensors;
+
+  // The model needs a real value of every quantity: wait until a sensor
+  // of each type is healthy, keeping the values received meanwhile
+  if(co_aggregate.count == 0 || temperature_aggregate.count == 0 || humidity_aggregate.count == 0){
+    LOG_DBG("[HVAC] No healthy sensor of some type, prediction postponed\n");
+    return;
+  }
+
+  if((all_sensors_received(co_sensors, num_co_sensors) && all_sensors_received(temperatureandhumidity_sensors, num_temperatureandhumidity_sensors))
+     || (detector_sensor_off >= MAX_DETECTOR_SENSOR_OFF * num_sensors)){
+
+    current_co = aggregate_value(&co_aggregate);
+    current_temperature = aggregate_value(&temperature_aggregate);
+    current_humidity = aggregate_value(&humidity_aggregate);
+
+    res_hvac.trigger();
+
+    for(int i = 0; i < num_co_sensors; i++){
+      co_sensors[i].received = false;
+    }
+    for(int i = 0; i < num_temperatureandhumidity_sensors; i++){
+      temperatureandhumidity_sensors[i].received = false;
+    }
+    detector_sensor_off = 0;
+  }
+  else{
+    detector_sensor_off++;
+  }
+}
+
+// Callback for the CO sensors
 static void co_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
 {
-  static senml_payload_t payload;
-  
-  static senml_measurement_t measurements[1];
-  payload.measurements = measurements;
-  payload.num_measurements = 1;
+  senml_payload_t *payload;
+  double value;
 
-  static char base_name[MAX_STRING_LEN];
-  static char name[1][MAX_STRING_LEN];
-  static char unit[1][MAX_STRING_LEN];
-  
-  payload.base_name = base_name;
-  payload.measurements[0].name = name[0];
-  payload.measurements[0].unit = unit[0];
+  room_sensor_t *sensor = (room_sensor_t *)obs->data;
 
   const uint8_t *buffer = NULL;
 
@@ -92,41 +324,49 @@ static void co_callback(coap_observee_t *obs, void *notification, coap_notificat
   switch (flag) {
     case NOTIFICATION_OK:
 
-      LOG_DBG("[HVAC] Notification received from CO sensor: %s\n", buffer);
-      LOG_DBG("[HVAC] In co_callback payload.num_measurements is: %d\n", payload.num_measurements);
+      LOG_DBG("[HVAC] Notification received from CO sensor %s: %s\n", sensor->ip, buffer);
+      payload = senml_scratch_acquire(1);
+      if(payload == NULL){
+        LOG_ERR("[HVAC] SenML scratch arena in use.\n");
+        return;
+      }
 
-      if(parse_senml_payload((char*)buffer, buffer_size, &payload) == -1){
+      LOG_DBG("[HVAC] In co_callback payload->num_measurements is: %d\n", payload->num_measurements);
+
+      if(parse_senml_payload((char*)buffer, buffer_size, payload) == -1){
         LOG_ERR("[HVAC] ERROR in parsing the payload.\n");
+        senml_scratch_release();
         return;
       }
+#ifdef BENCH
+      bench_stage("parse");
+#endif
 
-      current_co = payload.measurements[0].value.v;
-      co_received = true;
+      value = payload->measurements[0].value.v;
+      // Released before update_room(), which builds the notification of the HVAC
+      senml_scratch_release();
 
-      if((co_received && temperature_received && humidity_received) || (detector_sensor_off >= MAX_DETECTOR_SENSOR_OFF)){
-        res_hvac.trigger();
-        co_received = temperature_received = humidity_received = false;
-        detector_sensor_off = 0;
-      }
-      else{
-        detector_sensor_off++;
-      }
+      sensor_update(sensor, &value);
+
+      update_room();
 
       break;        
 
     case OBSERVE_OK: /* server accepeted observation request */
-      LOG_INFO("[HVAC] OBSERVE_OK from CO sensor\n");
+      LOG_INFO("[HVAC] OBSERVE_OK from CO sensor %s\n", sensor->ip);
       break;
     
     case ERROR_RESPONSE_CODE:
       printf("[HVAC] ERROR_RESPONSE_CODE from CO sensor: %*s\n", buffer_size, (char *)buffer);
-      obs = NULL;
+      sensor->observee = NULL;
+      sensor_set_health(sensor, SENSOR_FAILED);
       break;
     case NO_REPLY_FROM_SERVER:
       printf("[HVAC] NO_REPLY_FROM_SERVER from CO sensor: "
             "removing observe registration with token %x%x\n",
             obs->token[0], obs->token[1]);
-      obs = NULL;
+      sensor->observee = NULL;
+      sensor_set_health(sensor, SENSOR_FAILED);
       break;
 
     default: 
@@ -137,25 +377,12 @@ static void co_callback(coap_observee_t *obs, void *notification, coap_notificat
 
 }
 
-// Callback for the TemperatureAndHumidity sensor
+// Callback for the TemperatureAndHumidity sensors
 static void temperatureandhumidity_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
 {
-  static senml_payload_t payload;
-  static senml_measurement_t measurements[2];
-  payload.measurements = measurements;
-  payload.num_measurements = 2;
-
-  static char base_name[MAX_STRING_LEN];
-  static char name[2][MAX_STRING_LEN];
-  static char unit[2][MAX_STRING_LEN];
-  
-  payload.base_name = base_name;
-  payload.measurements[0].name = name[0];
-  payload.measurements[0].unit = unit[0];
-
-  payload.measurements[1].name = name[1];
-  payload.measurements[1].unit = unit[1];
+  senml_payload_t *payload;
 
+  room_sensor_t *sensor = (room_sensor_t *)obs->data;
  
   const uint8_t *buffer = NULL;
 
@@ -167,51 +394,59 @@ static void temperatureandhumidity_callback(coap_observee_t *obs, void *notifica
   switch (flag) {
     case NOTIFICATION_OK:
 
-      LOG_DBG("[HVAC] Notification received from TemperatureAndHumidity sensor: %s\n", buffer);
+      LOG_DBG("[HVAC] Notification received from TemperatureAndHumidity sensor %s: %s\n", sensor->ip, buffer);
 
-      LOG_DBG("[HVAC] In temperatureandhumidity_callback payload.num_measurements is: %d\n", payload.num_measurements);
+      payload = senml_scratch_acquire(2);
+      if(payload == NULL){
+        LOG_ERR("[HVAC] SenML scratch arena in use.\n");
+        return;
+      }
+
+      LOG_DBG("[HVAC] In temperatureandhumidity_callback payload->num_measurements is: %d\n", payload->num_measurements);
       
-      if(parse_senml_payload((char*)buffer, buffer_size, &payload) == -1){
+      if(parse_senml_payload((char*)buffer, buffer_size, payload) == -1){
         LOG_ERR("[HVAC] ERROR in parsing the payload.\n");
+        senml_scratch_release();
         return;
-      } 
-
-      for(int i = 0; i < payload.num_measurements; i++){
-        if(strcmp(payload.measurements[i].name, "temperature") == 0){
-          current_temperature = payload.measurements[i].value.v;
-          temperature_received = true;
+      }
+#ifdef BENCH
+      bench_stage("parse");
+#endif
+
+      double values[2] = {sensor->values[0], sensor->values[1]};
+      for(int i = 0; i < payload->num_measurements; i++){
+        if(strcmp(payload->measurements[i].name, "temperature") == 0){
+          values[0] = payload->measurements[i].value.v;
         }
-        else if(strcmp(payload.measurements[i].name, "humidity") == 0){
-          current_humidity = payload.measurements[i].value.v;
-          humidity_received = true;
+        else if(strcmp(payload->measurements[i].name, "humidity") == 0){
+          values[1] = payload->measurements[i].value.v;
         }
       }
+      // Released before update_room(), which builds the notification of the HVAC
+      senml_scratch_release();
 
-      if((co_received && temperature_received && humidity_received) || (detector_sensor_off >= MAX_DETECTOR_SENSOR_OFF)){
-        res_hvac.trigger();
-        co_received = temperature_received = humidity_received = false;
-        detector_sensor_off = 0;
-      }
-      else{
-        detector_sensor_off++;
-      }
+      sensor_update(sensor, values);
+
+      update_room();
 
       break;        
 
     case OBSERVE_OK: /* server accepeted observation request */
-      LOG_INFO("[HVAC] OBSERVE_OK from TemperatureAndHumidity sensor\n");
+      LOG_INFO("[HVAC] OBSERVE_OK from TemperatureAndHumidity sensor %s\n", sensor->ip);
       
       break;
 
     case ERROR_RESPONSE_CODE:
       printf("[HVAC] ERROR_RESPONSE_CODE from TemperatureAndHumidity sensor: %*s\n", buffer_size, (char *)buffer);
-      obs = NULL;
+      sensor->observee = NULL;
+      sensor_set_health(sensor, SENSOR_FAILED);
       break;
     case NO_REPLY_FROM_SERVER:
       printf("[HVAC] NO_REPLY_FROM_SERVER from TemperatureAndHumidity sensor: "
             "removing observe registration with token %x%x\n",
             obs->token[0], obs->token[1]);
-      obs = NULL;
+      sensor->observee = NULL;
+      sensor_set_health(sensor, SENSOR_FAILED);
       break;
       
 
@@ -243,18 +478,41 @@ void client_chunk_handler(coap_message_t *response){
 		retry_requests = -1;
 }
 
-// IP of the node where the CO sensor is located
-static char ip_co[40];
-// CoAP endpoint of the node where the CO sensor is located
-static coap_endpoint_t coap_co;
-
-// IP of the node where the TemperatureAndHumidity sensor is located
-static char ip_temperatureandhumidity[40];
-// CoAP endpoint of the node where the TemperatureAndHumidity sensor is located
-static coap_endpoint_t coap_temperatureandhumidity;
-
+// Add to the sensor table the IPs of the comma-separated list returned by the
+// discovery which are not in the table yet (the sensors in the table keep their state)
+static void parse_sensor_list(const uint8_t *buffer, int buffer_size, room_sensor_t *sensors, int *num_sensors,
+                              room_aggregate_t **aggregates, int num_values)
+{
+  int start = 0;
+
+  for(int i = 0; i <= buffer_size && *num_sensors < MAX_ROOM_SENSORS; i++){
+    if(i < buffer_size && buffer[i] != ','){
+      continue;
+    }
+
+    int length = i - start;
+    if(length > 0 && length < sizeof(sensors[*num_sensors].ip)){
+      bool known = false;
+      for(int j = 0; j < *num_sensors && !known; j++){
+        known = strncmp(sensors[j].ip, (const char *)buffer + start, length) == 0 && sensors[j].ip[length] == '\0';
+      }
+      if(!known){
+        room_sensor_t *sensor = &sensors[(*num_sensors)++];
+        memcpy(sensor->ip, buffer + start, length);
+        sensor->ip[length] = '\0';
+        sensor->aggregates = aggregates;
+        sensor->num_values = num_values;
+        sensor->observee = NULL;
+        sensor->health = SENSOR_UNKNOWN;
+        sensor->received = false;
+        sensor->backoff = SENSOR_DISCOVERY_INTERVAL;
+      }
+    }
+    start = i + 1;
+  }
+}
 
-// Callback for the request of the IP of the node where the CO sensor is located
+// Callback for the request of the IPs of the nodes where the CO sensors are located
 void co_request_handler(coap_message_t *response){
   const uint8_t *buffer = NULL;
 
@@ -265,11 +523,11 @@ void co_request_handler(coap_message_t *response){
 		LOG_ERR("[HVAC] Error: %d\n",response->code);	
 	}
   else{
-		LOG_INFO("[HVAC] IP of the CO sensor received successfully\n");
 		retry_requests = 0;		
 	
-    coap_get_payload(response, &buffer);
-    strncpy(ip_co, (char *)buffer, response->payload_len);
+    int buffer_size = coap_get_payload(response, &buffer);
+    parse_sensor_list(buffer, buffer_size, co_sensors, &num_co_sensors, co_aggregates, 1);
+		LOG_INFO("[HVAC] IPs of %d CO sensors received successfully\n", num_co_sensors);
 
 		return;
 	}
@@ -279,7 +537,7 @@ void co_request_handler(coap_message_t *response){
 		retry_requests = -1;
 }
 
-// Callback for the request of the IP of the node where the TemperatureAndHumidity sensor is located
+// Callback for the request of the IPs of the nodes where the TemperatureAndHumidity sensors are located
 void temperatureandhumidity_request_handler(coap_message_t *response){
   const uint8_t *buffer = NULL;
 
@@ -290,11 +548,11 @@ void temperatureandhumidity_request_handler(coap_message_t *response){
 		LOG_ERR("[HVAC] Error: %d\n",response->code);	
 	}
   else{
-		LOG_INFO("[HVAC] IP of the TemperatureAndHumidity sensor received successfully\n");
 		retry_requests = 0;		
 	
-    coap_get_payload(response, &buffer);
-    strncpy(ip_temperatureandhumidity, (char *)buffer, response->payload_len);
+    int buffer_size = coap_get_payload(response, &buffer);
+    parse_sensor_list(buffer, buffer_size, temperatureandhumidity_sensors, &num_temperatureandhumidity_sensors, temperatureandhumidity_aggregates, 2);
+		LOG_INFO("[HVAC] IPs of %d TemperatureAndHumidity sensors received successfully\n", num_temperatureandhumidity_sensors);
 
 		return;
 	}
@@ -304,11 +562,63 @@ void temperatureandhumidity_request_handler(coap_message_t *response){
 		retry_requests = -1;
 }
 
+// Observe the sensors of the table which are not observed (new or failed),
+// and observe again the stale ones once their backoff has elapsed
+static void observe_sensors(room_sensor_t *sensors, int num_sensors, char *resource, notification_callback_t callback)
+{
+  char coap_sensor_endpoint[100];
+
+  for(int i = 0; i < num_sensors; i++){
+    if(sensors[i].observee != NULL){
+      if(sensors[i].health != SENSOR_STALE || clock_time() - sensors[i].observed < sensors[i].backoff){
+        continue;
+      }
+      coap_obs_remove_observee(sensors[i].observee);
+      sensors[i].observee = NULL;
+      // Reset when the sensor reports again
+      if(sensors[i].backoff < SENSOR_STALE_MAX_BACKOFF){
+        sensors[i].backoff *= 2;
+      }
+    }
+
+    // CoAP endpoint of the sensor
+    snprintf(coap_sensor_endpoint, 100, "coap://[%s]:5683", sensors[i].ip);
+    coap_endpoint_parse(coap_sensor_endpoint, strlen(coap_sensor_endpoint), &sensors[i].endpoint);
+
+    // Observing the sensor
+    sensors[i].observee = coap_obs_request_registration(&sensors[i].endpoint, resource, callback, &sensors[i]);
+    sensors[i].observed = clock_time();
+  }
+}
+
+// Number of healthy sensors of the table
+static int count_healthy_sensors(room_sensor_t *sensors, int num_sensors)
+{
+  int healthy = 0;
+
+  for(int i = 0; i < num_sensors; i++){
+    if(sensors[i].health == SENSOR_OK){
+      healthy++;
+    }
+  }
+  return healthy;
+}
+
 
 PROCESS_THREAD(hvac_process, ev, data)
 {
   PROCESS_BEGIN();
   
+#ifdef WATERMARK
+  // Sampling of the high-water marks of the buffers and tables
+  watermark_init();
+#endif
+
+#ifdef BENCH
+  // Reports of the duty cycle for Simulation/benchmark.py
+  bench_init();
+#endif
+
   // Activate the resource exposed by the current node
   coap_activate_resource(&res_hvac, RESOURCE_NAME);
 
@@ -320,6 +630,8 @@ PROCESS_THREAD(hvac_process, ev, data)
     // Initializing the request
 		coap_init_message(request, COAP_TYPE_CON, COAP_POST, 0);
 		coap_set_header_uri_path(request, REGISTRATION_RESOURCE);
+    // Room of the node
+    coap_set_header_uri_query(request, "room=" ROOM_ID_STR);
     // Setting the payload of the request
 		coap_set_payload(request, (uint8_t *)RESOURCE_NAME, sizeof(RESOURCE_NAME) - 1);
 	
@@ -334,72 +646,84 @@ PROCESS_THREAD(hvac_process, ev, data)
 		}
 	}
 
-  retry_requests = MAX_REQUESTS;
-  // Requesting the IP of the node where there is the TemperatureAndHumidity sensor
-  while(retry_requests!=0){
-
-    // Initializing the request
-		coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
-		coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
-    // Add uri query to the request
-    coap_set_header_uri_query(request, "requested_resource="TEMPERATUREANDHUMIDITY_RESOURCE);  
-    
-    // Sending the request
-		COAP_BLOCKING_REQUEST(&coap_server, request, temperatureandhumidity_request_handler);
-    
-		if(retry_requests == -1){	
-      // If the maximum number of requests has been reached, the node goes to sleep	 
-			etimer_set(&sleep_timer, SLEEP_INTERVAL);
-			PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&sleep_timer));
-			retry_requests = MAX_REQUESTS;
-		}
-	}
-
-  // CoAP endpoint of the TemperatureAndHumidity sensor
-  char coap_temperatureandhumidity_endpoint[100];
-  snprintf(coap_temperatureandhumidity_endpoint, 100, "coap://[%s]:5683", ip_temperatureandhumidity);  
-  coap_endpoint_parse(coap_temperatureandhumidity_endpoint, strlen(coap_temperatureandhumidity_endpoint), &coap_temperatureandhumidity);
+  etimer_set(&health_timer, SENSOR_HEALTH_CHECK_INTERVAL);
+  etimer_set(&discovery_timer, SENSOR_DISCOVERY_INTERVAL);
+  while(1) {
 
-  // Observing the TemperatureAndHumidity sensor 
-  temperatureandhumidity_resource = coap_obs_request_registration(&coap_temperatureandhumidity, TEMPERATUREANDHUMIDITY_RESOURCE, temperatureandhumidity_callback, NULL);
+    if(rediscover){
+      rediscover = false;
 
+      retry_requests = MAX_REQUESTS;
+      // Requesting the IPs of the nodes where there are the TemperatureAndHumidity sensors of the room
+      while(retry_requests > 0){
 
-  retry_requests = MAX_REQUESTS;
-  // Requesting the IP of the node where there is the CO sensor
-  while(retry_requests!=0){
+        // Initializing the request
+        coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+        coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
+        // Add uri query to the request
+        coap_set_header_uri_query(request, "requested_resource="TEMPERATUREANDHUMIDITY_RESOURCE"&room=" ROOM_ID_STR "&all=1");
 
-    // Initializing the request
-		coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
-		coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
-    // Add uri query to the request
-    coap_set_header_uri_query(request, "requested_resource="CO_RESOURCE);  
-    
-    // Sending the request
-		COAP_BLOCKING_REQUEST(&coap_server, request, co_request_handler);
-    
-		if(retry_requests == -1){
-      // If the maximum number of requests has been reached, the node goes to sleep		 
-			etimer_set(&sleep_timer, SLEEP_INTERVAL);
-			PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&sleep_timer));
-			retry_requests = MAX_REQUESTS;
-		}
-	}
-  
-  // CoAP endpoint of the CO sensor
-  char coap_co_endpoint[100];
-  snprintf(coap_co_endpoint, 100, "coap://[%s]:5683", ip_co);  
-  coap_endpoint_parse(coap_co_endpoint, strlen(coap_co_endpoint), &coap_co);
-
-  // Observing the CO sensor 
-  co_resource = coap_obs_request_registration(&coap_co, CO_RESOURCE, co_callback, NULL);
+        // Sending the request
+        COAP_BLOCKING_REQUEST(&coap_server, request, temperatureandhumidity_request_handler);
+      }
+      // Observing the new TemperatureAndHumidity sensors
+      observe_sensors(temperatureandhumidity_sensors, num_temperatureandhumidity_sensors, TEMPERATUREANDHUMIDITY_RESOURCE, temperatureandhumidity_callback);
+      // After MAX_REQUESTS failed requests, the discovery is retried at the next health check
+      rediscover = retry_requests == -1;
+
+      retry_requests = MAX_REQUESTS;
+      // Requesting the IPs of the nodes where there are the CO sensors of the room
+      while(retry_requests > 0){
+
+        // Initializing the request
+        coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+        coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
+        // Add uri query to the request
+        coap_set_header_uri_query(request, "requested_resource="CO_RESOURCE"&room=" ROOM_ID_STR "&all=1");
+
+        // Sending the request
+        COAP_BLOCKING_REQUEST(&coap_server, request, co_request_handler);
+      }
+      // Observing the new CO sensors
+      observe_sensors(co_sensors, num_co_sensors, CO_RESOURCE, co_callback);
+      rediscover = rediscover || retry_requests == -1;
+    }
+
+    // The timers may have expired during the discovery: no wait in that case
+    PROCESS_WAIT_UNTIL(etimer_expired(&health_timer) || etimer_expired(&discovery_timer));
+
+    if(etimer_expired(&discovery_timer)){
+      rediscover = true;
+      etimer_reset(&discovery_timer);
+    }
+    if(etimer_expired(&health_timer)){
+      // Sensors which stopped reporting are excluded from the aggregates
+      check_sensors_health(co_sensors, num_co_sensors);
+      check_sensors_health(temperatureandhumidity_sensors, num_temperatureandhumidity_sensors);
+
+      // A sensor became stale or its observation failed: it is observed again
+      int healthy = count_healthy_sensors(co_sensors, num_co_sensors)
+                  + count_healthy_sensors(temperatureandhumidity_sensors, num_temperatureandhumidity_sensors);
+      if(healthy < num_healthy_sensors){
+        rediscover = true;
+      }
+      num_healthy_sensors = healthy;
 
-  while(1) {
-    PROCESS_YIELD();
+      etimer_reset(&health_timer);
+    }
   }
 
-  // Stopping the observation
-  coap_obs_remove_observee(temperatureandhumidity_resource);
-  coap_obs_remove_observee(co_resource);
+  // Stopping the observations
+  for(int i = 0; i < num_temperatureandhumidity_sensors; i++){
+    if(temperatureandhumidity_sensors[i].observee != NULL){
+      coap_obs_remove_observee(temperatureandhumidity_sensors[i].observee);
+    }
+  }
+  for(int i = 0; i < num_co_sensors; i++){
+    if(co_sensors[i].observee != NULL){
+      coap_obs_remove_observee(co_sensors[i].observee);
+    }
+  }
 
   PROCESS_END();
 }
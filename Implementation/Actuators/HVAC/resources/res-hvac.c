@@ -7,6 +7,10 @@
 #include "sys/log.h"
 #include "machine_learning.h"
 
+#ifdef BENCH
+#include "bench.h"
+#endif
+
 #define LOG_MODULE "App"
 #define LOG_LEVEL LOG_LEVEL_APP
 
@@ -23,6 +27,9 @@ EVENT_RESOURCE(res_hvac,
 
 static bool hvac_status = false;
 
+// Uptime of the node when the status was predicted (s)
+static unsigned long prediction_time;
+
 extern double current_temperature;
 extern double current_humidity;
 extern double current_co;
@@ -44,10 +51,17 @@ res_event_handler(void)
     // vault is NOT habitable. So hvac_status
     // is the negation of the predicted value.
     hvac_status = machine_learning_predict(input_data, 3) == 0;
+    prediction_time = clock_seconds();
     LOG_DBG("[HVAC] Predicted HVAC status: %d\n", hvac_status);
+#ifdef BENCH
+    bench_stage("predict");
+#endif
 
     // Notify all the observers
     coap_notify_observers(&res_hvac);
+#ifdef BENCH
+    bench_stage("notify");
+#endif
 }
 
 
@@ -55,22 +69,25 @@ static void
 res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
 {
 
-    static senml_measurement_t measurements[1];
+    senml_payload_t *payload = senml_scratch_acquire(1);
+    if (payload == NULL) {
+        coap_set_status_code(response, SERVICE_UNAVAILABLE_5_03);
+        LOG_ERR("[HVAC] SenML scratch arena in use\n");
+        return;
+    }
+    // Base time: uptime of the node, the time of the prediction is relative to it
+    unsigned long now = clock_seconds();
+    payload->base_time = (int) now;
+
+    senml_measurement_t *measurements = payload->measurements;
     measurements[0].name = "hvac";
     measurements[0].type = SENML_TYPE_BV;
     measurements[0].value.bv = hvac_status;
-    static char base_name[BASE_NAME_LEN];
-    get_mac_address(base_name);
-
-    static senml_payload_t payload = {
-        .base_name = base_name,
-        .base_time = 0,
-        .version = 1,
-        .measurements = measurements,
-        .num_measurements = 1
-    };
-
-    int length = create_senml_payload((char *)buffer, preferred_size, &payload);
+    measurements[0].time = (int) prediction_time - (int) now;
+    get_mac_address(payload->base_name);
+
+    int length = create_senml_payload((char *)buffer, preferred_size, payload);
+    senml_scratch_release();
 
     if (length < 0) {
         coap_set_status_code(response, BAD_REQUEST_4_00);
@@ -33,6 +33,12 @@
 
 // #define LOG_CONF_LEVEL_COAP LOG_LEVEL_DBG
 
+#ifdef RAM_PROFILE
+// Buffers and tables sized from the high-water marks measured in simulation
+// (make PROFILE=1, see Simulation/ram_profiles.py)
+#include RAM_PROFILE
+#else
+
 // Set the max response payload before enable fragmentation:
 
 #undef REST_MAX_CHUNK_SIZE
@@ -43,6 +49,11 @@
 #undef COAP_MAX_OPEN_TRANSACTIONS
 #define COAP_MAX_OPEN_TRANSACTIONS   4
 
+// Notify up to 8 sensors of the room:
+
+#undef COAP_MAX_OBSERVERS
+#define COAP_MAX_OBSERVERS    8
+
 #undef NBR_TABLE_CONF_MAX_NEIGHBORS
 #define NBR_TABLE_CONF_MAX_NEIGHBORS     10
 
@@ -51,10 +62,23 @@
 
 #undef UIP_CONF_BUFFER_SIZE
 #define UIP_CONF_BUFFER_SIZE    680 // 240
+#endif
 
 
+// Records of the SenML scratch arena shared by all the payloads of the node.
+// The history holds the suppressed notifications and 6 transitions:
+
+#define SENML_ARENA_CONF_RECORDS    7
+#define SENML_ARENA_CONF_STRING_RECORDS    1
+
 #define LOG_LEVEL_APP LOG_LEVEL_DBG
 
 
 
+#ifdef VAULTSTATUS_MULTICAST
+// Multicast engine forwarding the room state published by the VaultStatus
+#undef UIP_MCAST6_CONF_ENGINE
+#define UIP_MCAST6_CONF_ENGINE UIP_MCAST6_ENGINE_MPL
+#endif
+
 #endif /* PROJECT_CONF_H_ */
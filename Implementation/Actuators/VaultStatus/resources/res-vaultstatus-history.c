@@ -0,0 +1,69 @@
+#include "contiki.h"
+#include "coap-engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "json-senml.h"
+#include "sys/log.h"
+#include "vaultstatus.h"
+
+#define LOG_MODULE "App"
+#define LOG_LEVEL LOG_LEVEL_APP
+
+static void res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+RESOURCE(res_vaultstatus_history,
+         "title=\"VoltVault: \";rt=\"senml+json\";if=\"actuator\"",
+         res_get_handler,
+         NULL,
+         NULL,
+         NULL);
+
+
+static void
+res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+
+    senml_payload_t *payload = senml_scratch_acquire(1 + transition_history_count);
+    if (payload == NULL) {
+        coap_set_status_code(response, SERVICE_UNAVAILABLE_5_03);
+        LOG_ERR("[VoltStatus] SenML scratch arena in use\n");
+        return;
+    }
+    senml_measurement_t *measurements = payload->measurements;
+
+    // The first record is the number of suppressed notifications
+    static char suppressed[12];
+    snprintf(suppressed, sizeof(suppressed), "%lu", suppressed_notifications);
+    measurements[0].name = "suppressed_notifications";
+    measurements[0].type = SENML_TYPE_SV;
+    measurements[0].value.sv = suppressed;
+    measurements[0].unit = "count";
+
+    // Then one record per transition, from the oldest to the most recent.
+    // The time of each record is the clock_seconds() of the transition.
+    for (unsigned int i = 0; i < transition_history_count; i++) {
+        unsigned int index = (transition_history_head + i) % TRANSITION_HISTORY_LEN;
+        measurements[1 + i].name = "vaultstatus";
+        measurements[1 + i].type = SENML_TYPE_V;
+        measurements[1 + i].value.v = transition_history_led_status[index];
+        measurements[1 + i].unit = "led_status";
+        measurements[1 + i].time = (int) transition_history_time[index];
+    }
+
+    get_mac_address(payload->base_name);
+
+    int length = create_senml_payload((char *)buffer, preferred_size, payload);
+    senml_scratch_release();
+
+    if (length < 0) {
+        coap_set_status_code(response, BAD_REQUEST_4_00);
+        LOG_ERR("[VoltStatus] Error in creating SenML payload\n");
+    } else {
+        coap_set_header_content_format(response, APPLICATION_JSON);
+        coap_set_payload(response, buffer, length);
+        
+        // Printing the payload for debugging purposes
+        LOG_DBG("[VoltStatus] Sending the history payload: %s\n", buffer);
+    }
+}
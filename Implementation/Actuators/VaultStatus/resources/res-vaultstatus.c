@@ -32,27 +32,38 @@ res_event_handler(void)
 }
 
 
-static void
-res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+/**
+ * Creates the SenML payload carrying the current led_status.
+ *
+ * @param buffer A buffer to hold the generated JSON string.
+ * @param buffer_size The size of the buffer.
+ * @return The length of the generated JSON string or -1 on error.
+ */
+int create_vaultstatus_payload(char *buffer, uint16_t buffer_size)
 {
-
-    static senml_measurement_t measurements[1];
+    senml_payload_t *payload = senml_scratch_acquire(1);
+    if (payload == NULL) {
+        return -1;
+    }
+    senml_measurement_t *measurements = payload->measurements;
     measurements[0].name = "vaultstatus";
     measurements[0].type = SENML_TYPE_V;
     measurements[0].value.v = led_status;
     measurements[0].unit = "led_status";
-    static char base_name[BASE_NAME_LEN];
-    get_mac_address(base_name);
+    get_mac_address(payload->base_name);
+
+    int length = create_senml_payload(buffer, buffer_size, payload);
+    senml_scratch_release();
+
+    return length;
+}
+
 
-    static senml_payload_t payload = {
-        .base_name = base_name,
-        .base_time = 0,
-        .version = 1,
-        .measurements = measurements,
-        .num_measurements = 1
-    };
+static void
+res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
 
-    int length = create_senml_payload((char *)buffer, preferred_size, &payload);
+    int length = create_vaultstatus_payload((char *)buffer, preferred_size);
 
     if (length < 0) {
         coap_set_status_code(response, BAD_REQUEST_4_00);
@@ -65,4 +76,3 @@ res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buff
         LOG_DBG("[VoltStatus] Sending the payload: %s\n", buffer);
     }
 }
-
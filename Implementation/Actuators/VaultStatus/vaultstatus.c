@@ -2,10 +2,25 @@
 #include "coap-engine.h"
 #include "coap-blocking-api.h"
 #include "sys/etimer.h"
+#include "sys/ctimer.h"
 #include "sys/log.h"
 #include "os/dev/leds.h"
 #include "json-senml.h"
 #include "coap-observe-client.h"
+#include "sys/clock.h"
+#include "vaultstatus.h"
+
+#ifdef VAULTSTATUS_MULTICAST
+#include "coap-transport.h"
+#endif
+
+#ifdef WATERMARK
+#include "watermark.h"
+#endif
+
+#ifdef BENCH
+#include "bench.h"
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,13 +36,35 @@
 // Discovery resource exposed by the CoAP server
 #define DISCOVERY_RESOURCE "/discovery"
 
+// Room where the node is deployed (set with make ROOM=<id>)
+#ifndef ROOM_ID
+#define ROOM_ID 0
+#endif
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+#define ROOM_ID_STR STRINGIFY(ROOM_ID)
+
 // Resource exposed by the Movement sensor
 #define MOVEMENT_RESOURCE "movement"
 // Resource exposed by the HVAC
 #define HVAC_RESOURCE "hvac"
 
+#ifdef VAULTSTATUS_MULTICAST
+// Multicast group where the room state is published to the sensors of the room
+#define ROOMSTATE_MULTICAST_URL "coap://[ff03::76:" ROOM_ID_STR "]:5683"
+// Resource exposed by the sensors to receive the room state
+#define ROOMSTATE_RESOURCE "roomstate"
+// Maximum length of the published room state
+#define ROOMSTATE_PAYLOAD_LEN 160
+// Interval between two publications of an unchanged room state, so that
+// sensors which missed a (non-confirmable) publication catch up
+#define ROOMSTATE_REFRESH_INTERVAL 60*CLOCK_SECOND
+#endif
+
 // Resource exposed by the current node
 #define RESOURCE_NAME "vaultstatus"
+// History of the state transitions exposed by the current node
+#define HISTORY_RESOURCE_NAME "vaultstatus/history"
 
 // Maximum number of requests before sleeping
 #define MAX_REQUESTS 5
@@ -43,6 +80,7 @@ static struct etimer sleep_timer;
 #define ALL_LEDS_OFF 5
 
 extern coap_resource_t res_vaultstatus;
+extern coap_resource_t res_vaultstatus_history;
 
 static coap_endpoint_t coap_server;
 static coap_message_t request[1];       
@@ -59,25 +97,309 @@ unsigned int led_status = ALL_LEDS_OFF;
 // Automatic door timer
 static struct etimer automatic_door_timer;
 
+// Ring buffer of the last state transitions, exposed by res_vaultstatus_history
+unsigned long transition_history_time[TRANSITION_HISTORY_LEN];
+unsigned int transition_history_led_status[TRANSITION_HISTORY_LEN];
+unsigned int transition_history_head = 0;
+unsigned int transition_history_count = 0;
+
+// Maximum number of events waiting to be processed
+#define EVENT_QUEUE_LEN 8
+
+// States of the vault
+typedef enum {
+  VAULT_STATE_SLEEP,      // All LEDs off: the human operator is not in the room
+  VAULT_STATE_WAITING,    // Yellow LED: the human operator is waiting
+  VAULT_STATE_HVAC_ON,    // Red LED: the room is not habitable
+  VAULT_STATE_HVAC_OFF,   // Green LED: the room is habitable
+  VAULT_STATE_NUM
+} vault_state_t;
+
+// Events received from the observed resources
+typedef enum {
+  VAULT_EVENT_MOVEMENT_ON,
+  VAULT_EVENT_MOVEMENT_OFF,
+  VAULT_EVENT_HVAC_ON,
+  VAULT_EVENT_HVAC_OFF,
+  VAULT_EVENT_NUM
+} vault_event_t;
+
+typedef struct {
+  vault_state_t next_state;
+  bool open_door;
+} vault_transition_t;
+
+// Transition table indexed by [current state][event]
+static const vault_transition_t transition_table[VAULT_STATE_NUM][VAULT_EVENT_NUM] = {
+  [VAULT_STATE_SLEEP] = {
+    [VAULT_EVENT_MOVEMENT_ON]  = { VAULT_STATE_WAITING,  false },
+    [VAULT_EVENT_MOVEMENT_OFF] = { VAULT_STATE_SLEEP,    false },
+    [VAULT_EVENT_HVAC_ON]      = { VAULT_STATE_SLEEP,    false },
+    [VAULT_EVENT_HVAC_OFF]     = { VAULT_STATE_SLEEP,    false },
+  },
+  [VAULT_STATE_WAITING] = {
+    [VAULT_EVENT_MOVEMENT_ON]  = { VAULT_STATE_WAITING,  false },
+    [VAULT_EVENT_MOVEMENT_OFF] = { VAULT_STATE_SLEEP,    false },
+    [VAULT_EVENT_HVAC_ON]      = { VAULT_STATE_HVAC_ON,  false },
+    [VAULT_EVENT_HVAC_OFF]     = { VAULT_STATE_HVAC_OFF, true  },
+  },
+  [VAULT_STATE_HVAC_ON] = {
+    [VAULT_EVENT_MOVEMENT_ON]  = { VAULT_STATE_WAITING,  false },
+    [VAULT_EVENT_MOVEMENT_OFF] = { VAULT_STATE_SLEEP,    false },
+    [VAULT_EVENT_HVAC_ON]      = { VAULT_STATE_HVAC_ON,  false },
+    [VAULT_EVENT_HVAC_OFF]     = { VAULT_STATE_HVAC_OFF, true  },
+  },
+  [VAULT_STATE_HVAC_OFF] = {
+    // The human operator is leaving the room
+    [VAULT_EVENT_MOVEMENT_ON]  = { VAULT_STATE_WAITING,  false },
+    [VAULT_EVENT_MOVEMENT_OFF] = { VAULT_STATE_SLEEP,    true  },
+    [VAULT_EVENT_HVAC_ON]      = { VAULT_STATE_HVAC_ON,  false },
+    [VAULT_EVENT_HVAC_OFF]     = { VAULT_STATE_HVAC_OFF, false },
+  },
+};
+
+// Value of led_status exposed for each state
+static const unsigned int state_led_status[VAULT_STATE_NUM] = {
+  [VAULT_STATE_SLEEP]    = ALL_LEDS_OFF,
+  [VAULT_STATE_WAITING]  = LEDS_YELLOW,
+  [VAULT_STATE_HVAC_ON]  = LEDS_RED,
+  [VAULT_STATE_HVAC_OFF] = LEDS_GREEN,
+};
+
+static vault_state_t vault_state = VAULT_STATE_SLEEP;
+
+// Queue of the events posted by the callbacks
+static vault_event_t event_queue[EVENT_QUEUE_LEN];
+static unsigned int event_queue_head = 0;
+static unsigned int event_queue_count = 0;
+
+// Remaining LED toggles of the current door cycle
+static int door_toggles_left = 0;
+// Door cycles requested and not yet completed
+static int pending_door_cycles = 0;
+
+// Window during which back-to-back state changes are merged in a single notification
+#define NOTIFICATION_COALESCING_INTERVAL (CLOCK_SECOND / 4)
+static struct ctimer notification_timer;
+static bool notification_pending = false;
+// Value of led_status carried by the last notification
+static unsigned int notified_led_status = ALL_LEDS_OFF;
+// Number of notifications not sent because the state did not change or was coalesced
+unsigned long suppressed_notifications = 0;
+
+#ifdef VAULTSTATUS_MULTICAST
+static coap_endpoint_t roomstate_group;
+static coap_message_t roomstate_message[1];
+static uint8_t roomstate_packet[COAP_MAX_PACKET_SIZE];
+static struct etimer roomstate_refresh_timer;
+
+extern int create_vaultstatus_payload(char *buffer, uint16_t buffer_size);
+#endif
+
 PROCESS(vaultstatus_process, "VaultStatus process");
 AUTOSTART_PROCESSES(&vaultstatus_process);
 
-// Callback for the Movement sensor
-static void movement_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
+// Enqueue an event and wake up the process to handle it
+static void post_vault_event(vault_event_t event)
 {
-  static senml_payload_t payload;
+  if(event_queue_count >= EVENT_QUEUE_LEN){
+    LOG_ERR("[VaultStatus] Event queue full, event %d dropped\n", event);
+    return;
+  }
 
-  static senml_measurement_t measurements[1];
-  payload.measurements = measurements;
-  payload.num_measurements = 1;
+  event_queue[(event_queue_head + event_queue_count) % EVENT_QUEUE_LEN] = event;
+  event_queue_count++;
 
-  static char base_name[MAX_STRING_LEN];
-  static char name[1][MAX_STRING_LEN];
-  static char unit[1][MAX_STRING_LEN];
-  
-  payload.base_name = base_name;
-  payload.measurements[0].name = name[0];
-  payload.measurements[0].unit = unit[0];
+  process_poll(&vaultstatus_process);
+}
+
+// Switch on the LED associated with the given state
+static void apply_state_leds(vault_state_t state)
+{
+  leds_single_off(LEDS_YELLOW);
+  leds_off(LEDS_ALL);
+
+  switch (state) {
+    case VAULT_STATE_WAITING:
+      leds_single_on(LEDS_YELLOW);
+      break;
+    case VAULT_STATE_HVAC_ON:
+      #ifdef COOJA
+        leds_single_on(LEDS_RED);
+      #else
+        leds_on(LEDS_RED);
+      #endif
+      break;
+    case VAULT_STATE_HVAC_OFF:
+      #ifdef COOJA
+        leds_single_on(LEDS_GREEN);
+      #else
+        leds_on(LEDS_GREEN);
+      #endif
+      break;
+    default:
+      break;
+  }
+}
+
+// Store the current state in the transition history
+static void record_transition(void)
+{
+  unsigned int index = (transition_history_head + transition_history_count) % TRANSITION_HISTORY_LEN;
+
+  if(transition_history_count == TRANSITION_HISTORY_LEN){
+    // Overwrite the oldest transition
+    transition_history_head = (transition_history_head + 1) % TRANSITION_HISTORY_LEN;
+  }
+  else{
+    transition_history_count++;
+  }
+
+  transition_history_time[index] = clock_seconds();
+  transition_history_led_status[index] = led_status;
+}
+
+#ifdef VAULTSTATUS_MULTICAST
+// Publish the room state with a single non-confirmable request to the
+// multicast group, instead of one notification per observing sensor
+static void publish_room_state(void)
+{
+  static char payload[ROOMSTATE_PAYLOAD_LEN];
+
+  int length = create_vaultstatus_payload(payload, sizeof(payload));
+  if(length < 0){
+    LOG_ERR("[VaultStatus] Error in creating the room state payload\n");
+    return;
+  }
+
+  coap_init_message(roomstate_message, COAP_TYPE_NON, COAP_PUT, coap_get_mid());
+  coap_set_header_uri_path(roomstate_message, ROOMSTATE_RESOURCE);
+  coap_set_header_content_format(roomstate_message, APPLICATION_JSON);
+  coap_set_payload(roomstate_message, (uint8_t *)payload, length);
+
+  size_t packet_length = coap_serialize_message(roomstate_message, roomstate_packet);
+  if(packet_length == 0){
+    LOG_ERR("[VaultStatus] Error in serializing the room state\n");
+    return;
+  }
+  coap_sendto(&roomstate_group, roomstate_packet, packet_length);
+
+  LOG_DBG("[VaultStatus] Room state published: %s\n", payload);
+}
+#endif
+
+// Notify the observers, unless the state is back to the one already notified
+static void notification_timer_callback(void *ptr)
+{
+  notification_pending = false;
+
+  if(led_status == notified_led_status){
+    suppressed_notifications++;
+    return;
+  }
+
+  notified_led_status = led_status;
+  // Trigger the notification of the vaultstatus resource
+  res_vaultstatus.trigger();
+
+#ifdef VAULTSTATUS_MULTICAST
+  publish_room_state();
+  etimer_restart(&roomstate_refresh_timer);
+#endif
+}
+
+// Schedule a notification at the end of the coalescing window
+static void schedule_notification(void)
+{
+  if(notification_pending){
+    // Merged with the notification already scheduled
+    suppressed_notifications++;
+    return;
+  }
+
+  notification_pending = true;
+  ctimer_set(&notification_timer, NOTIFICATION_COALESCING_INTERVAL, notification_timer_callback, NULL);
+}
+
+// Start a new door cycle, unless one is already in progress
+static void start_door_cycle(void)
+{
+  if(door_toggles_left > 0){
+    return;
+  }
+
+  LOG_DBG("[VaultStatus] Opening the automatic door\n");
+  door_toggles_left = OPEN_AUTOMATIC_DOOR_SECONDS;
+  etimer_set(&automatic_door_timer, CLOCK_SECOND);
+}
+
+// Blink the green LED while the automatic door is open
+static void automatic_door_step(void)
+{
+  #ifdef COOJA
+    leds_single_toggle(LEDS_GREEN);
+  #else
+    leds_toggle(LEDS_GREEN);
+  #endif
+
+  door_toggles_left--;
+  if(door_toggles_left > 0){
+    etimer_reset(&automatic_door_timer);
+    return;
+  }
+
+  // Door cycle completed: restore the LEDs of the current state
+  pending_door_cycles--;
+  apply_state_leds(vault_state);
+
+  if(pending_door_cycles > 0){
+    start_door_cycle();
+  }
+}
+
+// Apply all the queued events to the state machine
+static void process_vault_events(void)
+{
+  while(event_queue_count > 0){
+    vault_event_t event = event_queue[event_queue_head];
+    event_queue_head = (event_queue_head + 1) % EVENT_QUEUE_LEN;
+    event_queue_count--;
+
+    const vault_transition_t *transition = &transition_table[vault_state][event];
+    bool state_changed = transition->next_state != vault_state;
+
+    vault_state = transition->next_state;
+    led_status = state_led_status[vault_state];
+
+    if(state_changed){
+      LOG_DBG("[VaultStatus] New led_status: %u\n", led_status);
+      record_transition();
+      schedule_notification();
+    }
+    else{
+      // Nothing changed for the observers
+      suppressed_notifications++;
+    }
+
+    apply_state_leds(vault_state);
+#ifdef BENCH
+    if(event == VAULT_EVENT_HVAC_ON || event == VAULT_EVENT_HVAC_OFF){
+      bench_stage("led");
+    }
+#endif
+
+    if(transition->open_door){
+      pending_door_cycles++;
+      start_door_cycle();
+    }
+  }
+}
+
+// Callback for the Movement sensor
+static void movement_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
+{
+  senml_payload_t *payload;
+  bool status;
 
   const uint8_t *buffer = NULL;
 
@@ -89,42 +411,28 @@ static void movement_callback(coap_observee_t *obs, void *notification, coap_not
   switch (flag) {
     case NOTIFICATION_OK:
 
-      // From movement we receive the boolean vault_activated
-
       LOG_DBG("[VaultStatus] Notification received from Movement sensor: %s\n", buffer);
 
-      LOG_DBG("[VaultStatus] In movement_callback payload.num_measurements is: %d\n", payload.num_measurements);
-
-      if(parse_senml_payload((char*)buffer, buffer_size, &payload) == -1){
-        LOG_ERR("[VaultStatus] ERROR in parsing the payload.\n");
+      payload = senml_scratch_acquire(1);
+      if(payload == NULL){
+        LOG_ERR("[VaultStatus] SenML scratch arena in use.\n");
         return;
       }
 
-      // If all LEDs are off, the human operator is no longer in the room -> sleep mode is on
-      // If the red LED is on, HVAC is active -> sleep mode is off
-      // If the green LED is on, HVAC is inactive -> sleep mode is off
-      // If the yellow LED is on, the human operator is waiting -> sleep mode is off
+      LOG_DBG("[VaultStatus] In movement_callback payload->num_measurements is: %d\n", payload->num_measurements);
 
-      if(payload.measurements[0].value.bv){
-        // vault_activated is true
-        leds_single_on(LEDS_YELLOW);
-        led_status = LEDS_YELLOW;
-      }
-      else{
-        // vault_activated is false
-        leds_single_off(LEDS_YELLOW);        
-        leds_off(LEDS_ALL);
-        
-        if(led_status == LEDS_GREEN){
-          // The human operator is leaving the room
-          LOG_DBG("[VaultStatus] Opening the automatic door\n");
-          process_poll(&vaultstatus_process);
-        }
-        led_status = ALL_LEDS_OFF;
+      if(parse_senml_payload((char*)buffer, buffer_size, payload) == -1){
+        LOG_ERR("[VaultStatus] ERROR in parsing the payload.\n");
+        senml_scratch_release();
+        return;
       }
 
-      // Trigger the notification of the vaultstatus resource
-      res_vaultstatus.trigger();
+      // From movement we receive the boolean vault_activated
+      status = payload->measurements[0].value.bv;
+      // Released before the event, which may notify the observers of the VaultStatus
+      senml_scratch_release();
+
+      post_vault_event(status ? VAULT_EVENT_MOVEMENT_ON : VAULT_EVENT_MOVEMENT_OFF);
       
       break;        
 
@@ -154,23 +462,11 @@ static void movement_callback(coap_observee_t *obs, void *notification, coap_not
 // Callback for the HVAC
 static void hvac_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
 {
-  static senml_payload_t payload;
-  static senml_measurement_t measurements[1];
-  payload.measurements = measurements;
-  payload.num_measurements = 1;
-
-  static char base_name[MAX_STRING_LEN];
-  static char name[1][MAX_STRING_LEN];
-  static char unit[1][MAX_STRING_LEN];
-  
-  payload.base_name = base_name;
-  payload.measurements[0].name = name[0];
-  payload.measurements[0].unit = unit[0];
+  senml_payload_t *payload;
+  bool status;
 
   const uint8_t *buffer = NULL;
 
-  unsigned int old_led_status = led_status;
-
   int buffer_size = 0;
   if(notification){
     buffer_size = coap_get_payload(notification, &buffer);
@@ -179,49 +475,28 @@ static void hvac_callback(coap_observee_t *obs, void *notification, coap_notific
   switch (flag) {
     case NOTIFICATION_OK:
 
-      // From HVAC we receive the boolean hvac_status
       LOG_DBG("[VaultStatus] Notification received from HVAC: %s\n", buffer);
 
-      LOG_DBG("In hvac_callback payload.num_measurements is: %d\n", payload.num_measurements);
+      payload = senml_scratch_acquire(1);
+      if(payload == NULL){
+        LOG_ERR("[VaultStatus] SenML scratch arena in use.\n");
+        return;
+      }
+
+      LOG_DBG("In hvac_callback payload->num_measurements is: %d\n", payload->num_measurements);
 
-      if(parse_senml_payload((char*)buffer, buffer_size, &payload) == -1){
+      if(parse_senml_payload((char*)buffer, buffer_size, payload) == -1){
         LOG_ERR("[VaultStatus] ERROR in parsing the payload.\n");
+        senml_scratch_release();
         return;
       }
 
-      // If the HVAC is on, the red LED is on
-      // If the HVAC is off, the green LED is on
-
-      if(led_status != ALL_LEDS_OFF){
-        // The vault is activated
-
-        if(!payload.measurements[0].value.bv){
-          // hvac_status is false
-          leds_single_off(LEDS_YELLOW);        
-          leds_off(LEDS_ALL);
-          #ifdef COOJA
-            leds_single_on(LEDS_GREEN);
-          #else
-            leds_on(LEDS_GREEN);
-          #endif
-          led_status = LEDS_GREEN;
-        }
-        else{
-          // hvac_status is true
-          leds_single_off(LEDS_YELLOW);        
-          leds_off(LEDS_ALL);
-          #ifdef COOJA
-            leds_single_on(LEDS_RED);
-          #else
-            leds_on(LEDS_RED);
-          #endif
-          led_status = LEDS_RED;
-        }
+      // From HVAC we receive the boolean hvac_status
+      status = payload->measurements[0].value.bv;
+      // Released before the event, which may notify the observers of the VaultStatus
+      senml_scratch_release();
 
-      }
-      
-      // Trigger the notification of the vaultstatus resource
-      res_vaultstatus.trigger();
+      post_vault_event(status ? VAULT_EVENT_HVAC_ON : VAULT_EVENT_HVAC_OFF);
 
       break;        
 
@@ -248,11 +523,6 @@ static void hvac_callback(coap_observee_t *obs, void *notification, coap_notific
 
   }
 
-  if(led_status == LEDS_GREEN && old_led_status != LEDS_GREEN){
-    LOG_DBG("[VaultStatus] Opening the automatic door\n");
-    process_poll(&vaultstatus_process);
-  }
-
 }
 
 // Callback for the registration to the CoAP server
@@ -339,12 +609,21 @@ void hvac_request_handler(coap_message_t *response){
 
 PROCESS_THREAD(vaultstatus_process, ev, data)
 {
-  static int i;
-
   PROCESS_BEGIN();
 
-  // Activate the resource exposed by the current node
+#ifdef WATERMARK
+  // Sampling of the high-water marks of the buffers and tables
+  watermark_init();
+#endif
+
+#ifdef BENCH
+  // Reports of the duty cycle for Simulation/benchmark.py
+  bench_init();
+#endif
+
+  // Activate the resources exposed by the current node
   coap_activate_resource(&res_vaultstatus, RESOURCE_NAME);
+  coap_activate_resource(&res_vaultstatus_history, HISTORY_RESOURCE_NAME);
 
   // Registration to the CoAP server
   while(retry_requests!=0){
@@ -354,6 +633,8 @@ PROCESS_THREAD(vaultstatus_process, ev, data)
     // Initializing the request
 		coap_init_message(request, COAP_TYPE_CON, COAP_POST, 0);
 		coap_set_header_uri_path(request, REGISTRATION_RESOURCE);
+    // Room of the node
+    coap_set_header_uri_query(request, "room=" ROOM_ID_STR);
     // Setting the payload of the request
 		coap_set_payload(request, (uint8_t *)RESOURCE_NAME, sizeof(RESOURCE_NAME) - 1);
 	
@@ -376,7 +657,7 @@ PROCESS_THREAD(vaultstatus_process, ev, data)
 		coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
 		coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
     // Add uri query to the request
-    coap_set_header_uri_query(request, "requested_resource="MOVEMENT_RESOURCE);  
+    coap_set_header_uri_query(request, "requested_resource="MOVEMENT_RESOURCE"&room=" ROOM_ID_STR);  
     
     // Sending the request
 		COAP_BLOCKING_REQUEST(&coap_server, request, movement_request_handler);
@@ -405,7 +686,7 @@ PROCESS_THREAD(vaultstatus_process, ev, data)
 		coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
 		coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
     // Add uri query to the request
-    coap_set_header_uri_query(request, "requested_resource="HVAC_RESOURCE);  
+    coap_set_header_uri_query(request, "requested_resource="HVAC_RESOURCE"&room=" ROOM_ID_STR);  
     
     // Sending the request
 		COAP_BLOCKING_REQUEST(&coap_server, request, hvac_request_handler);
@@ -426,25 +707,32 @@ PROCESS_THREAD(vaultstatus_process, ev, data)
   // Observing the HVAC
   hvac_resource = coap_obs_request_registration(&coap_hvac, HVAC_RESOURCE, hvac_callback, NULL);
 
-  etimer_set(&automatic_door_timer, CLOCK_SECOND);
+#ifdef VAULTSTATUS_MULTICAST
+  coap_endpoint_parse(ROOMSTATE_MULTICAST_URL, strlen(ROOMSTATE_MULTICAST_URL), &roomstate_group);
+  etimer_set(&roomstate_refresh_timer, ROOMSTATE_REFRESH_INTERVAL);
+#endif
+
+  // Handle the events queued so far
+  process_vault_events();
 
   while(1) {
 
-    LOG_DBG("[VaultStatus] Process going to sleep\n");
-    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&automatic_door_timer));
-    PROCESS_YIELD();
-    LOG_DBG("[VaultStatus] Process woke up\n");
-    etimer_restart(&automatic_door_timer);
-    for(i = 0; i < OPEN_AUTOMATIC_DOOR_SECONDS; i++){
-      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&automatic_door_timer));
-      #ifdef COOJA
-        leds_single_toggle(LEDS_GREEN);
-      #else
-        leds_toggle(LEDS_GREEN);
-      #endif
-      etimer_reset(&automatic_door_timer);
-    }      
-    
+    PROCESS_WAIT_EVENT();
+
+    if(ev == PROCESS_EVENT_POLL){
+      // New events posted by the callbacks
+      process_vault_events();
+    }
+    else if(ev == PROCESS_EVENT_TIMER && data == &automatic_door_timer && door_toggles_left > 0){
+      automatic_door_step();
+    }
+#ifdef VAULTSTATUS_MULTICAST
+    else if(ev == PROCESS_EVENT_TIMER && data == &roomstate_refresh_timer){
+      publish_room_state();
+      etimer_reset(&roomstate_refresh_timer);
+    }
+#endif
+
   }
 
   // Stopping the observation
@@ -0,0 +1,24 @@
+/**
+ * \file
+ *         State of the VaultStatus node shared with its CoAP resources
+ */
+
+#ifndef VAULTSTATUS_H_
+#define VAULTSTATUS_H_
+
+/* Length of the ring buffer holding the last state transitions */
+#define TRANSITION_HISTORY_LEN 6
+
+/*
+ * Ring buffer of the last state transitions, exposed by res_vaultstatus_history:
+ * uptime of the transition (s) and status of the leds it set
+ */
+extern unsigned long transition_history_time[TRANSITION_HISTORY_LEN];
+extern unsigned int transition_history_led_status[TRANSITION_HISTORY_LEN];
+extern unsigned int transition_history_head;
+extern unsigned int transition_history_count;
+
+/* Notifications not sent because the state did not change or was coalesced */
+extern unsigned long suppressed_notifications;
+
+#endif /* VAULTSTATUS_H_ */
@@ -32,6 +32,10 @@
 
 #include "contiki.h"
 
+#if BORDER_ROUTER_CONF_PROXY
+#include "coap-proxy.h"
+#endif /* BORDER_ROUTER_CONF_PROXY */
+
 /* Log configuration */
 #include "sys/log.h"
 #define LOG_MODULE "RPL BR"
@@ -51,6 +55,10 @@ PROCESS_THREAD(contiki_ng_br, ev, data)
   process_start(&webserver_nogui_process, NULL);
 #endif /* BORDER_ROUTER_CONF_WEBSERVER */
 
+#if BORDER_ROUTER_CONF_PROXY
+  coap_proxy_init();
+#endif /* BORDER_ROUTER_CONF_PROXY */
+
   LOG_INFO("Contiki-NG Border Router started\n");
 
   PROCESS_END();
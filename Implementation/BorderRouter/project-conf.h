@@ -48,6 +48,51 @@
 
 #if BORDER_ROUTER_CONF_WEBSERVER
 #define UIP_CONF_TCP 1
+/* Per-neighbor packet counters exported by /metrics and /topology.json */
+#define LINK_STATS_CONF_PACKET_COUNTERS 1
+#endif
+
+#ifndef BORDER_ROUTER_CONF_PROXY
+#define BORDER_ROUTER_CONF_PROXY 0
+#endif
+
+#ifndef BORDER_ROUTER_CONF_UPLINK_BATCH
+#define BORDER_ROUTER_CONF_UPLINK_BATCH 0
+#endif
+
+#if BORDER_ROUTER_CONF_UPLINK_BATCH
+/* Every resource forwarded to the cloud stays cached and observed */
+#define COAP_PROXY_CONF_ENTRIES 256
+/* A pack is sent in a single message: the chunk size is raised to its byte budget */
+#ifndef UPLINK_BATCH_CONF_BUDGET
+#define UPLINK_BATCH_CONF_BUDGET 1024
+#endif
+#undef REST_MAX_CHUNK_SIZE
+#define REST_MAX_CHUNK_SIZE UPLINK_BATCH_CONF_BUDGET
+#endif
+
+#if BORDER_ROUTER_CONF_PROXY
+/* One observe relation per cached mote resource, fanned out to the */
+/* clients observing /proxy/<mote ip>/<resource> */
+#ifdef COAP_PROXY_CONF_ENTRIES
+#define COAP_MAX_OBSERVEES COAP_PROXY_CONF_ENTRIES
+#else
+#define COAP_MAX_OBSERVEES 8
+#endif
+#define COAP_MAX_OBSERVERS 32
+/* Room for the full path of the proxied resources */
+#define COAP_OBSERVER_URL_LEN 64
+/* The cached payloads are returned in a single response: the chunk size */
+/* is raised as on the motes (64 by default) to the largest cached payload */
+#ifndef REST_MAX_CHUNK_SIZE
+#define REST_MAX_CHUNK_SIZE 256
+#endif
+#endif
+
+#ifdef VAULTSTATUS_MULTICAST
+/* Multicast engine forwarding the room state published by the VaultStatus */
+#undef UIP_MCAST6_CONF_ENGINE
+#define UIP_MCAST6_CONF_ENGINE UIP_MCAST6_ENGINE_MPL
 #endif
 
 #endif /* PROJECT_CONF_H_ */
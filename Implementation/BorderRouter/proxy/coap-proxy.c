@@ -0,0 +1,302 @@
+/**
+ * \file
+ *         CoAP proxy caching the resources of the motes on the border router.
+ *
+ *         Contiki-NG dispatches requests on the Uri-Path only, so the target
+ *         of the proxy is carried in the path: /proxy/<mote ip>/<resource>.
+ *         The first request for a target starts an observe relation with
+ *         the mote; its notifications refresh the cache and are fanned out
+ *         to every client observing the same target, so the traffic in the
+ *         mesh does not depend on the number of clients.
+ */
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "coap-observe-client.h"
+#include "coap-proxy.h"
+#if BORDER_ROUTER_CONF_UPLINK_BATCH
+#include "sys/ctimer.h"
+#include "uplink-batch.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "CoAP Proxy"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+/* Number of mote resources cached at the same time */
+#ifndef COAP_PROXY_CONF_ENTRIES
+#define PROXY_ENTRIES 8
+#else /* COAP_PROXY_CONF_ENTRIES */
+#define PROXY_ENTRIES COAP_PROXY_CONF_ENTRIES
+#endif /* COAP_PROXY_CONF_ENTRIES */
+
+/* Largest cached payload, the SenML payloads of the motes are smaller */
+#ifndef COAP_PROXY_CONF_PAYLOAD_LEN
+#define PROXY_PAYLOAD_LEN 256
+#else /* COAP_PROXY_CONF_PAYLOAD_LEN */
+#define PROXY_PAYLOAD_LEN COAP_PROXY_CONF_PAYLOAD_LEN
+#endif /* COAP_PROXY_CONF_PAYLOAD_LEN */
+
+/* The cached payload is returned without Block2: it must fit in a chunk */
+#if PROXY_PAYLOAD_LEN > COAP_MAX_CHUNK_SIZE
+#error "The CoAP chunk size (REST_MAX_CHUNK_SIZE) is smaller than the cached payloads"
+#endif
+
+/* "/<mote ip>/<resource>", the observers of the proxy store the full path */
+#define PROXY_SUBPATH_LEN (COAP_OBSERVER_URL_LEN - sizeof("proxy"))
+
+/* Max-Age of the 5.03 returned while the value is fetched from the mote */
+#define PROXY_RETRY_MAX_AGE 2
+
+#if BORDER_ROUTER_CONF_UPLINK_BATCH
+/* The cloud requests a target once, at the registration of the mote: the
+ * relations lost since are restarted by the proxy itself */
+#ifndef COAP_PROXY_CONF_REOBSERVE_INTERVAL
+#define PROXY_REOBSERVE_INTERVAL (30 * CLOCK_SECOND)
+#else /* COAP_PROXY_CONF_REOBSERVE_INTERVAL */
+#define PROXY_REOBSERVE_INTERVAL COAP_PROXY_CONF_REOBSERVE_INTERVAL
+#endif /* COAP_PROXY_CONF_REOBSERVE_INTERVAL */
+
+static struct ctimer reobserve_timer;
+#endif /* BORDER_ROUTER_CONF_UPLINK_BATCH */
+
+typedef struct {
+  char subpath[PROXY_SUBPATH_LEN];
+  coap_endpoint_t endpoint;
+  coap_observee_t *observee;
+  uint8_t payload[PROXY_PAYLOAD_LEN];
+  uint16_t payload_len;
+  unsigned int content_format;
+  uint32_t max_age;
+  /* Time of the last value received from the mote */
+  clock_time_t updated;
+  /* Time of the last request, used to evict the least recently used entry */
+  clock_time_t last_used;
+  uint8_t in_use;
+  uint8_t valid;
+} proxy_entry_t;
+
+static proxy_entry_t entries[PROXY_ENTRIES];
+
+static void res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+PARENT_RESOURCE(res_proxy,
+                "title=\"VoltVault: proxy\";obs",
+                res_get_handler,
+                NULL,
+                NULL,
+                NULL);
+/*---------------------------------------------------------------------------*/
+static proxy_entry_t *
+lookup(const char *subpath, int len)
+{
+  int i;
+
+  for(i = 0; i < PROXY_ENTRIES; i++) {
+    if(entries[i].in_use && strlen(entries[i].subpath) == len &&
+       strncmp(entries[i].subpath, subpath, len) == 0) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Free entry, or the least recently used one */
+static proxy_entry_t *
+allocate(void)
+{
+  proxy_entry_t *lru = &entries[0];
+  int i;
+
+  for(i = 0; i < PROXY_ENTRIES; i++) {
+    if(!entries[i].in_use) {
+      return &entries[i];
+    }
+    if(entries[i].last_used < lru->last_used) {
+      lru = &entries[i];
+    }
+  }
+
+  LOG_INFO("Evicting %s\n", lru->subpath);
+  if(lru->observee != NULL) {
+    coap_obs_remove_observee(lru->observee);
+  }
+  lru->in_use = 0;
+  return lru;
+}
+/*---------------------------------------------------------------------------*/
+/* While the observe relation lives, the last notification is the current
+ * value of the resource (RFC 7641), whatever its Max-Age */
+static int
+is_fresh(const proxy_entry_t *e)
+{
+  return e->valid &&
+    (e->observee != NULL || clock_time() - e->updated < e->max_age * CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+/* Remaining Max-Age of the cached value, 0 once it only lives on the relation */
+static uint32_t
+remaining_max_age(const proxy_entry_t *e)
+{
+  clock_time_t age = (clock_time() - e->updated) / CLOCK_SECOND;
+
+  return age < e->max_age ? e->max_age - age : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+notification_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
+{
+  proxy_entry_t *e = (proxy_entry_t *)obs->data;
+  const uint8_t *payload = NULL;
+  int len;
+
+  switch(flag) {
+  case OBSERVE_OK:
+  case NOTIFICATION_OK:
+  case OBSERVE_NOT_SUPPORTED:
+    if(notification == NULL) {
+      break;
+    }
+    len = coap_get_payload(notification, &payload);
+    if(len > sizeof(e->payload)) {
+      LOG_WARN("Payload of %s too large: %d\n", e->subpath, len);
+      break;
+    }
+    memcpy(e->payload, payload, len);
+    e->payload_len = len;
+    if(!coap_get_header_content_format(notification, &e->content_format)) {
+      e->content_format = APPLICATION_JSON;
+    }
+    if(!coap_get_header_max_age(notification, &e->max_age)) {
+      e->max_age = COAP_DEFAULT_MAX_AGE;
+    }
+    e->updated = clock_time();
+    e->valid = 1;
+    if(flag == OBSERVE_NOT_SUPPORTED) {
+      /* Refetched when the value expires */
+      e->observee = NULL;
+    }
+    LOG_DBG("Updated %s\n", e->subpath);
+
+    /* Fan the new value out to the clients observing the target */
+    coap_notify_observers_sub(&res_proxy, e->subpath);
+#if BORDER_ROUTER_CONF_UPLINK_BATCH
+    /* and into the next pack for the cloud */
+    uplink_batch_add(e->subpath, e->payload, e->payload_len);
+#endif
+    break;
+  case ERROR_RESPONSE_CODE:
+  case NO_REPLY_FROM_SERVER:
+  default:
+    /* The observe client removes the relation, it is restarted on the
+     * next request once the cached value expires (periodically when the
+     * values are forwarded to the cloud) */
+    LOG_WARN("Observation of %s lost\n", e->subpath);
+    e->observee = NULL;
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+observe_mote(proxy_entry_t *e)
+{
+  char uri[64];
+  char *resource;
+  int ip_len;
+
+  /* subpath is "/<mote ip>/<resource>" */
+  resource = strchr(&e->subpath[1], '/');
+  if(resource == NULL) {
+    return 0;
+  }
+  ip_len = resource - &e->subpath[1];
+  resource++;
+
+  snprintf(uri, sizeof(uri), "coap://[%.*s]:5683", ip_len, &e->subpath[1]);
+  if(!coap_endpoint_parse(uri, strlen(uri), &e->endpoint)) {
+    return 0;
+  }
+
+  e->observee = coap_obs_request_registration(&e->endpoint, resource,
+                                              notification_callback, e);
+  return e->observee != NULL;
+}
+/*---------------------------------------------------------------------------*/
+#if BORDER_ROUTER_CONF_UPLINK_BATCH
+static void
+reobserve(void *ptr)
+{
+  int i;
+
+  for(i = 0; i < PROXY_ENTRIES; i++) {
+    if(entries[i].in_use && entries[i].observee == NULL) {
+      LOG_INFO("Observing %s again\n", entries[i].subpath);
+      /* Retried at the next round when the mote does not answer */
+      observe_mote(&entries[i]);
+    }
+  }
+  ctimer_reset(&reobserve_timer);
+}
+#endif /* BORDER_ROUTER_CONF_UPLINK_BATCH */
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  const char *url = NULL;
+  const char *subpath;
+  int len;
+  proxy_entry_t *e;
+
+  /* "proxy/<mote ip>/<resource>" */
+  len = coap_get_header_uri_path(request, &url);
+  subpath = url + strlen(res_proxy.url);
+  len -= subpath - url;
+  if(len <= 1 || len >= PROXY_SUBPATH_LEN || memchr(&subpath[1], '/', len - 1) == NULL) {
+    coap_set_status_code(response, BAD_REQUEST_4_00);
+    return;
+  }
+
+  e = lookup(subpath, len);
+  if(e == NULL) {
+    e = allocate();
+    memcpy(e->subpath, subpath, len);
+    e->subpath[len] = '\0';
+    e->observee = NULL;
+    e->valid = 0;
+    e->in_use = 1;
+    LOG_INFO("Caching %s\n", e->subpath);
+  }
+  e->last_used = clock_time();
+
+  if(!is_fresh(e)) {
+    /* First request, or the observe relation with the mote was lost */
+    if(e->observee == NULL && !observe_mote(e)) {
+      e->in_use = 0;
+      coap_set_status_code(response, BAD_GATEWAY_5_02);
+      return;
+    }
+    coap_set_status_code(response, SERVICE_UNAVAILABLE_5_03);
+    coap_set_header_max_age(response, PROXY_RETRY_MAX_AGE);
+    return;
+  }
+
+  coap_set_header_content_format(response, e->content_format);
+  coap_set_header_max_age(response, remaining_max_age(e));
+  coap_set_payload(response, e->payload, e->payload_len);
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_proxy_init(void)
+{
+  res_proxy.flags |= IS_OBSERVABLE;
+  coap_activate_resource(&res_proxy, "proxy");
+#if BORDER_ROUTER_CONF_UPLINK_BATCH
+  uplink_batch_init();
+  ctimer_set(&reobserve_timer, PROXY_REOBSERVE_INTERVAL, reobserve, NULL);
+#endif
+}
+/*---------------------------------------------------------------------------*/
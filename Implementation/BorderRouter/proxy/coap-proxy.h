@@ -0,0 +1,17 @@
+/**
+ * \file
+ *         CoAP proxy caching the resources of the motes on the border router
+ */
+
+#ifndef COAP_PROXY_H_
+#define COAP_PROXY_H_
+
+/*
+ * Activate the /proxy resource. A GET of /proxy/<mote ip>/<resource> is
+ * answered from the cache, which is kept up to date by a single observe
+ * relation with the mote, and clients observing it are notified whenever
+ * the mote sends a new value.
+ */
+void coap_proxy_init(void);
+
+#endif /* COAP_PROXY_H_ */
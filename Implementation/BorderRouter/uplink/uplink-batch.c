@@ -0,0 +1,143 @@
+/**
+ * \file
+ *         Aggregation of the notifications of the motes into SenML packs.
+ *
+ *         Instead of forwarding one datagram per notification, the border
+ *         router collects the SenML payloads received by the CoAP proxy
+ *         over a window and sends them to the cloud as a single pack, a
+ *         JSON array of the SenML payloads. The URI of the mote resource,
+ *         e.g. "coap://[fd00::202:2:2:2]/co/", is added to every payload in
+ *         the "src" field, so that the cloud can tell the sources apart;
+ *         the base name (the MAC address of the mote) is left untouched.
+ */
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "coap-transport.h"
+#include "sys/ctimer.h"
+#include "uplink-batch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "Uplink"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+/* Collector of the cloud application */
+#define UPLINK_BATCH_SERVER_URL "coap://[fd00::1]:5683"
+#define UPLINK_BATCH_RESOURCE "batch"
+
+/* Aggregation window, started by the first payload of the pack */
+#ifndef UPLINK_BATCH_CONF_WINDOW
+#define UPLINK_BATCH_WINDOW (CLOCK_SECOND / 2)
+#else /* UPLINK_BATCH_CONF_WINDOW */
+#define UPLINK_BATCH_WINDOW UPLINK_BATCH_CONF_WINDOW
+#endif /* UPLINK_BATCH_CONF_WINDOW */
+
+/* Maximum size of a pack */
+#ifndef UPLINK_BATCH_CONF_BUDGET
+#define UPLINK_BATCH_BUDGET 1024
+#else /* UPLINK_BATCH_CONF_BUDGET */
+#define UPLINK_BATCH_BUDGET UPLINK_BATCH_CONF_BUDGET
+#endif /* UPLINK_BATCH_CONF_BUDGET */
+
+/* Room for the CoAP header of the pack */
+#define UPLINK_BATCH_HEADER_LEN 64
+
+/* A full pack is sent in a single message */
+#if UPLINK_BATCH_BUDGET > COAP_MAX_CHUNK_SIZE
+#error "The CoAP chunk size (REST_MAX_CHUNK_SIZE) is smaller than the byte budget of the packs"
+#endif
+#if UIP_IPUDPH_LEN + UPLINK_BATCH_HEADER_LEN + UPLINK_BATCH_BUDGET > UIP_BUFSIZE
+#error "A full pack does not fit in the uIP buffer (UIP_CONF_BUFFER_SIZE)"
+#endif
+
+static coap_endpoint_t server;
+static coap_message_t message[1];
+static uint8_t packet[UPLINK_BATCH_HEADER_LEN + UPLINK_BATCH_BUDGET];
+
+static char pack[UPLINK_BATCH_BUDGET];
+static int pack_len;
+static int pack_payloads;
+static struct ctimer window_timer;
+
+static const char src_key[] = "\"src\":\"";
+/*---------------------------------------------------------------------------*/
+static void
+uplink_batch_flush(void *ptr)
+{
+  size_t packet_len;
+
+  ctimer_stop(&window_timer);
+  if(pack_payloads == 0) {
+    return;
+  }
+
+  pack[pack_len++] = ']';
+
+  coap_init_message(message, COAP_TYPE_NON, COAP_POST, coap_get_mid());
+  coap_set_header_uri_path(message, UPLINK_BATCH_RESOURCE);
+  coap_set_header_content_format(message, APPLICATION_JSON);
+  coap_set_payload(message, (uint8_t *)pack, pack_len);
+
+  packet_len = coap_serialize_message(message, packet);
+  if(packet_len == 0) {
+    LOG_ERR("Error in serializing the pack\n");
+  } else {
+    coap_sendto(&server, packet, packet_len);
+    LOG_DBG("Pack of %d payloads, %d bytes sent\n", pack_payloads, pack_len);
+  }
+
+  pack_len = 0;
+  pack_payloads = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+uplink_batch_add(const char *subpath, const uint8_t *payload, int len)
+{
+  const char *resource;
+  int ip_len;
+  int needed;
+
+  /* subpath is "/<mote ip>/<resource>", the payload holds at least a field */
+  resource = strchr(&subpath[1], '/');
+  if(resource == NULL || len < 3 || payload[0] != '{') {
+    return;
+  }
+  ip_len = resource - &subpath[1];
+
+  /* ',' or '[', '{', "src":"<URI of the resource>", the rest of the payload
+   and the closing ']' */
+  needed = 2 + sizeof(src_key) - 1
+    + snprintf(NULL, 0, "coap://[%.*s]%s/", ip_len, &subpath[1], resource)
+    + 2 + len - 1 + 1;
+  if(needed > UPLINK_BATCH_BUDGET) {
+    LOG_WARN("Payload of %s larger than the budget\n", subpath);
+    return;
+  }
+  if(pack_len + needed > UPLINK_BATCH_BUDGET) {
+    uplink_batch_flush(NULL);
+  }
+
+  pack[pack_len++] = pack_payloads == 0 ? '[' : ',';
+  pack[pack_len++] = '{';
+  pack_len += sprintf(&pack[pack_len], "%scoap://[%.*s]%s/\",",
+                      src_key, ip_len, &subpath[1], resource);
+  memcpy(&pack[pack_len], &payload[1], len - 1);
+  pack_len += len - 1;
+
+  if(pack_payloads++ == 0) {
+    ctimer_set(&window_timer, UPLINK_BATCH_WINDOW, uplink_batch_flush, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uplink_batch_init(void)
+{
+  coap_endpoint_parse(UPLINK_BATCH_SERVER_URL, strlen(UPLINK_BATCH_SERVER_URL), &server);
+  pack_len = 0;
+  pack_payloads = 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,21 @@
+/**
+ * \file
+ *         Aggregation of the notifications of the motes into SenML packs
+ *         sent to the cloud
+ */
+
+#ifndef UPLINK_BATCH_H_
+#define UPLINK_BATCH_H_
+
+#include <stdint.h>
+
+void uplink_batch_init(void);
+
+/*
+ * Add the SenML payload notified by the mote resource "/<mote ip>/<resource>"
+ * to the current pack. The pack is sent when the aggregation window expires,
+ * or earlier when the payload does not fit in the byte budget.
+ */
+void uplink_batch_add(const char *subpath, const uint8_t *payload, int len);
+
+#endif /* UPLINK_BATCH_H_ */
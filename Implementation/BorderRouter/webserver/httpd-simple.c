@@ -41,7 +41,9 @@
 #include "contiki-net.h"
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 
 #include "httpd-simple.h"
 #define webserver_log_file(...)
@@ -62,9 +64,17 @@
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
+#define METHOD_GET  0
+#define METHOD_HEAD 1
+
 MEMB(conns, struct httpd_state, CONNS);
 
+const char http_11[] = "HTTP/1.1";
+const char http_status_200[] = "200 OK";
+const char http_status_404[] = "404 Not found";
+
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
@@ -87,68 +97,143 @@ PT_THREAD(send_string(struct httpd_state *s, const char *str))
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
-const char http_content_type_html[] = "Content-type: text/html\r\n\r\n";
-static
-PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+void
+httpd_simple_add(struct httpd_state *s, const char *fmt, ...)
+{
+  va_list ap;
+  int len;
+
+  va_start(ap, fmt);
+  len = vsnprintf(&s->outputbuf[HTTPD_CHUNK_HEADER_LEN + s->blen],
+                  HTTPD_BODY_SIZE - s->blen, fmt, ap);
+  va_end(ap);
+
+  if(len > 0) {
+    s->blen += len;
+  }
+  /* Truncated entry */
+  if(s->blen >= HTTPD_BODY_SIZE) {
+    s->blen = HTTPD_BODY_SIZE - 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+httpd_simple_frame(struct httpd_state *s, int last)
 {
-  /* char *ptr; */
+  char header[HTTPD_CHUNK_HEADER_LEN + 1];
+  int len;
 
+  s->frame_start = HTTPD_CHUNK_HEADER_LEN;
+  s->frame_len = s->blen;
+  if(!s->chunked) {
+    return;
+  }
+
+  if(s->blen > 0) {
+    len = snprintf(header, sizeof(header), "%x\r\n", s->blen);
+    s->frame_start = HTTPD_CHUNK_HEADER_LEN - len;
+    memcpy(&s->outputbuf[s->frame_start], header, len);
+    memcpy(&s->outputbuf[HTTPD_CHUNK_HEADER_LEN + s->blen], "\r\n", 2);
+    s->frame_len = len + s->blen + 2;
+  }
+  if(last) {
+    /* The last chunk is sent in the same segment as the end of the body */
+    memcpy(&s->outputbuf[s->frame_start + s->frame_len], "0\r\n\r\n", 5);
+    s->frame_len += 5;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct httpd_simple_route *
+get_route(const char *path)
+{
+  const struct httpd_simple_route *route;
+
+  for(route = httpd_simple_routes; route->path != NULL; route++) {
+    if(strcmp(route->path, path) == 0) {
+      return route;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_headers(struct httpd_state *s, const char *status))
+{
   PSOCK_BEGIN(&s->sout);
 
-  SEND_STRING(&s->sout, statushdr);
-
-  /* ptr = strrchr(s->filename, ISO_period); */
-  /* if(ptr == NULL) { */
-  /*   s->ptr = http_content_type_plain; */
-  /* } else if(strcmp(http_html, ptr) == 0) { */
-  /*   s->ptr = http_content_type_html; */
-  /* } else if(strcmp(http_css, ptr) == 0) { */
-  /*   s->ptr = http_content_type_css; */
-  /* } else if(strcmp(http_png, ptr) == 0) { */
-  /*   s->ptr = http_content_type_png; */
-  /* } else if(strcmp(http_gif, ptr) == 0) { */
-  /*   s->ptr = http_content_type_gif; */
-  /* } else if(strcmp(http_jpg, ptr) == 0) { */
-  /*   s->ptr = http_content_type_jpg; */
-  /* } else { */
-  /*   s->ptr = http_content_type_binary; */
-  /* } */
-  /* SEND_STRING(&s->sout, s->ptr); */
-  SEND_STRING(&s->sout, http_content_type_html);
+  s->frame_len = snprintf(s->outputbuf, sizeof(s->outputbuf),
+                          "%s %s\r\n"
+                          "Server: Contiki/2.4 http://www.sics.se/contiki/\r\n"
+                          "Connection: %s\r\n",
+                          http_11, status,
+                          s->keep_alive ? "keep-alive" : "close");
+  if(s->route == NULL) {
+    s->frame_len += snprintf(&s->outputbuf[s->frame_len],
+                             sizeof(s->outputbuf) - s->frame_len,
+                             "Content-Length: %u\r\n"
+                             "Content-type: text/html\r\n\r\n",
+                             (unsigned)strlen(NOT_FOUND));
+  } else {
+    s->frame_len += snprintf(&s->outputbuf[s->frame_len],
+                             sizeof(s->outputbuf) - s->frame_len,
+                             "%sContent-type: %s\r\n\r\n",
+                             s->chunked ? "Transfer-Encoding: chunked\r\n" : "",
+                             s->route->content_type);
+  }
+  PSOCK_SEND(&s->sout, (uint8_t *)s->outputbuf, s->frame_len);
+
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
-const char http_header_200[] = "HTTP/1.0 200 OK\r\nServer: Contiki/2.4 http://www.sics.se/contiki/\r\nConnection: close\r\n";
-const char http_header_404[] = "HTTP/1.0 404 Not found\r\nServer: Contiki/2.4 http://www.sics.se/contiki/\r\nConnection: close\r\n";
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
   PT_BEGIN(&s->outputpt);
 
-  s->script = NULL;
-  s->script = httpd_simple_get_script(&s->filename[1]);
-  if(s->script == NULL) {
+  s->route = get_route(s->filename);
+  if(++s->requests >= HTTPD_MAX_REQUESTS) {
+    s->keep_alive = 0;
+  }
+  /* Without keep-alive the end of the body is the end of the connection */
+  s->chunked = s->keep_alive && s->route != NULL;
+
+  if(s->route == NULL) {
     strncpy(s->filename, "/notfound.html", sizeof(s->filename) - 1);
     s->filename[sizeof(s->filename) - 1] = '\0';
     PT_WAIT_THREAD(&s->outputpt,
-                   send_headers(s, http_header_404));
-    PT_WAIT_THREAD(&s->outputpt,
-                   send_string(s, NOT_FOUND));
-    uip_close();
+                   send_headers(s, http_status_404));
+    if(s->method == METHOD_GET) {
+      PT_WAIT_THREAD(&s->outputpt,
+                     send_string(s, NOT_FOUND));
+    }
     webserver_log_file(&uip_conn->ripaddr, "404 - not found");
-    PT_EXIT(&s->outputpt);
   } else {
     PT_WAIT_THREAD(&s->outputpt,
-                   send_headers(s, http_header_200));
-    PT_WAIT_THREAD(&s->outputpt, s->script(s));
+                   send_headers(s, http_status_200));
+    if(s->method == METHOD_GET) {
+      s->blen = 0;
+      s->iter = NULL;
+      s->section = 0;
+      s->entries = 0;
+      PT_WAIT_THREAD(&s->outputpt, s->route->script(s));
+    }
+  }
+  s->route = NULL;
+
+  if(s->keep_alive) {
+    /* Wait for the next request on the same connection */
+    s->state = STATE_WAITING;
+    PT_INIT(&s->sin.pt);
+  } else {
+    PSOCK_CLOSE(&s->sout);
   }
-  s->script = NULL;
-  PSOCK_CLOSE(&s->sout);
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
 const char http_get[] = "GET ";
+const char http_head[] = "HEAD ";
 const char http_index_html[] = "/index.html";
+const char http_connection_close[] = "Connection: close";
 
 static
 PT_THREAD(handle_input(struct httpd_state *s))
@@ -157,7 +242,11 @@ PT_THREAD(handle_input(struct httpd_state *s))
 
   PSOCK_READTO(&s->sin, ISO_space);
 
-  if(strncmp(s->inputbuf, http_get, 4) != 0) {
+  if(strncmp(s->inputbuf, http_get, sizeof(http_get) - 1) == 0) {
+    s->method = METHOD_GET;
+  } else if(strncmp(s->inputbuf, http_head, sizeof(http_head) - 1) == 0) {
+    s->method = METHOD_HEAD;
+  } else {
     PSOCK_CLOSE_EXIT(&s->sin);
   }
   PSOCK_READTO(&s->sin, ISO_space);
@@ -182,18 +271,32 @@ PT_THREAD(handle_input(struct httpd_state *s))
 
   webserver_log_file(&uip_conn->ripaddr, s->filename);
 
-  s->state = STATE_OUTPUT;
+  /* HTTP/1.1 connections are kept alive unless the client closes them */
+  PSOCK_READTO(&s->sin, ISO_nl);
+  s->keep_alive = strncmp(s->inputbuf, http_11, sizeof(http_11) - 1) == 0;
 
+  /* Read the headers up to the empty line. Lines longer than the input */
+  /* buffer are read in pieces, only the start of a line is a header name */
+  s->line_complete = 1;
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
-#if 0
-    if(strncmp(s->inputbuf, http_referer, 8) == 0) {
-      s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
-      webserver_log(s->inputbuf);
+    if(s->line_complete) {
+      if(s->inputbuf[0] == ISO_cr || s->inputbuf[0] == ISO_nl) {
+        break;
+      }
+      if(strncasecmp(s->inputbuf, http_connection_close,
+                     sizeof(http_connection_close) - 1) == 0) {
+        s->keep_alive = 0;
+      }
     }
-#endif
+    s->line_complete = s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] == ISO_nl;
   }
 
+  s->state = STATE_OUTPUT;
+
+  /* The next request is read once the response has been sent */
+  PSOCK_WAIT_UNTIL(&s->sin, s->state != STATE_OUTPUT);
+
   PSOCK_END(&s->sin);
 }
 /*---------------------------------------------------------------------------*/
@@ -213,7 +316,7 @@ httpd_appcall(void *state)
 
   if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
-      s->script = NULL;
+      s->route = NULL;
       memb_free(&conns, s);
     }
   } else if(uip_connected()) {
@@ -224,10 +327,11 @@ httpd_appcall(void *state)
       return;
     }
     tcp_markconn(uip_conn, s);
+    s->requests = 0;
     PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
-    s->script = NULL;
+    s->route = NULL;
     s->state = STATE_WAITING;
     timer_set(&s->timer, CLOCK_SECOND * 10);
     handle_connection(s);
@@ -235,7 +339,7 @@ httpd_appcall(void *state)
     if(uip_poll()) {
       if(timer_expired(&s->timer)) {
         uip_abort();
-        s->script = NULL;
+        s->route = NULL;
         memb_free(&conns, s);
         webserver_log_file(&uip_conn->ripaddr, "reset (timeout)");
       }
@@ -42,32 +42,91 @@
 
 #include "contiki-net.h"
 
-/* The current internal border router webserver ignores the requested file name */
-/* and needs no per-connection output buffer, so save some RAM */
+/* The file names served by the border router webserver are short, */
+/* so save some RAM */
 #ifndef WEBSERVER_CONF_CFS_PATHLEN
 #define HTTPD_PATHLEN 16
 #else /* WEBSERVER_CONF_CFS_CONNS */
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Pages are generated in a per-connection buffer, so that concurrent */
+/* connections do not interleave, and sent a full TCP segment at a time */
+#ifndef WEBSERVER_CONF_OUTBUF_SIZE
+#define HTTPD_OUTBUF_SIZE UIP_TCP_MSS
+#else /* WEBSERVER_CONF_OUTBUF_SIZE */
+#define HTTPD_OUTBUF_SIZE WEBSERVER_CONF_OUTBUF_SIZE
+#endif /* WEBSERVER_CONF_OUTBUF_SIZE */
+
+/* Requests served on a kept-alive connection before closing it, so that */
+/* idle clients do not hold the few connections forever */
+#ifndef WEBSERVER_CONF_MAX_REQUESTS
+#define HTTPD_MAX_REQUESTS 16
+#else /* WEBSERVER_CONF_MAX_REQUESTS */
+#define HTTPD_MAX_REQUESTS WEBSERVER_CONF_MAX_REQUESTS
+#endif /* WEBSERVER_CONF_MAX_REQUESTS */
+
+/* On kept-alive connections the body is sent with the chunked encoding: */
+/* the scripts write it between the room left for the chunk header */
+/* ("xxxx\r\n") and the room for the chunk trailer and the last chunk */
+#define HTTPD_CHUNK_HEADER_LEN  6
+#define HTTPD_CHUNK_TRAILER_LEN 7
+#define HTTPD_BODY_SIZE (HTTPD_OUTBUF_SIZE - HTTPD_CHUNK_HEADER_LEN - HTTPD_CHUNK_TRAILER_LEN)
+
 struct httpd_state;
 typedef char (*httpd_simple_script_t)(struct httpd_state *s);
 
+/* Page served by the webserver */
+struct httpd_simple_route {
+  const char *path;
+  httpd_simple_script_t script;
+  const char *content_type;
+};
+
+/* Routes of the webserver, terminated by an entry with a NULL path */
+extern const struct httpd_simple_route httpd_simple_routes[];
+
 struct httpd_state {
   struct timer timer;
   struct psock sin, sout;
   struct pt outputpt;
   char inputbuf[HTTPD_PATHLEN + 24];
-/*char outputbuf[UIP_TCP_MSS]; */
+  char outputbuf[HTTPD_OUTBUF_SIZE];
+  int blen;
+  uint16_t frame_start;
+  uint16_t frame_len;
   char filename[HTTPD_PATHLEN];
-  httpd_simple_script_t script;
+  const struct httpd_simple_route *route;
+  /* Iteration state of the script, which must survive across segments */
+  void *iter;
+  uint8_t section;
+  uint8_t entries;
+  uint8_t requests;
+  char method;
+  char keep_alive;
+  char chunked;
+  char line_complete;
   char state;
 };
 
 void httpd_init(void);
 void httpd_appcall(void *state);
 
-httpd_simple_script_t httpd_simple_get_script(const char *name);
+/* Append to the body of the response */
+void httpd_simple_add(struct httpd_state *s, const char *fmt, ...);
+/* Prepare the body written so far to be sent, as a chunk if needed */
+void httpd_simple_frame(struct httpd_state *s, int last);
+
+#define HTTPD_SEND_BODY(s, last) do {                                   \
+    httpd_simple_frame(s, last);                                        \
+    PSOCK_SEND(&(s)->sout, (uint8_t *)&(s)->outputbuf[(s)->frame_start], \
+               (s)->frame_len);                                         \
+    (s)->blen = 0;                                                      \
+  } while(0)
+/* Send the body written so far */
+#define HTTPD_SEND(s) HTTPD_SEND_BODY(s, 0)
+/* Send the rest of the body, terminating the response */
+#define HTTPD_SEND_LAST(s) HTTPD_SEND_BODY(s, 1)
 
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, strlen(str))
 
@@ -35,32 +35,43 @@
 #include "net/ipv6/uip-ds6-nbr.h"
 #include "net/ipv6/uip-ds6-route.h"
 #include "net/ipv6/uip-sr.h"
+#include "net/link-stats.h"
 
 #include <stdio.h>
 #include <string.h>
 
+/* Use simple webserver with a few pages for minimum footprint.
+ * Each connection generates its pages in its own output buffer,
+ * so concurrent connections do not interleave. The pages are
+ * listed in httpd_simple_routes at the end of this file.
+ */
+#include "httpd-simple.h"
+
 /*---------------------------------------------------------------------------*/
 static const char *TOP = "<html>\n  <head>\n    <title>Contiki-NG</title>\n  </head>\n<body>\n";
 static const char *BOTTOM = "\n</body>\n</html>\n";
-static char buf[256];
-static int blen;
-#define ADD(...) do {                                                   \
-    blen += snprintf(&buf[blen], sizeof(buf) - blen, __VA_ARGS__);      \
+
+/* Upper bound of the length of a single entry (list item, JSON object or
+ * metric line). The body is sent only when another entry may not fit,
+ * so that each TCP segment carries as many entries as possible. */
+#define ENTRY_MAX_LEN 160
+
+#define ADD(s, ...) httpd_simple_add(s, __VA_ARGS__)
+#define SEND_IF_FULL(s) do {                                            \
+    if(HTTPD_BODY_SIZE - (s)->blen < ENTRY_MAX_LEN) {                   \
+      HTTPD_SEND(s);                                                    \
+    }                                                                   \
+  } while(0)
+/* Separator between the elements of a JSON array */
+#define ADD_SEPARATOR(s) do {                                           \
+    if((s)->entries++ > 0) {                                            \
+      ADD(s, ",");                                                      \
+    }                                                                   \
   } while(0)
-#define SEND(s) do { \
-  SEND_STRING(s, buf); \
-  blen = 0; \
-} while(0);
-
-/* Use simple webserver with only one page for minimum footprint.
- * Multiple connections can result in interleaved tcp segments since
- * a single static buffer is used for all segments.
- */
-#include "httpd-simple.h"
 
 /*---------------------------------------------------------------------------*/
 static void
-ipaddr_add(const uip_ipaddr_t *addr)
+ipaddr_add(struct httpd_state *s, const uip_ipaddr_t *addr)
 {
   uint16_t a;
   int i, f;
@@ -68,65 +79,156 @@ ipaddr_add(const uip_ipaddr_t *addr)
     a = (addr->u8[i] << 8) + addr->u8[i + 1];
     if(a == 0 && f >= 0) {
       if(f++ == 0) {
-        ADD("::");
+        ADD(s, "::");
       }
     } else {
       if(f > 0) {
         f = -1;
       } else if(i > 0) {
-        ADD(":");
+        ADD(s, ":");
       }
-      ADD("%x", a);
+      ADD(s, "%x", a);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+static const struct link_stats *
+nbr_link_stats(const uip_ds6_nbr_t *nbr)
+{
+  return link_stats_from_lladdr((const linkaddr_t *)uip_ds6_nbr_get_ll(nbr));
+}
+/*---------------------------------------------------------------------------*/
+/* Per-neighbor metrics, exported as one group of lines per metric */
+enum {
+  NBR_METRIC_ETX,
+  NBR_METRIC_RSSI,
+  NBR_METRIC_FRESHNESS,
+  NBR_METRIC_LAST_TX,
+#if LINK_STATS_PACKET_COUNTERS
+  NBR_METRIC_PACKETS_TX,
+  NBR_METRIC_PACKETS_ACKED,
+  NBR_METRIC_PACKETS_RX,
+#endif /* LINK_STATS_PACKET_COUNTERS */
+  NBR_METRIC_NUM
+};
+
+static const struct {
+  const char *name;
+  const char *type;
+} nbr_metrics[NBR_METRIC_NUM] = {
+  { "etx", "gauge" },
+  { "rssi_dbm", "gauge" },
+  { "freshness", "gauge" },
+  { "last_tx_seconds", "gauge" },
+#if LINK_STATS_PACKET_COUNTERS
+  { "packets_tx_total", "counter" },
+  { "packets_acked_total", "counter" },
+  { "packets_rx_total", "counter" },
+#endif /* LINK_STATS_PACKET_COUNTERS */
+};
+/*---------------------------------------------------------------------------*/
+static void
+add_nbr_metric(struct httpd_state *s, const uip_ds6_nbr_t *nbr, int metric)
+{
+  const struct link_stats *stats = nbr_link_stats(nbr);
+
+  if(stats == NULL) {
+    return;
+  }
+
+  ADD(s, "br_neighbor_%s{ip=\"", nbr_metrics[metric].name);
+  ipaddr_add(s, &nbr->ipaddr);
+  ADD(s, "\"} ");
+
+  switch(metric) {
+  case NBR_METRIC_ETX:
+    ADD(s, "%u.%02u\n", stats->etx / LINK_STATS_ETX_DIVISOR,
+        (stats->etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR);
+    break;
+  case NBR_METRIC_RSSI:
+    ADD(s, "%d\n", stats->rssi);
+    break;
+  case NBR_METRIC_FRESHNESS:
+    ADD(s, "%u\n", stats->freshness);
+    break;
+  case NBR_METRIC_LAST_TX:
+    ADD(s, "%lu\n", (unsigned long)((clock_time() - stats->last_tx_time) / CLOCK_SECOND));
+    break;
+#if LINK_STATS_PACKET_COUNTERS
+  case NBR_METRIC_PACKETS_TX:
+    ADD(s, "%lu\n", (unsigned long)stats->cnt_total.num_packets_tx);
+    break;
+  case NBR_METRIC_PACKETS_ACKED:
+    ADD(s, "%lu\n", (unsigned long)stats->cnt_total.num_packets_acked);
+    break;
+  case NBR_METRIC_PACKETS_RX:
+    ADD(s, "%lu\n", (unsigned long)stats->cnt_total.num_packets_rx);
+    break;
+#endif /* LINK_STATS_PACKET_COUNTERS */
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_nbr_json(struct httpd_state *s, const uip_ds6_nbr_t *nbr)
+{
+  const struct link_stats *stats = nbr_link_stats(nbr);
+
+  ADD(s, "{\"ip\":\"");
+  ipaddr_add(s, &nbr->ipaddr);
+  ADD(s, "\"");
+  if(stats != NULL) {
+    ADD(s, ",\"etx\":%u.%02u,\"rssi\":%d,\"freshness\":%u,\"last_tx\":%lu",
+        stats->etx / LINK_STATS_ETX_DIVISOR,
+        (stats->etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR,
+        stats->rssi, stats->freshness,
+        (unsigned long)((clock_time() - stats->last_tx_time) / CLOCK_SECOND));
+#if LINK_STATS_PACKET_COUNTERS
+    ADD(s, ",\"tx\":%lu,\"acked\":%lu,\"rx\":%lu",
+        (unsigned long)stats->cnt_total.num_packets_tx,
+        (unsigned long)stats->cnt_total.num_packets_acked,
+        (unsigned long)stats->cnt_total.num_packets_rx);
+#endif /* LINK_STATS_PACKET_COUNTERS */
+  }
+  ADD(s, "}");
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(generate_routes(struct httpd_state *s))
 {
-  static uip_ds6_nbr_t *nbr;
-
   PSOCK_BEGIN(&s->sout);
-  SEND_STRING(&s->sout, TOP);
-
-  ADD("  Neighbors\n  <ul>\n");
-  SEND(&s->sout);
-  for(nbr = uip_ds6_nbr_head();
-      nbr != NULL;
-      nbr = uip_ds6_nbr_next(nbr)) {
-    ADD("    <li>");
-    ipaddr_add(&nbr->ipaddr);
-    ADD("</li>\n");
-    SEND(&s->sout);
+
+  ADD(s, "%s", TOP);
+  ADD(s, "  Neighbors\n  <ul>\n");
+  for(s->iter = uip_ds6_nbr_head();
+      s->iter != NULL;
+      s->iter = uip_ds6_nbr_next(s->iter)) {
+    ADD(s, "    <li>");
+    ipaddr_add(s, &((uip_ds6_nbr_t *)s->iter)->ipaddr);
+    ADD(s, "</li>\n");
+    SEND_IF_FULL(s);
   }
-  ADD("  </ul>\n");
-  SEND(&s->sout);
+  ADD(s, "  </ul>\n");
 
 #if (UIP_MAX_ROUTES != 0)
-  {
-    static uip_ds6_route_t *r;
-    ADD("  Routes\n  <ul>\n");
-    SEND(&s->sout);
-    for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
-      ADD("    <li>");
-      ipaddr_add(&r->ipaddr);
-      ADD("/%u (via ", r->length);
-      ipaddr_add(uip_ds6_route_nexthop(r));
-      ADD(") %lus", (unsigned long)r->state.lifetime);
-      ADD("</li>\n");
-      SEND(&s->sout);
-    }
-    ADD("  </ul>\n");
-    SEND(&s->sout);
+  ADD(s, "  Routes\n  <ul>\n");
+  for(s->iter = uip_ds6_route_head(); s->iter != NULL; s->iter = uip_ds6_route_next(s->iter)) {
+    uip_ds6_route_t *r = s->iter;
+    ADD(s, "    <li>");
+    ipaddr_add(s, &r->ipaddr);
+    ADD(s, "/%u (via ", r->length);
+    ipaddr_add(s, uip_ds6_route_nexthop(r));
+    ADD(s, ") %lus", (unsigned long)r->state.lifetime);
+    ADD(s, "</li>\n");
+    SEND_IF_FULL(s);
   }
+  ADD(s, "  </ul>\n");
 #endif /* UIP_MAX_ROUTES != 0 */
 
 #if (UIP_SR_LINK_NUM != 0)
   if(uip_sr_num_nodes() > 0) {
-    static uip_sr_node_t *link;
-    ADD("  Routing links\n  <ul>\n");
-    SEND(&s->sout);
-    for(link = uip_sr_node_head(); link != NULL; link = uip_sr_node_next(link)) {
+    ADD(s, "  Routing links\n  <ul>\n");
+    for(s->iter = uip_sr_node_head(); s->iter != NULL; s->iter = uip_sr_node_next(s->iter)) {
+      uip_sr_node_t *link = s->iter;
       if(link->parent != NULL) {
         uip_ipaddr_t child_ipaddr;
         uip_ipaddr_t parent_ipaddr;
@@ -134,23 +236,117 @@ PT_THREAD(generate_routes(struct httpd_state *s))
         NETSTACK_ROUTING.get_sr_node_ipaddr(&child_ipaddr, link);
         NETSTACK_ROUTING.get_sr_node_ipaddr(&parent_ipaddr, link->parent);
 
-        ADD("    <li>");
-        ipaddr_add(&child_ipaddr);
+        ADD(s, "    <li>");
+        ipaddr_add(s, &child_ipaddr);
 
-        ADD(" (parent: ");
-        ipaddr_add(&parent_ipaddr);
-        ADD(") %us", (unsigned int)link->lifetime);
+        ADD(s, " (parent: ");
+        ipaddr_add(s, &parent_ipaddr);
+        ADD(s, ") %us", (unsigned int)link->lifetime);
 
-        ADD("</li>\n");
-        SEND(&s->sout);
+        ADD(s, "</li>\n");
       }
+      SEND_IF_FULL(s);
+    }
+    ADD(s, "  </ul>");
+  }
+#endif /* UIP_SR_LINK_NUM != 0 */
+
+  ADD(s, "%s", BOTTOM);
+  HTTPD_SEND_LAST(s);
+
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+/* Prometheus text exposition format */
+static
+PT_THREAD(generate_metrics(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  ADD(s, "# TYPE br_uptime_seconds counter\nbr_uptime_seconds %lu\n",
+      (unsigned long)clock_seconds());
+  ADD(s, "# TYPE br_neighbors gauge\nbr_neighbors %u\n",
+      (unsigned)uip_ds6_nbr_num());
+#if (UIP_MAX_ROUTES != 0)
+  ADD(s, "# TYPE br_routes gauge\nbr_routes %u\n",
+      (unsigned)uip_ds6_route_num_routes());
+#endif /* UIP_MAX_ROUTES != 0 */
+#if (UIP_SR_LINK_NUM != 0)
+  ADD(s, "# TYPE br_routing_nodes gauge\nbr_routing_nodes %u\n",
+      (unsigned)uip_sr_num_nodes());
+#endif /* UIP_SR_LINK_NUM != 0 */
+  SEND_IF_FULL(s);
+
+  for(s->section = 0; s->section < NBR_METRIC_NUM; s->section++) {
+    ADD(s, "# TYPE br_neighbor_%s %s\n",
+        nbr_metrics[s->section].name, nbr_metrics[s->section].type);
+    for(s->iter = uip_ds6_nbr_head();
+        s->iter != NULL;
+        s->iter = uip_ds6_nbr_next(s->iter)) {
+      add_nbr_metric(s, s->iter, s->section);
+      SEND_IF_FULL(s);
     }
-    ADD("  </ul>");
-    SEND(&s->sout);
+  }
+
+  HTTPD_SEND_LAST(s);
+
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(generate_topology(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  ADD(s, "{\"uptime\":%lu,\"neighbors\":[", (unsigned long)clock_seconds());
+  for(s->iter = uip_ds6_nbr_head();
+      s->iter != NULL;
+      s->iter = uip_ds6_nbr_next(s->iter)) {
+    ADD_SEPARATOR(s);
+    add_nbr_json(s, s->iter);
+    SEND_IF_FULL(s);
+  }
+  ADD(s, "],\"routes\":[");
+
+#if (UIP_MAX_ROUTES != 0)
+  s->entries = 0;
+  for(s->iter = uip_ds6_route_head(); s->iter != NULL; s->iter = uip_ds6_route_next(s->iter)) {
+    uip_ds6_route_t *r = s->iter;
+    ADD_SEPARATOR(s);
+    ADD(s, "{\"ip\":\"");
+    ipaddr_add(s, &r->ipaddr);
+    ADD(s, "\",\"length\":%u,\"via\":\"", r->length);
+    ipaddr_add(s, uip_ds6_route_nexthop(r));
+    ADD(s, "\",\"lifetime\":%lu}", (unsigned long)r->state.lifetime);
+    SEND_IF_FULL(s);
+  }
+#endif /* UIP_MAX_ROUTES != 0 */
+  ADD(s, "],\"links\":[");
+
+#if (UIP_SR_LINK_NUM != 0)
+  s->entries = 0;
+  for(s->iter = uip_sr_node_head(); s->iter != NULL; s->iter = uip_sr_node_next(s->iter)) {
+    uip_sr_node_t *link = s->iter;
+    if(link->parent != NULL) {
+      uip_ipaddr_t child_ipaddr;
+      uip_ipaddr_t parent_ipaddr;
+
+      NETSTACK_ROUTING.get_sr_node_ipaddr(&child_ipaddr, link);
+      NETSTACK_ROUTING.get_sr_node_ipaddr(&parent_ipaddr, link->parent);
+
+      ADD_SEPARATOR(s);
+      ADD(s, "{\"child\":\"");
+      ipaddr_add(s, &child_ipaddr);
+      ADD(s, "\",\"parent\":\"");
+      ipaddr_add(s, &parent_ipaddr);
+      ADD(s, "\",\"lifetime\":%u}", (unsigned int)link->lifetime);
+    }
+    SEND_IF_FULL(s);
   }
 #endif /* UIP_SR_LINK_NUM != 0 */
+  ADD(s, "]}\n");
 
-  SEND_STRING(&s->sout, BOTTOM);
+  HTTPD_SEND_LAST(s);
 
   PSOCK_END(&s->sout);
 }
@@ -170,9 +366,10 @@ PROCESS_THREAD(webserver_nogui_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
-httpd_simple_script_t
-httpd_simple_get_script(const char *name)
-{
-  return generate_routes;
-}
+const struct httpd_simple_route httpd_simple_routes[] = {
+  { "/index.html", generate_routes, "text/html" },
+  { "/metrics", generate_metrics, "text/plain; version=0.0.4" },
+  { "/topology.json", generate_topology, "application/json" },
+  { NULL, NULL, NULL }
+};
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,55 @@
+/*
+ * Random forest of the HVAC (MachineLearning/machine_learning.h) compiled
+ * for the host and exposed to the Java Application through JNI, to run the
+ * prediction of the nodes on the values of all the rooms in a single call.
+ */
+
+#include <jni.h>
+#include <stdint.h>
+
+#include "machine_learning.h"
+
+// Features of a room, in the order of res-hvac.c: temperature, humidity, CO
+#define NUM_FEATURES 3
+
+/*
+ * Class:     it_unipi_iot_Server_Shadow_HvacModel
+ * Method:    predict
+ * Signature: ([FI[Z)V
+ *
+ * Predicts the status of the HVAC of the first rows of the features
+ * (NUM_FEATURES per row): true (ON) if the room is not habitable.
+ */
+JNIEXPORT void JNICALL
+Java_it_unipi_iot_Server_Shadow_HvacModel_predict(JNIEnv *env, jclass class, jfloatArray features,
+                                                  jint rows, jbooleanArray hvac)
+{
+    (void) class;
+
+    if (rows <= 0) {
+        return;
+    }
+    if ((*env)->GetArrayLength(env, features) < rows * NUM_FEATURES || (*env)->GetArrayLength(env, hvac) < rows) {
+        jclass exception = (*env)->FindClass(env, "java/lang/IllegalArgumentException");
+        (*env)->ThrowNew(env, exception, "Arrays shorter than the rows");
+        return;
+    }
+
+    // The arrays are pinned without copies: no JNI call until they are released
+    jfloat *input = (*env)->GetPrimitiveArrayCritical(env, features, NULL);
+    jboolean *output = (*env)->GetPrimitiveArrayCritical(env, hvac, NULL);
+    if (input == NULL || output == NULL) {
+        if (input != NULL) {
+            (*env)->ReleasePrimitiveArrayCritical(env, features, input, JNI_ABORT);
+        }
+        return;
+    }
+
+    for (jint row = 0; row < rows; row++) {
+        // 1: habitable, 0: not habitable (HVAC ON)
+        output[row] = machine_learning_predict(input + row * NUM_FEATURES, NUM_FEATURES) == 0;
+    }
+
+    (*env)->ReleasePrimitiveArrayCritical(env, hvac, output, 0);
+    (*env)->ReleasePrimitiveArrayCritical(env, features, input, JNI_ABORT);
+}
@@ -1,6 +1,9 @@
 package it.unipi.iot;
 
 import it.unipi.iot.Server.CoAPServer;
+import it.unipi.iot.Server.Driver.Partitions;
+import it.unipi.iot.Server.Live.LiveServer;
+import it.unipi.iot.Server.Shadow.ShadowController;
 
 import it.unipi.iot.UserApplication.UserApplication;
 
@@ -10,6 +13,13 @@ public class Main {
 
         System.out.println("Starting the Java Server...");
 
+        // Monthly partitions of the sensor tables
+        Partitions.start();
+        // Shadow predictions of the HVACs (-Dshadow.library)
+        ShadowController.start();
+        // Feed of the live dashboards (-Dlive.port)
+        LiveServer.start();
+
         CoAPServer server = new CoAPServer();
         // Starting the CoAP Server
         server.start();
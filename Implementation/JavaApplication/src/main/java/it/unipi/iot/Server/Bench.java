@@ -0,0 +1,33 @@
+package it.unipi.iot.Server;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+
+
+// Log of the stages reached in the cloud, read by Simulation/benchmark.py.
+// Enabled with -Dbench.log=<file>, one line per stage: wall clock (ms), stage, resource, room
+public class Bench {
+
+    private static final String path = System.getProperty("bench.log");
+    private static PrintWriter writer;
+
+    public static boolean enabled() {
+        return path != null;
+    }
+
+    public static synchronized void stage(String stage, String resource, int room) {
+        if (path == null) {
+            return;
+        }
+        try {
+            if (writer == null) {
+                writer = new PrintWriter(new FileWriter(path, true), true);
+            }
+            writer.println(System.currentTimeMillis() + "," + stage + "," + resource + "," + room);
+        } catch (IOException e) {
+            e.printStackTrace();
+        }
+    }
+
+}
@@ -0,0 +1,93 @@
+package it.unipi.iot.Server;
+
+import com.google.gson.JsonArray;
+import com.google.gson.JsonElement;
+import com.google.gson.JsonObject;
+import com.google.gson.JsonParser;
+import it.unipi.iot.Server.Ingest.IngestPipeline;
+import it.unipi.iot.Server.Ingest.IngestRecord;
+import it.unipi.iot.Server.Live.LiveCache;
+import it.unipi.iot.Server.JSON.SenMLColumns;
+import it.unipi.iot.Server.JSON.SenMLDecoder;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+import org.eclipse.californium.core.CoapResource;
+import org.eclipse.californium.core.coap.CoAP;
+import org.eclipse.californium.core.server.resources.CoapExchange;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+
+
+public class CoAPBatch extends CoapResource {
+
+    // Source added by the border router: "coap://[<mote ip>]/<resource>/", the
+    // base name of the payload is the one of the node, as in the direct path
+    private static final Pattern SOURCE = Pattern.compile("coap://\\[([^\\]]+)\\]/([^/]+)/?");
+
+    // Room of the registered iot_nodes
+    private static final Map<String, Integer> rooms = new ConcurrentHashMap<>();
+
+    public CoAPBatch(String name){
+        super(name);
+        // Non-observable resource
+        setObservable(false);
+    }
+
+    public static void registerNode(String ip, int room) {
+        rooms.put(ip, room);
+    }
+
+    public void handlePOST(CoapExchange exchange) {
+
+        // Pack aggregated by the border router: one SenML payload per notification
+        JsonArray pack;
+        try {
+            pack = JsonParser.parseString(exchange.getRequestText()).getAsJsonArray();
+        } catch (Exception e) {
+            exchange.respond(CoAP.ResponseCode.BAD_REQUEST);
+            return;
+        }
+
+        // One record per notification, inserted by the writers of the ingest pipeline
+        boolean dropped = false;
+
+        for (JsonElement element : pack) {
+            if (!element.isJsonObject()) {
+                continue;
+            }
+            JsonObject senml = element.getAsJsonObject();
+            if (!senml.has("src")) {
+                continue;
+            }
+            Matcher source = SOURCE.matcher(senml.get("src").getAsString());
+            if (!source.matches()) {
+                continue;
+            }
+            String ip = source.group(1);
+            SenMLColumns columns = CoapObserver.columnsOf(source.group(2));
+            Integer room = rooms.get(ip);
+            if (columns == null || room == null) {
+                // Not stored or iot_node not registered
+                continue;
+            }
+
+            SenMLRecord values = new SenMLRecord(columns);
+            if (!SenMLDecoder.decode(senml, values) || CoapObserver.isRegistration(values)) {
+                // Incomplete payload or registration phase
+                continue;
+            }
+
+            LiveCache.update(source.group(2), values, ip, room, System.currentTimeMillis());
+            if (!IngestPipeline.submit(new IngestRecord(source.group(2), values, ip, room))) {
+                dropped = true;
+            }
+        }
+
+        // 5.03 when some notifications were dropped because the ingest queue is full
+        exchange.respond(dropped ? CoAP.ResponseCode.SERVICE_UNAVAILABLE : CoAP.ResponseCode.CHANGED);
+
+    }
+
+}
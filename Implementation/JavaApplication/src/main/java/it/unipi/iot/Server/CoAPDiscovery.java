@@ -21,13 +21,29 @@ public class CoAPDiscovery extends CoapResource {
         setObservable(false);
     }
 
+    /**
+     * Returns the value of the given URI query parameter, or null if it is missing.
+     */
+    static String getQueryParameter(CoapExchange exchange, String name) {
+        return exchange.getRequestOptions().getUriQuery().stream()
+                       .filter(param -> param.startsWith(name + "="))
+                       .map(param -> param.substring(name.length() + 1))
+                       .findFirst()
+                       .orElse(null);
+    }
+
+    /**
+     * Returns the room given in the URI query, 0 if it is missing
+     * (nodes deployed before the introduction of the rooms).
+     */
+    static int getRoom(CoapExchange exchange) throws NumberFormatException {
+        String room = getQueryParameter(exchange, "room");
+        return room == null ? 0 : Integer.parseInt(room);
+    }
+
     public void handleGET(CoapExchange exchange) {
 
-        String resource = exchange.getRequestOptions().getUriQuery().stream()
-                                  .filter(param -> param.startsWith("requested_resource="))
-                                  .map(param -> param.substring("requested_resource=".length()))
-                                  .findFirst()
-                                  .orElse(null);
+        String resource = getQueryParameter(exchange, "requested_resource");
 
         // Verifies if the "resource" parameter has been provided
         if (resource == null) {
@@ -35,30 +51,50 @@ public class CoAPDiscovery extends CoapResource {
             return;
         }
 
-        try(Connection connection = Database.getConnection()) {
+        int room;
+        try {
+            room = getRoom(exchange);
+        } catch (NumberFormatException e) {
+            exchange.respond(CoAP.ResponseCode.BAD_REQUEST, "Invalid room parameter");
+            return;
+        }
+
+        // If "all" is set, the IPs of all the nodes of the room exposing
+        // the resource are returned, separated by commas
+        boolean all = "1".equals(getQueryParameter(exchange, "all"));
+
+        // Preparing the SQL query to retrieve the information
+        String query = "SELECT ip FROM iot_nodes WHERE resource_exposed = ? AND room = ?";
+
+        try(Connection connection = Database.getConnection();
+            PreparedStatement statement = connection.prepareStatement(query)) {
 
-            // Preparing the SQL query to retrieve the information
-            String query = "SELECT * FROM iot_nodes WHERE resource_exposed = ?";
-            PreparedStatement statement = connection.prepareStatement(query);
             statement.setString(1, resource);
+            statement.setInt(2, room);
 
             // Execute the query
-            ResultSet resultSet = statement.executeQuery();
+            try (ResultSet resultSet = statement.executeQuery()) {
 
-            // Verifies if results have been found
-            if (resultSet.next()) {
                 // Build the response with the data obtained from the database
-                String responseData = resultSet.getString("ip");
-                exchange.respond(CoAP.ResponseCode.CONTENT, responseData, MediaTypeRegistry.TEXT_PLAIN);
-            } else {
-                // Resource not found
-                exchange.respond(CoAP.ResponseCode.NOT_FOUND, "Resource not found");
-            }
+                StringBuilder responseData = new StringBuilder();
+                while (resultSet.next()) {
+                    if (responseData.length() > 0) {
+                        responseData.append(',');
+                    }
+                    responseData.append(resultSet.getString("ip"));
+                    if (!all) {
+                        break;
+                    }
+                }
 
-            // Close the connection to the database
-            resultSet.close();
-            statement.close();
-            connection.close();
+                // Verifies if results have been found
+                if (responseData.length() > 0) {
+                    exchange.respond(CoAP.ResponseCode.CONTENT, responseData.toString(), MediaTypeRegistry.TEXT_PLAIN);
+                } else {
+                    // Resource not found
+                    exchange.respond(CoAP.ResponseCode.NOT_FOUND, "Resource not found");
+                }
+            }
 
         } catch (Exception e) {
             // Error handling
@@ -2,7 +2,10 @@ package it.unipi.iot.Server;
 
 import com.google.gson.Gson;
 import it.unipi.iot.Server.Driver.Database;
+import org.eclipse.californium.core.CoapClient;
+import org.eclipse.californium.core.CoapHandler;
 import org.eclipse.californium.core.CoapResource;
+import org.eclipse.californium.core.CoapResponse;
 import org.eclipse.californium.core.coap.CoAP;
 import org.eclipse.californium.core.coap.MediaTypeRegistry;
 import org.eclipse.californium.core.coap.Response;
@@ -16,6 +19,10 @@ import it.unipi.iot.UserApplication.UserApplication;
 
 public class CoAPRegistration extends CoapResource {
 
+    // Address of the border router built with make BATCH=1 (-Dcoap.proxy=<ip>):
+    // the values are observed by its CoAP proxy and received in packs on /batch
+    private static final String proxy = System.getProperty("coap.proxy");
+
     public CoAPRegistration(String name){
         super(name);
         // Non-observable resource
@@ -31,12 +38,22 @@ public class CoAPRegistration extends CoapResource {
         // IP address of the iot_node
         String ip = exchange.getSourceAddress().toString().substring(1);
 
+        // Room where the iot_node is deployed
+        int room;
+        try {
+            room = CoAPDiscovery.getRoom(exchange);
+        } catch (NumberFormatException e) {
+            exchange.respond(CoAP.ResponseCode.BAD_REQUEST);
+            return;
+        }
+
         try(Connection connection = Database.getConnection()) {
 
             // Preparing the SQL query to register the iot_node
-            PreparedStatement ps = connection.prepareStatement("REPLACE INTO iot_nodes (ip, resource_exposed) VALUES (?, ?)");
+            PreparedStatement ps = connection.prepareStatement("REPLACE INTO iot_nodes (ip, resource_exposed, room) VALUES (?, ?, ?)");
             ps.setString(1, ip);
             ps.setString(2, resourceExposed);
+            ps.setInt(3, room);
 
             // Execute the query
             ps.executeUpdate();
@@ -51,13 +68,18 @@ public class CoAPRegistration extends CoapResource {
 
                 // Initialize and start observing the resource
                 if(resourceExposed.equals("temperatureandhumidity") || resourceExposed.equals("co") || resourceExposed.equals("hvac")) {
-                    CoapObserver observer = new CoapObserver(ip, resourceExposed);
-                    observer.startObserving();
+                    CoAPBatch.registerNode(ip, room);
+                    if (proxy != null) {
+                        startProxyObservation(ip, resourceExposed);
+                    } else {
+                        // One relation per resource, also when the node registers again
+                        ObserverRegistry.observe(ip, resourceExposed, room);
+                    }
                 }
 
                 if(resourceExposed.equals("movement")) {
                     // Initializing the UserApplication
-                    UserApplication.initializeUri("coap://[" + ip + "]:5683/movement");
+                    UserApplication.initializeUri(room, "coap://[" + ip + "]:5683/movement");
                 }
 
             }
@@ -68,4 +90,24 @@ public class CoAPRegistration extends CoapResource {
 
     }
 
+    // The first request for a mote resource makes the proxy observe it
+    private static void startProxyObservation(String ip, String resourceExposed) {
+        CoapClient client = new CoapClient("coap://[" + proxy + "]/proxy/" + ip + "/" + resourceExposed)
+                .setEndpoint(ObserverRegistry.endpoint());
+        client.get(new CoapHandler() {
+
+            @Override
+            public void onLoad(CoapResponse response) {
+                client.shutdown();
+            }
+
+            @Override
+            public void onError() {
+                System.err.println("Error in reaching the proxy for " + ip + "/" + resourceExposed);
+                client.shutdown();
+            }
+
+        });
+    }
+
 }
@@ -1,14 +1,24 @@
 package it.unipi.iot.Server;
 
 import org.eclipse.californium.core.CoapServer;
+import org.eclipse.californium.core.network.CoapEndpoint;
+
+import java.net.InetSocketAddress;
 
 public class CoAPServer extends CoapServer {
     
     public CoAPServer() {
         super();
+        // -Dcoap.address binds the server to a single address instead of all
+        // of them (e.g. to leave the port of the other addresses to the load generator)
+        String address = System.getProperty("coap.address");
+        if (address != null) {
+            addEndpoint(new CoapEndpoint(new InetSocketAddress(address, 5683)));
+        }
         // Adding the resources to the server        
         add(new CoAPRegistration("register"));
         add(new CoAPDiscovery("discovery"));
+        add(new CoAPBatch("batch"));
     }
 
 }
@@ -4,40 +4,67 @@ import org.eclipse.californium.core.CoapClient;
 import org.eclipse.californium.core.CoapHandler;
 import org.eclipse.californium.core.CoapObserveRelation;
 import org.eclipse.californium.core.CoapResponse;
-import org.eclipse.californium.core.network.config.NetworkConfig;
-import it.unipi.iot.Server.JSON.SenMLParser;
-import it.unipi.iot.Server.Driver.Database;
-import java.sql.Connection;
-import java.sql.PreparedStatement;
-
-import java.util.ArrayList;
-import java.util.List;
+import it.unipi.iot.Server.JSON.SenMLColumns;
+import it.unipi.iot.Server.JSON.SenMLDecoder;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+import it.unipi.iot.Server.Ingest.IngestPipeline;
+import it.unipi.iot.Server.Ingest.IngestRecord;
+import it.unipi.iot.Server.Live.LiveCache;
 
 public class CoapObserver {
     private CoapClient client;
     private CoapObserveRelation relation;
     
-    private final String query;
+    private final String resource;
+    private final String ip;
+    private final int room;
+    // Reused for every notification, null if the values are not stored
+    private final SenMLRecord record;
 
-    public CoapObserver(String ip, String resourceExposed) {
+    public CoapObserver(String ip, String resourceExposed, int room) {
         String uri = "coap://[" + ip + "]/" + resourceExposed;
-        client = new CoapClient(uri);
+        // The clients share the endpoint of the ObserverRegistry
+        client = new CoapClient(uri).setEndpoint(ObserverRegistry.endpoint());
+        this.ip = ip;
+        this.room = room;
         
+        resource = resourceExposed;
+        SenMLColumns columns = columnsOf(resourceExposed);
+        record = columns == null ? null : new SenMLRecord(columns);
+    }
+
+    public int room() {
+        return room;
+    }
+
+    public boolean isCanceled() {
+        return relation == null || relation.isCanceled();
+    }
+
+    private static final SenMLColumns TEMPERATURE_AND_HUMIDITY = new SenMLColumns("temphum_sensor",
+            new String[] {"temperature", "humidity"}, new String[] {"temperature", "humidity"});
+    private static final SenMLColumns CO = new SenMLColumns("co_sensor",
+            new String[] {"co"}, new String[] {"co"});
+    private static final SenMLColumns HVAC = new SenMLColumns("hvac_actuator",
+            new String[] {"hvac"}, new String[] {"status"});
+
+    // Columns storing the measurements notified by a resource, null if they are not stored
+    public static SenMLColumns columnsOf(String resourceExposed) {
         switch(resourceExposed) {
             case "temperatureandhumidity":
-                query = "INSERT INTO temphum_sensor (temperature, humidity) VALUES (?, ?)";
-                break;
+                return TEMPERATURE_AND_HUMIDITY;
             case "co":
-                query = "INSERT INTO co_sensor (co) VALUES (?)";
-                break;
+                return CO;
             case "hvac":
-                query = "INSERT INTO hvac_actuator (status) VALUES (?)";
-                break;
+                return HVAC;
             default:
-                query = null;
+                return null;
         }
+    }
 
-        NetworkConfig.createStandardWithoutFile();
+    // Registration phase: the sensors notify -1.0 until their first reading
+    public static boolean isRegistration(SenMLRecord record) {
+        return !record.isBoolean(0) && record.value(0) == -1.0;
     }
 
     public void startObserving() {
@@ -46,43 +73,28 @@ public class CoapObserver {
             
             @Override
             public void onLoad(CoapResponse response) {
-                String content = response.getResponseText();
-                // System.out.println("Notification received: " + content);
-                List<String> values = SenMLParser.parseSenmlPayload(content);
-
-                if (values.get(0).equals("-1.0")) {      
-                    // Registration phase              
+                // System.out.println("Notification received: " + response.getResponseText());
+                if (record == null) {
+                    // Not stored
                     return;
                 }
-                 
-                // Add data to the database
-                try(Connection connection = Database.getConnection()) {
-
-                    // Preparing the SQL query for the insertion of the data
-                    PreparedStatement ps = connection.prepareStatement(query);
-                    for(int i = 0; i < values.size(); i++) {
-                        if (values.get(i).equals("true"))
-                            ps.setBoolean(i+1, true);
-                        else if (values.get(i).equals("false"))
-                            ps.setBoolean(i+1, false);
-                        else
-                            ps.setDouble(i+1, Double.parseDouble(values.get(i)));
+
+                SenMLRecord values;
+                synchronized (record) {
+                    if (!SenMLDecoder.decode(response.getPayload(), record) || isRegistration(record)) {
+                        // Incomplete payload or registration phase
+                        return;
                     }
+                    values = record.copy();
+                }
 
-                    // Execute the query
-                    ps.executeUpdate();
+                // Pushed to the live dashboards before it is inserted
+                LiveCache.update(resource, values, ip, room, System.currentTimeMillis());
 
-                    if (ps.getUpdateCount() < 1) {
-                        // ERROR
-                        // System.err.println("Error in inserting data into the database");
-                    } else {
-                        // SUCCESS
-                        // System.out.println("Data inserted correctly");
-                    }
-                    
-                } catch (Exception e) {
-                    // Error handling
-                    e.printStackTrace();
+                // Add data to the database, the record is inserted by the
+                // writers of the ingest pipeline off the CoAP thread
+                if (!IngestPipeline.submit(new IngestRecord(resource, values, ip, room))) {
+                    // System.err.println("Ingest queue full, notification dropped");
                 }
             }
 
@@ -95,15 +107,20 @@ public class CoapObserver {
 
     }
 
+    // Registers the relation again with the same token, e.g. after a reboot of the node
+    public void reregister() {
+        if (relation != null) {
+            relation.reregister();
+        }
+    }
+
     public void stopObserving() {
 
         if (relation != null) {
             relation.proactiveCancel();
         }
-        if (client != null) {
-            client.shutdown();
-        }
-        
+        // The endpoint is shared: the client has nothing else to release
+
     }
 
 }
@@ -0,0 +1,47 @@
+package it.unipi.iot.Server.Driver;
+
+import java.util.HashMap;
+import java.util.Map;
+
+
+// Aligns the clock of the nodes (uptime in seconds, bt + t of their SenML
+// records) with the clock of the collector. The time of boot of a node is
+// estimated as the smallest difference between the time of reception and the
+// uptime of its notifications, so the aligned time of a notification is late
+// by the delay of the fastest notification of the node since its boot (and by
+// less than the second of resolution of the uptime): the difference with the
+// time of reception is the delay of the notification over the fastest one.
+// The estimate is discarded when the uptime goes backwards (reboot).
+public class DeviceClock {
+
+    // Uptime going backwards by less is a reordering of the writers, not a reboot (s)
+    private static final double REORDER_SECONDS = 2.0;
+
+    private static class Boot {
+        long time;
+        double uptime;
+
+        Boot(long time, double uptime) {
+            this.time = time;
+            this.uptime = uptime;
+        }
+    }
+
+    private static final Map<String, Boot> boots = new HashMap<>();
+
+    // Time (ms) of the collector when the node was at the given uptime (s),
+    // received at the given time (ms)
+    public static synchronized long align(String node, double uptime, long received) {
+        long elapsed = Math.round(uptime * 1000);
+        long offset = received - elapsed;
+        Boot boot = boots.get(node);
+        if (boot == null || uptime < boot.uptime - REORDER_SECONDS) {
+            boots.put(node, new Boot(offset, uptime));
+            return received;
+        }
+        boot.time = Math.min(boot.time, offset);
+        boot.uptime = Math.max(boot.uptime, uptime);
+        return boot.time + elapsed;
+    }
+
+}
@@ -0,0 +1,131 @@
+package it.unipi.iot.Server.Driver;
+
+import java.sql.Connection;
+import java.sql.PreparedStatement;
+import java.sql.ResultSet;
+import java.sql.SQLException;
+import java.sql.Statement;
+import java.sql.Timestamp;
+import java.time.YearMonth;
+import java.time.ZoneOffset;
+import java.time.format.DateTimeFormatter;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.TreeSet;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+
+
+// Maintenance of the monthly partitions of the sensor tables (created by
+// start.sh with the single partition pmax): the partitions of the next months
+// are split from pmax ahead of time and, with a retention, the partitions and
+// the rollups older than the retention are dropped. Runs at startup and daily.
+//
+// Settings (system properties):
+//   storage.partitionsAhead   months partitioned ahead of the current one (default 2)
+//   storage.retentionMonths   months of raw rows and rollups kept, 0 to keep everything (default 0)
+public class Partitions {
+
+    public static final String[] TABLES = {"temphum_sensor", "co_sensor", "hvac_actuator"};
+
+    private static final int AHEAD = Integer.getInteger("storage.partitionsAhead", 2);
+    private static final int RETENTION = Integer.getInteger("storage.retentionMonths", 0);
+
+    // Partition holding the rows before the first day of the next month
+    private static final DateTimeFormatter NAME = DateTimeFormatter.ofPattern("'p'yyyyMM");
+
+    private static ScheduledExecutorService scheduler;
+
+    public static synchronized void start() {
+        if (scheduler != null) {
+            return;
+        }
+        scheduler = Executors.newSingleThreadScheduledExecutor(runnable -> {
+            Thread thread = new Thread(runnable, "storage-partitions");
+            thread.setDaemon(true);
+            return thread;
+        });
+        scheduler.scheduleAtFixedRate(Partitions::maintain, 0, 1, TimeUnit.DAYS);
+    }
+
+    public static void maintain() {
+        // The timestamps are stored in UTC (serverTimezone in database.properties)
+        YearMonth now = YearMonth.now(ZoneOffset.UTC);
+
+        try (Connection connection = Database.getConnection()) {
+            for (String table : TABLES) {
+                addPartitions(connection, table, now);
+                if (RETENTION > 0) {
+                    dropPartitions(connection, table, now.minusMonths(RETENTION));
+                }
+            }
+            if (RETENTION > 0) {
+                deleteRollups(connection, now.minusMonths(RETENTION));
+            }
+        } catch (SQLException e) {
+            // Error handling
+            System.err.println("Error in maintaining the partitions: " + e.getMessage());
+        }
+    }
+
+    private static TreeSet<YearMonth> partitions(Connection connection, String table) throws SQLException {
+        TreeSet<YearMonth> months = new TreeSet<>();
+        try (PreparedStatement ps = connection.prepareStatement("SELECT PARTITION_NAME FROM information_schema.PARTITIONS "
+                + "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND PARTITION_NAME LIKE 'p______'")) {
+            ps.setString(1, table);
+            try (ResultSet rs = ps.executeQuery()) {
+                while (rs.next()) {
+                    months.add(YearMonth.parse(rs.getString(1), NAME));
+                }
+            }
+        }
+        return months;
+    }
+
+    // Splits the partitions of the months up to now + AHEAD from pmax
+    private static void addPartitions(Connection connection, String table, YearMonth now) throws SQLException {
+        TreeSet<YearMonth> existing = partitions(connection, table);
+        YearMonth month = existing.isEmpty() ? now : existing.last().plusMonths(1);
+
+        List<String> added = new ArrayList<>();
+        for (; !month.isAfter(now.plusMonths(AHEAD)); month = month.plusMonths(1)) {
+            added.add("PARTITION " + month.format(NAME) + " VALUES LESS THAN ('" + month.plusMonths(1).atDay(1) + "')");
+        }
+        if (added.isEmpty()) {
+            return;
+        }
+
+        try (Statement statement = connection.createStatement()) {
+            statement.executeUpdate("ALTER TABLE " + table + " REORGANIZE PARTITION pmax INTO ("
+                    + String.join(", ", added) + ", PARTITION pmax VALUES LESS THAN (MAXVALUE))");
+        }
+        System.out.println("[Storage] " + table + ": " + added.size() + " partitions added");
+    }
+
+    private static void dropPartitions(Connection connection, String table, YearMonth oldest) throws SQLException {
+        List<String> dropped = new ArrayList<>();
+        for (YearMonth month : partitions(connection, table).headSet(oldest)) {
+            dropped.add(month.format(NAME));
+        }
+        if (dropped.isEmpty()) {
+            return;
+        }
+
+        try (Statement statement = connection.createStatement()) {
+            statement.executeUpdate("ALTER TABLE " + table + " DROP PARTITION " + String.join(", ", dropped));
+        }
+        System.out.println("[Storage] " + table + ": " + dropped.size() + " partitions dropped");
+    }
+
+    private static void deleteRollups(Connection connection, YearMonth oldest) throws SQLException {
+        Timestamp start = Timestamp.from(oldest.atDay(1).atStartOfDay().toInstant(ZoneOffset.UTC));
+        for (String table : TimeSeriesWriter.ROLLUP_TABLES) {
+            try (PreparedStatement ps = connection.prepareStatement("DELETE FROM " + table + " WHERE bucket < ?")) {
+                ps.setTimestamp(1, start);
+                ps.executeUpdate();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,240 @@
+package it.unipi.iot.Server.Driver;
+
+import it.unipi.iot.Server.JSON.SenMLColumns;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.sql.Connection;
+import java.sql.PreparedStatement;
+import java.sql.ResultSet;
+import java.sql.SQLException;
+import java.sql.Timestamp;
+import java.sql.Types;
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.IdentityHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+
+
+// Writes a batch of notifications: one row per notification in the table of
+// the resource (keyed by node and time of reception, partitioned by month, with
+// the address of the node and its time of the measurement), and the
+// min/max/sum/count of every measurement per minute and per hour, updated
+// incrementally in the rollup tables read by the dashboard.
+// The rows are written when the batch is executed, in the caller's transaction.
+// A row whose key (node, time) is already in the batch or in the table (a
+// record replayed after a crash) is skipped before the insert, so it is not
+// counted again in the rollups; the update counts of the batch are not needed
+// and the batch can be sent as a multi-row INSERT.
+public class TimeSeriesWriter implements AutoCloseable {
+
+    public static final String[] ROLLUP_TABLES = {"sensor_rollup_1m", "sensor_rollup_1h"};
+    private static final long[] ROLLUP_PERIODS = {60_000L, 3_600_000L};
+
+    private static final String STORED_KEYS = "SELECT node, timestamp FROM %s WHERE (node, timestamp) IN (%s)";
+
+    private static final String ROLLUP_UPSERT = "INSERT INTO %s (metric, bucket, node, room, min, max, sum, count) "
+            + "VALUES (?, ?, ?, ?, ?, ?, ?, ?) ON DUPLICATE KEY UPDATE "
+            + "min = LEAST(min, VALUES(min)), max = GREATEST(max, VALUES(max)), "
+            + "sum = sum + VALUES(sum), count = count + VALUES(count)";
+
+    // Aggregate of a measurement of a node in a bucket of the batch
+    private static class Rollup {
+        final String metric;
+        final long bucket;
+        final String node;
+        final int room;
+        double min = Double.POSITIVE_INFINITY;
+        double max = Double.NEGATIVE_INFINITY;
+        double sum;
+        int count;
+
+        Rollup(String metric, long bucket, String node, int room) {
+            this.metric = metric;
+            this.bucket = bucket;
+            this.node = node;
+            this.room = room;
+        }
+
+        void add(double value) {
+            min = Math.min(min, value);
+            max = Math.max(max, value);
+            sum += value;
+            count++;
+        }
+    }
+
+    // Row added to the batch of a table
+    private static class Row {
+        final SenMLRecord values;
+        final String node;
+        final int room;
+        final long time;
+
+        Row(SenMLRecord values, String node, int room, long time) {
+            this.values = values;
+            this.node = node;
+            this.room = room;
+            this.time = time;
+        }
+
+        String key() {
+            return node + '\0' + time;
+        }
+    }
+
+    private final Connection connection;
+    // One insert per resource, with the rows of its batch in order
+    private final Map<SenMLColumns, PreparedStatement> inserts = new IdentityHashMap<>();
+    private final Map<SenMLColumns, List<Row>> rows = new IdentityHashMap<>();
+    // Rollups of the batch per period, sorted as the primary key of the tables so that
+    // concurrent writers lock the rows in the same order
+    private final TreeMap<String, Rollup>[] rollups;
+    // Rows of the executed batches skipped as already stored
+    private int duplicates;
+
+    @SuppressWarnings("unchecked")
+    public TimeSeriesWriter(Connection connection) {
+        this.connection = connection;
+        rollups = new TreeMap[ROLLUP_PERIODS.length];
+        for (int i = 0; i < rollups.length; i++) {
+            rollups[i] = new TreeMap<>();
+        }
+    }
+
+    // Adds the values notified by a node at the given time (ms)
+    public void add(SenMLRecord values, String node, int room, long time) throws SQLException {
+        SenMLColumns columns = values.columns();
+
+        if (!inserts.containsKey(columns)) {
+            inserts.put(columns, connection.prepareStatement(columns.insertQuery()));
+            rows.put(columns, new ArrayList<>());
+        }
+        rows.get(columns).add(new Row(values, node, room, time));
+    }
+
+    private static void bind(PreparedStatement ps, Row row) throws SQLException {
+        SenMLRecord values = row.values;
+        int size = values.columns().size();
+        for (int i = 0; i < size; i++) {
+            if (values.isBoolean(i))
+                ps.setBoolean(i+1, values.booleanValue(i));
+            else
+                ps.setDouble(i+1, values.value(i));
+        }
+        ps.setString(size+1, row.node);
+        ps.setInt(size+2, row.room);
+        ps.setTimestamp(size+3, new Timestamp(row.time));
+        if (values.device() != null) {
+            ps.setString(size+4, values.device());
+        } else {
+            ps.setNull(size+4, Types.VARCHAR);
+        }
+        // Rows of the nodes not sending their uptime keep only the time of reception
+        if (values.hasDeviceTime()) {
+            ps.setDouble(size+5, values.deviceTime());
+            ps.setTimestamp(size+6, new Timestamp(DeviceClock.align(row.node, values.deviceTime(), row.time)));
+        } else {
+            ps.setNull(size+5, Types.DOUBLE);
+            ps.setNull(size+6, Types.TIMESTAMP);
+        }
+        ps.addBatch();
+    }
+
+    // Keys of the rows of the batch already stored in the table
+    private Set<String> storedKeys(String table, List<Row> batch) throws SQLException {
+        StringBuilder keys = new StringBuilder();
+        for (int i = 0; i < batch.size(); i++) {
+            keys.append(i == 0 ? "(?, ?)" : ", (?, ?)");
+        }
+        Set<String> stored = new HashSet<>();
+        try (PreparedStatement ps = connection.prepareStatement(String.format(STORED_KEYS, table, keys))) {
+            int index = 1;
+            for (Row row : batch) {
+                ps.setString(index++, row.node);
+                ps.setTimestamp(index++, new Timestamp(row.time));
+            }
+            try (ResultSet rs = ps.executeQuery()) {
+                while (rs.next()) {
+                    stored.add(rs.getString(1) + '\0' + rs.getTimestamp(2).getTime());
+                }
+            }
+        }
+        return stored;
+    }
+
+    // Booleans are aggregated as 0/1: the average is the share of the period they were true
+    private void rollup(Row row) {
+        SenMLColumns columns = row.values.columns();
+        for (int p = 0; p < ROLLUP_PERIODS.length; p++) {
+            long bucket = row.time - Math.floorMod(row.time, ROLLUP_PERIODS[p]);
+            for (int i = 0; i < columns.size(); i++) {
+                String metric = columns.measurement(i);
+                String key = metric + '\0' + bucket + '\0' + row.node;
+                rollups[p].computeIfAbsent(key, k -> new Rollup(metric, bucket, row.node, row.room))
+                        .add(row.values.value(i));
+            }
+        }
+    }
+
+    // Writes the rows and the rollups added since the last execution
+    public void execute() throws SQLException {
+        for (Map.Entry<SenMLColumns, PreparedStatement> insert : inserts.entrySet()) {
+            List<Row> batch = rows.get(insert.getKey());
+            if (batch.isEmpty()) {
+                continue;
+            }
+            // The first row of a key is inserted, the rows already stored are skipped
+            Set<String> keys = storedKeys(insert.getKey().table(), batch);
+            int added = 0;
+            for (Row row : batch) {
+                if (keys.add(row.key())) {
+                    bind(insert.getValue(), row);
+                    rollup(row);
+                    added++;
+                }
+            }
+            if (added > 0) {
+                insert.getValue().executeBatch();
+            }
+            duplicates += batch.size() - added;
+            batch.clear();
+        }
+        for (int p = 0; p < ROLLUP_PERIODS.length; p++) {
+            if (rollups[p].isEmpty()) {
+                continue;
+            }
+            try (PreparedStatement ps = connection.prepareStatement(String.format(ROLLUP_UPSERT, ROLLUP_TABLES[p]))) {
+                for (Rollup rollup : rollups[p].values()) {
+                    ps.setString(1, rollup.metric);
+                    ps.setTimestamp(2, new Timestamp(rollup.bucket));
+                    ps.setString(3, rollup.node);
+                    ps.setInt(4, rollup.room);
+                    ps.setDouble(5, rollup.min);
+                    ps.setDouble(6, rollup.max);
+                    ps.setDouble(7, rollup.sum);
+                    ps.setInt(8, rollup.count);
+                    ps.addBatch();
+                }
+                ps.executeBatch();
+            }
+            rollups[p].clear();
+        }
+    }
+
+    public int duplicates() {
+        return duplicates;
+    }
+
+    @Override
+    public void close() throws SQLException {
+        for (PreparedStatement ps : inserts.values()) {
+            ps.close();
+        }
+        inserts.clear();
+        rows.clear();
+    }
+
+}
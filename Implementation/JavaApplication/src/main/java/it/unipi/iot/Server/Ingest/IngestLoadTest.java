@@ -0,0 +1,104 @@
+package it.unipi.iot.Server.Ingest;
+
+import it.unipi.iot.Server.CoapObserver;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.locks.LockSupport;
+
+
+// Load test of the ingest pipeline: producer threads submit simulated
+// notifications of the sensors and of the HVAC at a fixed rate, as the
+// CoAP callbacks do, and the throughput and backpressure are reported.
+// The records are inserted in the configured database.
+//
+// Usage:
+//   java -cp target/JavaApplication-1.0-SNAPSHOT.jar it.unipi.iot.Server.Ingest.IngestLoadTest \
+//       [notifications per second] [seconds] [producers] [rooms]
+public class IngestLoadTest {
+
+    public static void main(String[] args) throws InterruptedException {
+        int rate = args.length > 0 ? Integer.parseInt(args[0]) : 5000;
+        int seconds = args.length > 1 ? Integer.parseInt(args[1]) : 30;
+        int producers = args.length > 2 ? Integer.parseInt(args[2]) : 4;
+        int rooms = args.length > 3 ? Integer.parseInt(args[3]) : 100;
+
+        System.out.printf("Submitting %d notifications/s for %d s from %d producers over %d rooms%n",
+                rate, seconds, producers, rooms);
+
+        long start = System.nanoTime();
+        long end = start + TimeUnit.SECONDS.toNanos(seconds);
+        List<Thread> threads = new ArrayList<>();
+        for (int i = 0; i < producers; i++) {
+            Thread producer = new Thread(() -> produce(rate / producers, end, rooms), "ingest-producer-" + i);
+            producer.start();
+            threads.add(producer);
+        }
+
+        // Queue depth every second while the producers run
+        while (System.nanoTime() < end) {
+            Thread.sleep(1000);
+            IngestMetrics metrics = IngestPipeline.metrics();
+            System.out.printf("depth=%d submitted=%d inserted=%d dropped=%d%n", IngestPipeline.queueDepth(),
+                    metrics.submitted(), metrics.inserted(), metrics.dropped());
+        }
+        for (Thread producer : threads) {
+            producer.join();
+        }
+        long submitEnd = System.nanoTime();
+
+        // Waiting for the writers to drain the queue
+        IngestPipeline.stop();
+        long drainEnd = System.nanoTime();
+
+        IngestMetrics metrics = IngestPipeline.metrics();
+        double submitSeconds = (submitEnd - start) / 1e9;
+        double drainSeconds = (drainEnd - start) / 1e9;
+        System.out.println(metrics);
+        System.out.printf("submitted %.0f/s, inserted %.0f/s, dropped %d, failed %d, drain %.2f s after the load%n",
+                metrics.submitted() / submitSeconds, metrics.inserted() / drainSeconds,
+                metrics.dropped(), metrics.failed(), (drainEnd - submitEnd) / 1e9);
+    }
+
+    // Submits notifications at the given rate until the end of the test
+    private static void produce(int rate, long end, int rooms) {
+        ThreadLocalRandom random = ThreadLocalRandom.current();
+        long interval = TimeUnit.SECONDS.toNanos(1) / Math.max(1, rate);
+        long next = System.nanoTime();
+
+        while (next < end) {
+            int room = 1 + random.nextInt(rooms);
+            String node = "fd00::" + Integer.toHexString(room) + ":" + random.nextInt(4);
+            IngestRecord record;
+            switch (random.nextInt(3)) {
+                case 0:
+                    SenMLRecord temphum = new SenMLRecord(CoapObserver.columnsOf("temperatureandhumidity"));
+                    temphum.setValue(0, 18 + random.nextDouble(10));
+                    temphum.setValue(1, 40 + random.nextDouble(30));
+                    record = new IngestRecord("temperatureandhumidity", temphum, node, room);
+                    break;
+                case 1:
+                    SenMLRecord co = new SenMLRecord(CoapObserver.columnsOf("co"));
+                    co.setValue(0, 0.002 + random.nextDouble(0.01));
+                    record = new IngestRecord("co", co, node, room);
+                    break;
+                default:
+                    SenMLRecord hvac = new SenMLRecord(CoapObserver.columnsOf("hvac"));
+                    hvac.setBoolean(0, random.nextBoolean());
+                    record = new IngestRecord("hvac", hvac, node, room);
+                    break;
+            }
+            IngestPipeline.submit(record);
+
+            next += interval;
+            long wait = next - System.nanoTime();
+            if (wait > 0) {
+                LockSupport.parkNanos(wait);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,85 @@
+package it.unipi.iot.Server.Ingest;
+
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.LongAccumulator;
+import java.util.concurrent.atomic.LongAdder;
+
+
+// Backpressure metrics of the ingest pipeline
+public class IngestMetrics {
+
+    private final LongAdder submitted = new LongAdder();
+    private final LongAdder dropped = new LongAdder();
+    private final LongAdder inserted = new LongAdder();
+    private final LongAdder failed = new LongAdder();
+    // Records whose row was already stored (replayed after a crash)
+    private final LongAdder duplicates = new LongAdder();
+    private final LongAdder batches = new LongAdder();
+    private final LongAdder insertNanos = new LongAdder();
+    private final LongAccumulator maxInsertNanos = new LongAccumulator(Long::max, 0);
+    private final LongAccumulator maxBatchSize = new LongAccumulator(Long::max, 0);
+    private final LongAccumulator maxDepth = new LongAccumulator(Long::max, 0);
+    private final AtomicLong depth = new AtomicLong();
+
+    void submitted(int queueDepth) {
+        submitted.increment();
+        depth.set(queueDepth);
+        maxDepth.accumulate(queueDepth);
+    }
+
+    void dropped() {
+        dropped.increment();
+    }
+
+    void batch(int size, long nanos) {
+        batches.increment();
+        inserted.add(size);
+        insertNanos.add(nanos);
+        maxInsertNanos.accumulate(nanos);
+        maxBatchSize.accumulate(size);
+    }
+
+    void failed(int size) {
+        failed.add(size);
+    }
+
+    void duplicates(int count) {
+        duplicates.add(count);
+    }
+
+    void depth(int queueDepth) {
+        depth.set(queueDepth);
+    }
+
+    public long submitted() {
+        return submitted.sum();
+    }
+
+    public long dropped() {
+        return dropped.sum();
+    }
+
+    public long inserted() {
+        return inserted.sum();
+    }
+
+    public long failed() {
+        return failed.sum();
+    }
+
+    public long duplicates() {
+        return duplicates.sum();
+    }
+
+    @Override
+    public String toString() {
+        long numBatches = batches.sum();
+        long numInserted = inserted.sum();
+        return String.format("[Ingest] depth=%d max_depth=%d submitted=%d dropped=%d inserted=%d failed=%d duplicates=%d " +
+                        "batches=%d avg_batch=%.1f max_batch=%d avg_insert_ms=%.2f max_insert_ms=%.2f",
+                depth.get(), maxDepth.get(), submitted.sum(), dropped.sum(), numInserted, failed.sum(), duplicates.sum(),
+                numBatches, numBatches > 0 ? (double) numInserted / numBatches : 0.0, maxBatchSize.get(),
+                numBatches > 0 ? insertNanos.sum() / 1e6 / numBatches : 0.0, maxInsertNanos.get() / 1e6);
+    }
+
+}
@@ -0,0 +1,343 @@
+package it.unipi.iot.Server.Ingest;
+
+import it.unipi.iot.Server.Bench;
+import it.unipi.iot.Server.Driver.Database;
+import it.unipi.iot.Server.Driver.TimeSeriesWriter;
+import it.unipi.iot.Server.Shadow.ShadowController;
+
+import java.io.IOException;
+import java.nio.file.Paths;
+import java.sql.Connection;
+import java.sql.SQLException;
+import java.sql.SQLRecoverableException;
+import java.sql.SQLTransientException;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.locks.LockSupport;
+
+
+// Asynchronous insertion of the notified values: the CoAP callbacks only
+// enqueue the records, a small pool of writers inserts them with one JDBC
+// batch per table (TimeSeriesWriter), flushed when it is full or when its
+// oldest record has waited for the flush interval.
+// With -Dingest.spool=<dir> the records are appended to a write-ahead spool
+// on disk (IngestSpool) instead of the queue, and a single replayer inserts
+// them, retrying while the database is unavailable: nothing is dropped until
+// the spool is full. A batch failing with a data error is split to insert its
+// valid records, the records which cannot be inserted are moved to the dead
+// letters of the spool.
+//
+// Settings (system properties):
+//   ingest.writers          writer threads (default 2)
+//   ingest.capacity         records waiting in the queue (default 10000)
+//   ingest.batchSize        largest batch of a writer (default 200)
+//   ingest.flushMs          longest wait of a record in a batch (default 100)
+//   ingest.metricsInterval  seconds between two metric reports, 0 to disable (default 60)
+//   ingest.spool            directory of the spool, unset to keep the records in memory
+//   ingest.spoolSegmentMb   size of a segment file of the spool (default 64)
+//   ingest.spoolMaxMb       largest size of the spool (default 4096)
+//   ingest.retryMs          first wait of the replayer after a connection or transient error, doubled up to 30 s (default 1000)
+public class IngestPipeline {
+
+    private static final int WRITERS = Integer.getInteger("ingest.writers", 2);
+    private static final int CAPACITY = Integer.getInteger("ingest.capacity", 10000);
+    private static final int BATCH_SIZE = Integer.getInteger("ingest.batchSize", 200);
+    private static final long FLUSH_NANOS = TimeUnit.MILLISECONDS.toNanos(Long.getLong("ingest.flushMs", 100L));
+    private static final long METRICS_INTERVAL = Long.getLong("ingest.metricsInterval", 60L);
+    // Longest wait of an idle writer, woken up earlier by the next record or by stop()
+    private static final long IDLE_NANOS = TimeUnit.SECONDS.toNanos(1);
+    private static final long RETRY_MS = Long.getLong("ingest.retryMs", 1000L);
+    private static final long MAX_RETRY_MS = 30_000L;
+
+    private static final IngestQueue queue = new IngestQueue(CAPACITY);
+    private static final IngestMetrics metrics = new IngestMetrics();
+    private static final IngestSpool spool = openSpool();
+    private static final List<Thread> writers = new ArrayList<>();
+    private static volatile boolean running = true;
+
+    static {
+        if (spool != null) {
+            // The records are inserted in the order of the spool
+            Thread replayer = new Thread(IngestPipeline::replay, "ingest-replayer");
+            replayer.setDaemon(true);
+            replayer.start();
+            writers.add(replayer);
+        } else {
+            for (int i = 0; i < WRITERS; i++) {
+                Thread writer = new Thread(IngestPipeline::write, "ingest-writer-" + i);
+                writer.setDaemon(true);
+                writer.start();
+                writers.add(writer);
+            }
+        }
+        if (METRICS_INTERVAL > 0) {
+            Thread reporter = new Thread(IngestPipeline::report, "ingest-metrics");
+            reporter.setDaemon(true);
+            reporter.start();
+        }
+        // The queued records are inserted before the application exits
+        Runtime.getRuntime().addShutdownHook(new Thread(IngestPipeline::stop));
+    }
+
+    private static IngestSpool openSpool() {
+        String directory = System.getProperty("ingest.spool");
+        if (directory == null) {
+            return null;
+        }
+        try {
+            IngestSpool spool = new IngestSpool(Paths.get(directory),
+                    Integer.getInteger("ingest.spoolSegmentMb", 64) << 20,
+                    Long.getLong("ingest.spoolMaxMb", 4096L) << 20);
+            System.out.println("[Spool] " + spool.backlog() + " records to insert in " + directory);
+            return spool;
+        } catch (IOException e) {
+            // The records are kept in memory
+            System.err.println("[Spool] Unable to open " + directory + ": " + e.getMessage());
+            return null;
+        }
+    }
+
+    // Enqueues a record, false if the queue or the spool is full (the record is dropped)
+    public static boolean submit(IngestRecord record) {
+        if (spool != null) {
+            if (!spool.append(record)) {
+                metrics.dropped();
+                return false;
+            }
+            metrics.submitted(spool.backlog());
+            return true;
+        }
+        if (!queue.offer(record)) {
+            metrics.dropped();
+            return false;
+        }
+        metrics.submitted(queue.size());
+        return true;
+    }
+
+    public static IngestMetrics metrics() {
+        return metrics;
+    }
+
+    public static int queueDepth() {
+        return spool != null ? spool.backlog() : queue.size();
+    }
+
+    // Spool of the records, null if they are kept in memory
+    public static IngestSpool spool() {
+        return spool;
+    }
+
+    // Stops the writers once the queue is empty (the records of the spool
+    // which cannot be inserted are kept for the next start)
+    public static void stop() {
+        running = false;
+        for (Thread writer : writers) {
+            LockSupport.unpark(writer);
+            try {
+                writer.join();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                return;
+            }
+        }
+        if (spool != null) {
+            try {
+                spool.close();
+            } catch (IOException e) {
+                e.printStackTrace();
+            }
+        }
+    }
+
+    private static void write() {
+        List<IngestRecord> batch = new ArrayList<>(BATCH_SIZE);
+        long batchStart = 0;
+
+        while (true) {
+            IngestRecord record = null;
+            if (batch.size() < BATCH_SIZE) {
+                // An open batch waits at most for the rest of its flush interval
+                long wait = !running ? 0 : batch.isEmpty() ? IDLE_NANOS
+                        : FLUSH_NANOS - (System.nanoTime() - batchStart);
+                record = queue.poll(wait);
+            }
+
+            if (record != null) {
+                if (batch.isEmpty()) {
+                    batchStart = System.nanoTime();
+                }
+                batch.add(record);
+                if (batch.size() < BATCH_SIZE) {
+                    continue;
+                }
+            }
+
+            if (!batch.isEmpty() && (batch.size() >= BATCH_SIZE || !running
+                    || System.nanoTime() - batchStart >= FLUSH_NANOS)) {
+                metrics.depth(queue.size());
+                flush(batch);
+                batch.clear();
+            } else if (record == null && !running && batch.isEmpty()) {
+                return;
+            }
+        }
+    }
+
+    // Inserts the records of the spool in order, a batch is read again until it is inserted
+    private static void replay() {
+        List<IngestRecord> batch = new ArrayList<>(BATCH_SIZE);
+        long retry = RETRY_MS;
+
+        while (true) {
+            batch.clear();
+            spool.read(batch, BATCH_SIZE);
+            if (batch.isEmpty()) {
+                if (!running) {
+                    return;
+                }
+                spool.await(IDLE_NANOS);
+                continue;
+            }
+            // A partial batch waits for the flush interval of its oldest record
+            long wait = FLUSH_NANOS - TimeUnit.MILLISECONDS.toNanos(System.currentTimeMillis() - batch.get(0).time);
+            if (batch.size() < BATCH_SIZE && wait > 0 && running) {
+                LockSupport.parkNanos(wait);
+                continue;
+            }
+
+            metrics.depth(spool.backlog());
+            try {
+                insert(batch);
+            } catch (Exception e) {
+                metrics.failed(batch.size());
+                e.printStackTrace();
+                if (!running) {
+                    return;
+                }
+                // Database unavailable: the records wait in the spool. On a data
+                // error the records which cannot be inserted are set aside
+                if (!isPermanent(e) || !isolate(batch, e)) {
+                    LockSupport.parkNanos(TimeUnit.MILLISECONDS.toNanos(retry));
+                    retry = Math.min(retry * 2, MAX_RETRY_MS);
+                    continue;
+                }
+            }
+            try {
+                spool.commit();
+            } catch (IOException e) {
+                e.printStackTrace();
+            }
+            retry = RETRY_MS;
+        }
+    }
+
+    // Inserts the records of a batch which failed with a data error, split in
+    // halves down to the single records, which are moved to the dead letters.
+    // False if the database became unavailable meanwhile (the batch is read again,
+    // the rows already inserted are skipped)
+    private static boolean isolate(List<IngestRecord> records, Exception cause) {
+        if (records.size() == 1) {
+            try {
+                spool.deadLetter(records.get(0), cause);
+                return true;
+            } catch (IOException e) {
+                e.printStackTrace();
+                return false;
+            }
+        }
+        int middle = records.size() / 2;
+        for (List<IngestRecord> half : List.of(records.subList(0, middle), records.subList(middle, records.size()))) {
+            try {
+                insert(half);
+            } catch (Exception e) {
+                if (!isPermanent(e) || !isolate(half, e)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Errors of the data of the records (constraint, value out of range), which fail
+    // again if retried, unlike the errors of the connection or of the transaction
+    // (deadlock, timeout)
+    private static boolean isPermanent(Exception e) {
+        if (!(e instanceof SQLException)) {
+            return false;
+        }
+        for (Throwable cause = e; cause != null; cause = cause.getCause()) {
+            if (cause instanceof SQLTransientException || cause instanceof SQLRecoverableException) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Inserts a batch, false on error
+    private static boolean flush(List<IngestRecord> batch) {
+        try {
+            insert(batch);
+        } catch (Exception e) {
+            // Error handling
+            metrics.failed(batch.size());
+            e.printStackTrace();
+            return false;
+        }
+        return true;
+    }
+
+    // Inserts a batch and updates its rollups in a single transaction
+    private static void insert(List<IngestRecord> batch) throws SQLException {
+        long start = System.nanoTime();
+
+        try (Connection connection = Database.getConnection()) {
+            connection.setAutoCommit(false);
+            try (TimeSeriesWriter writer = new TimeSeriesWriter(connection)) {
+                for (IngestRecord record : batch) {
+                    writer.add(record.values, record.node, record.room, record.time);
+                }
+                writer.execute();
+                connection.commit();
+                metrics.duplicates(writer.duplicates());
+            } catch (SQLException e) {
+                connection.rollback();
+                throw e;
+            } finally {
+                connection.setAutoCommit(true);
+            }
+        }
+
+        metrics.batch(batch.size(), System.nanoTime() - start);
+        // Windows of the shadow predictions
+        if (ShadowController.enabled()) {
+            for (IngestRecord record : batch) {
+                ShadowController.accept(record.values, record.room, record.node, record.time);
+            }
+        }
+        if (Bench.enabled()) {
+            for (IngestRecord record : batch) {
+                Bench.stage("insert", record.resource, record.room);
+            }
+        }
+    }
+
+    private static void report() {
+        String last = null;
+        while (true) {
+            try {
+                Thread.sleep(TimeUnit.SECONDS.toMillis(METRICS_INTERVAL));
+            } catch (InterruptedException e) {
+                return;
+            }
+            // Only the intervals with some traffic are reported
+            String current = spool != null ? metrics + System.lineSeparator() + spool : metrics.toString();
+            if (!current.equals(last)) {
+                System.out.println(current);
+                last = current;
+            }
+        }
+    }
+
+}
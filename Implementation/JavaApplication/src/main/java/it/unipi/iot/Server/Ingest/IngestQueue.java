@@ -0,0 +1,70 @@
+package it.unipi.iot.Server.Ingest;
+
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.LockSupport;
+
+
+// Bounded lock-free queue between the CoAP callbacks and the writers:
+// a slot is reserved on the counter before the record is enqueued, so the
+// callbacks never block and a full queue rejects the record at once.
+// The writers waiting for a record are parked and woken up by the next offer.
+public class IngestQueue {
+
+    private final ConcurrentLinkedQueue<IngestRecord> queue = new ConcurrentLinkedQueue<>();
+    private final AtomicInteger size = new AtomicInteger();
+    private final ConcurrentLinkedQueue<Thread> waiting = new ConcurrentLinkedQueue<>();
+    private final int capacity;
+
+    public IngestQueue(int capacity) {
+        this.capacity = capacity;
+    }
+
+    public boolean offer(IngestRecord record) {
+        if (size.incrementAndGet() > capacity) {
+            size.decrementAndGet();
+            return false;
+        }
+        queue.offer(record);
+        Thread writer = waiting.poll();
+        if (writer != null) {
+            LockSupport.unpark(writer);
+        }
+        return true;
+    }
+
+    public IngestRecord poll() {
+        IngestRecord record = queue.poll();
+        if (record != null) {
+            size.decrementAndGet();
+        }
+        return record;
+    }
+
+    // Waits up to nanos for a record, null if none was offered (or the writer was unparked)
+    public IngestRecord poll(long nanos) {
+        IngestRecord record = poll();
+        if (record != null || nanos <= 0) {
+            return record;
+        }
+        Thread writer = Thread.currentThread();
+        waiting.offer(writer);
+        // A record offered before the writer was registered does not unpark it
+        record = poll();
+        if (record == null) {
+            LockSupport.parkNanos(this, nanos);
+            record = poll();
+        }
+        waiting.remove(writer);
+        return record;
+    }
+
+    public int size() {
+        return Math.max(0, size.get());
+    }
+
+    public int capacity() {
+        return capacity;
+    }
+
+}
@@ -0,0 +1,39 @@
+package it.unipi.iot.Server.Ingest;
+
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+
+
+// Values notified by a resource, waiting to be inserted in the database
+public class IngestRecord {
+
+    // Time of the last notification of every node: the rows are keyed by node
+    // and time, so the notifications of a node received in the same millisecond
+    // (e.g. from a pack of the border router) are moved 1 ms after the previous one
+    private static final Map<String, Long> lastTime = new ConcurrentHashMap<>();
+
+    final String resource;
+    final SenMLRecord values;
+    // Address of the node and time of the notification (ms, set when it is received,
+    // unique per node)
+    final String node;
+    final int room;
+    final long time;
+
+    public IngestRecord(String resource, SenMLRecord values, String node, int room) {
+        this(resource, values, node, room,
+                lastTime.merge(node, System.currentTimeMillis(), (last, now) -> Math.max(last + 1, now)));
+    }
+
+    // Record replayed from the spool with its original time
+    IngestRecord(String resource, SenMLRecord values, String node, int room, long time) {
+        this.resource = resource;
+        this.values = values;
+        this.node = node;
+        this.room = room;
+        this.time = time;
+    }
+
+}
@@ -0,0 +1,448 @@
+package it.unipi.iot.Server.Ingest;
+
+import it.unipi.iot.Server.CoapObserver;
+import it.unipi.iot.Server.JSON.SenMLColumns;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.DirectoryStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.concurrent.locks.LockSupport;
+import java.util.zip.CRC32;
+
+
+// Write-ahead spool of the ingest pipeline: an append-only log of records on
+// memory-mapped segment files. The CoAP callbacks append the records without
+// touching the database; a single replayer reads them back in order, inserts
+// them and checkpoints the position of the next record to insert, so the
+// records survive an outage of the database and a restart of the application
+// (not a crash of the host: the pages are forced to disk on close only).
+// A record may be inserted twice after a crash: the rows already stored are
+// skipped, and so are their rollups (TimeSeriesWriter).
+//
+// Segment files <dir>/spool-<id>.seg, records in big-endian order:
+//   int     length of the rest of the record (0 after the last record)
+//   int     CRC32 of the rest of the record
+//   long    time of the notification (ms)
+//   int     room
+//   byte    resource (index in RESOURCES, DEVICE bit set when the device fields follow)
+//   byte    length of the address of the node, then its ASCII bytes
+//   byte    number of values
+//   int     booleans (bit i set when value i is a boolean)
+//   double  values
+//   byte    length of the device (base name of the payload), then its ASCII bytes
+//   double  uptime of the device at the measurement (s, NaN if not sent)
+// Checkpoint <dir>/checkpoint: segment id (high 32 bits) and offset of the next
+// record to insert, written with a single long.
+// Dead letters <dir>/dead-letter.csv: the records which cannot be inserted (data
+// errors), one line each: time,resource,node,room,values (separated by ';'),error
+public class IngestSpool implements AutoCloseable {
+
+    private static final String[] RESOURCES = {"temperatureandhumidity", "co", "hvac"};
+    private static final SenMLColumns[] COLUMNS = new SenMLColumns[RESOURCES.length];
+    // Length and CRC
+    private static final int HEADER = 8;
+    // Flag of the resource byte of the records written with the device fields
+    private static final int DEVICE = 0x80;
+
+    static {
+        for (int i = 0; i < RESOURCES.length; i++) {
+            COLUMNS[i] = CoapObserver.columnsOf(RESOURCES[i]);
+        }
+    }
+
+    private static class Segment {
+        final int id;
+        final Path path;
+        final int size;
+        final FileChannel channel;
+        // Written by the appenders under the lock of the spool
+        final MappedByteBuffer buffer;
+        // Read by the replayer only
+        final ByteBuffer view;
+        // End of the appended records, published after the bytes are written
+        volatile int end;
+        volatile Segment next;
+
+        Segment(int id, Path path, int size) throws IOException {
+            this.id = id;
+            this.path = path;
+            this.size = size;
+            channel = FileChannel.open(path, StandardOpenOption.CREATE, StandardOpenOption.READ,
+                    StandardOpenOption.WRITE);
+            buffer = channel.map(FileChannel.MapMode.READ_WRITE, 0, size);
+            view = buffer.duplicate();
+        }
+
+        void close() throws IOException {
+            // The mapping is released by the GC (there is no unmap before Java 19)
+            channel.close();
+        }
+    }
+
+    private final Path directory;
+    private final int segmentBytes;
+    private final int maxSegments;
+    private final MappedByteBuffer checkpoint;
+    private final FileChannel checkpointChannel;
+    private final CRC32 crc = new CRC32();
+    private final AtomicInteger segments = new AtomicInteger();
+
+    // Oldest segment, still read or to read, and segment of the appenders
+    private Segment head;
+    private Segment tail;
+    // Position of the next record to insert and after the last record read (replayer)
+    private Segment readSegment;
+    private int readOffset;
+    private Segment pendingSegment;
+    private int pendingOffset;
+    private int pendingRecords;
+
+    private final LongAdder appended = new LongAdder();
+    private final LongAdder appendedBytes = new LongAdder();
+    private final LongAdder appendNanos = new LongAdder();
+    private final LongAdder rejected = new LongAdder();
+    private final LongAdder replayed = new LongAdder();
+    private final LongAdder deadLetters = new LongAdder();
+    // Records appended and not inserted yet
+    private final AtomicInteger backlog = new AtomicInteger();
+    // Replayer waiting for the next append
+    private volatile Thread waiting;
+
+    // Opens the spool of the directory, recovering the records not inserted yet
+    public IngestSpool(Path directory, int segmentBytes, long maxBytes) throws IOException {
+        this.directory = directory;
+        this.segmentBytes = segmentBytes;
+        this.maxSegments = (int) Math.min(Integer.MAX_VALUE, Math.max(2, maxBytes / segmentBytes));
+        Files.createDirectories(directory);
+
+        checkpointChannel = FileChannel.open(directory.resolve("checkpoint"), StandardOpenOption.CREATE,
+                StandardOpenOption.READ, StandardOpenOption.WRITE);
+        checkpoint = checkpointChannel.map(FileChannel.MapMode.READ_WRITE, 0, Long.BYTES);
+        long position = checkpoint.getLong(0);
+        int checkpointId = (int) (position >>> 32);
+        int checkpointOffset = (int) position;
+
+        List<Integer> ids = new ArrayList<>();
+        try (DirectoryStream<Path> files = Files.newDirectoryStream(directory, "spool-*.seg")) {
+            for (Path file : files) {
+                String name = file.getFileName().toString();
+                ids.add(Integer.parseInt(name.substring(6, name.length() - 4)));
+            }
+        }
+        ids.sort(null);
+
+        for (int id : ids) {
+            Path path = segmentPath(id);
+            if (id < checkpointId) {
+                // Inserted before the checkpoint
+                Files.delete(path);
+                continue;
+            }
+            // The segments keep their size if ingest.spoolSegmentMb changed
+            Segment segment = link(new Segment(id, path, (int) Files.size(path)));
+            segment.end = recover(segment, id == checkpointId ? checkpointOffset : 0);
+        }
+        if (tail == null) {
+            link(new Segment(checkpointId, segmentPath(checkpointId), segmentBytes));
+        }
+
+        readSegment = head;
+        readOffset = head.id == checkpointId ? Math.min(checkpointOffset, head.end) : 0;
+    }
+
+    private Path segmentPath(int id) {
+        return directory.resolve(String.format("spool-%010d.seg", id));
+    }
+
+    private Segment link(Segment segment) {
+        if (tail == null) {
+            head = segment;
+        } else {
+            tail.next = segment;
+        }
+        tail = segment;
+        segments.incrementAndGet();
+        return segment;
+    }
+
+    // End of the valid records of a segment, counting those after the offset in the backlog
+    private int recover(Segment segment, int from) {
+        ByteBuffer view = segment.view;
+        int offset = 0;
+        while (offset + HEADER <= segment.size) {
+            int length = view.getInt(offset);
+            if (length <= 0 || offset + HEADER + length > segment.size) {
+                break;
+            }
+            ByteBuffer body = view.duplicate();
+            body.limit(offset + HEADER + length).position(offset + HEADER);
+            crc.reset();
+            crc.update(body);
+            if ((int) crc.getValue() != view.getInt(offset + 4)) {
+                // Torn by a crash while appending
+                break;
+            }
+            if (offset >= from) {
+                backlog.incrementAndGet();
+            }
+            offset += HEADER + length;
+        }
+        return offset;
+    }
+
+    // Appends a record, false if the spool is full or the resource is not stored
+    public boolean append(IngestRecord record) {
+        long start = System.nanoTime();
+        int resource = resourceIndex(record.resource);
+        if (resource < 0) {
+            rejected.increment();
+            return false;
+        }
+        byte[] node = record.node.getBytes(StandardCharsets.US_ASCII);
+        String device = record.values.device();
+        byte[] deviceBytes = device != null && device.length() <= 255
+                ? device.getBytes(StandardCharsets.US_ASCII) : new byte[0];
+        int count = record.values.columns().size();
+        int length = Long.BYTES + Integer.BYTES + 2 + node.length + 1 + Integer.BYTES + count * Double.BYTES
+                + 1 + deviceBytes.length + Double.BYTES;
+        int booleans = 0;
+        for (int i = 0; i < count; i++) {
+            if (record.values.isBoolean(i)) {
+                booleans |= 1 << i;
+            }
+        }
+
+        synchronized (this) {
+            Segment segment = tail;
+            int offset = segment.end;
+            if (offset + HEADER + length > segment.size) {
+                if (segments.get() >= maxSegments) {
+                    rejected.increment();
+                    return false;
+                }
+                try {
+                    segment = link(new Segment(segment.id + 1, segmentPath(segment.id + 1), segmentBytes));
+                } catch (IOException e) {
+                    e.printStackTrace();
+                    rejected.increment();
+                    return false;
+                }
+                offset = 0;
+            }
+
+            ByteBuffer buffer = segment.buffer;
+            buffer.position(offset + HEADER);
+            buffer.putLong(record.time);
+            buffer.putInt(record.room);
+            buffer.put((byte) (resource | DEVICE));
+            buffer.put((byte) node.length);
+            buffer.put(node);
+            buffer.put((byte) count);
+            buffer.putInt(booleans);
+            for (int i = 0; i < count; i++) {
+                buffer.putDouble(record.values.value(i));
+            }
+            buffer.put((byte) deviceBytes.length);
+            buffer.put(deviceBytes);
+            buffer.putDouble(record.values.deviceTime());
+
+            buffer.limit(offset + HEADER + length).position(offset + HEADER);
+            crc.reset();
+            crc.update(buffer);
+            buffer.limit(segment.size);
+            buffer.putInt(offset + 4, (int) crc.getValue());
+            // The length is written last: a torn record ends the segment
+            buffer.putInt(offset, length);
+            segment.end = offset + HEADER + length;
+        }
+
+        backlog.incrementAndGet();
+        Thread replayer = waiting;
+        if (replayer != null) {
+            LockSupport.unpark(replayer);
+        }
+        appended.increment();
+        appendedBytes.add(HEADER + length);
+        appendNanos.add(System.nanoTime() - start);
+        return true;
+    }
+
+    private static int resourceIndex(String resource) {
+        for (int i = 0; i < RESOURCES.length; i++) {
+            if (RESOURCES[i].equals(resource)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Reads up to max records after the last commit (replayer only): the same
+    // records are read again until they are committed
+    public void read(List<IngestRecord> batch, int max) {
+        Segment segment = readSegment;
+        int offset = readOffset;
+        int count = 0;
+
+        while (count < max) {
+            int end = segment.end;
+            if (offset >= end) {
+                // The next segment exists once the appenders are done with this one
+                Segment next = segment.next;
+                if (next == null || offset < segment.end) {
+                    break;
+                }
+                segment = next;
+                offset = 0;
+                continue;
+            }
+            ByteBuffer view = segment.view;
+            view.limit(segment.size).position(offset);
+            int length = view.getInt();
+            view.getInt();
+            long time = view.getLong();
+            int room = view.getInt();
+            int resource = view.get() & 0xFF;
+            boolean hasDevice = (resource & DEVICE) != 0;
+            resource &= ~DEVICE;
+            byte[] node = new byte[view.get() & 0xFF];
+            view.get(node);
+            int values = view.get();
+            int booleans = view.getInt();
+
+            SenMLRecord record = new SenMLRecord(COLUMNS[resource]);
+            for (int i = 0; i < values; i++) {
+                double value = view.getDouble();
+                if ((booleans & (1 << i)) != 0) {
+                    record.setBoolean(i, value != 0.0);
+                } else {
+                    record.setValue(i, value);
+                }
+            }
+            if (hasDevice) {
+                byte[] device = new byte[view.get() & 0xFF];
+                view.get(device);
+                if (device.length > 0) {
+                    record.setDevice(new String(device, StandardCharsets.US_ASCII));
+                }
+                record.setDeviceTime(view.getDouble());
+            }
+            batch.add(new IngestRecord(RESOURCES[resource], record, new String(node, StandardCharsets.US_ASCII),
+                    room, time));
+            offset += HEADER + length;
+            count++;
+        }
+
+        pendingSegment = segment;
+        pendingOffset = offset;
+        pendingRecords = count;
+    }
+
+    // Waits up to nanos for the next append when every record was inserted (replayer only)
+    public void await(long nanos) {
+        waiting = Thread.currentThread();
+        // An append before the replayer was registered does not unpark it
+        if (backlog.get() == 0) {
+            LockSupport.parkNanos(this, nanos);
+        }
+        waiting = null;
+    }
+
+    // Marks the records of the last read as inserted, removing the segments read entirely
+    public void commit() throws IOException {
+        if (pendingSegment == null) {
+            return;
+        }
+        readSegment = pendingSegment;
+        readOffset = pendingOffset;
+        backlog.addAndGet(-pendingRecords);
+        replayed.add(pendingRecords);
+        pendingSegment = null;
+
+        checkpoint.putLong(0, ((long) readSegment.id << 32) | (readOffset & 0xFFFFFFFFL));
+        while (head != readSegment) {
+            Segment done = head;
+            head = done.next;
+            done.close();
+            Files.deleteIfExists(done.path);
+            segments.decrementAndGet();
+        }
+    }
+
+    // Sets aside a record which cannot be inserted (replayer only), before the
+    // commit of its batch
+    public void deadLetter(IngestRecord record, Throwable cause) throws IOException {
+        StringBuilder line = new StringBuilder();
+        line.append(record.time).append(',').append(record.resource).append(',').append(record.node)
+                .append(',').append(record.room).append(',');
+        for (int i = 0; i < record.values.columns().size(); i++) {
+            if (i > 0) {
+                line.append(';');
+            }
+            if (record.values.isBoolean(i)) {
+                line.append(record.values.booleanValue(i));
+            } else {
+                line.append(record.values.value(i));
+            }
+        }
+        line.append(',').append(String.valueOf(cause).replace('\n', ' ')).append(System.lineSeparator());
+        Files.write(directory.resolve("dead-letter.csv"), line.toString().getBytes(StandardCharsets.UTF_8),
+                StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.APPEND);
+        deadLetters.increment();
+    }
+
+    public int backlog() {
+        return Math.max(0, backlog.get());
+    }
+
+    public long appended() {
+        return appended.sum();
+    }
+
+    public long appendedBytes() {
+        return appendedBytes.sum();
+    }
+
+    public long replayed() {
+        return replayed.sum();
+    }
+
+    public long rejected() {
+        return rejected.sum();
+    }
+
+    public long deadLetters() {
+        return deadLetters.sum();
+    }
+
+    // Forces the records and the checkpoint to disk
+    @Override
+    public synchronized void close() throws IOException {
+        for (Segment segment = head; segment != null; segment = segment.next) {
+            segment.buffer.force();
+            segment.close();
+        }
+        checkpoint.force();
+        checkpointChannel.close();
+    }
+
+    @Override
+    public String toString() {
+        long numAppended = appended.sum();
+        return String.format("[Spool] segments=%d backlog=%d appended=%d appended_mb=%.1f rejected=%d " +
+                        "replayed=%d dead_letters=%d avg_append_us=%.2f",
+                segments.get(), backlog(), numAppended, appendedBytes.sum() / 1e6, rejected.sum(),
+                replayed.sum(), deadLetters.sum(), numAppended > 0 ? appendNanos.sum() / 1e3 / numAppended : 0.0);
+    }
+
+}
@@ -0,0 +1,116 @@
+package it.unipi.iot.Server.Ingest;
+
+import it.unipi.iot.Server.CoapObserver;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.List;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.stream.Stream;
+
+
+// Throughput of the write-ahead spool without the database: producer threads
+// append simulated notifications as fast as they can (the CoAP callbacks),
+// then the replayer reads and commits them back (the drain path without the
+// inserts, measured by IngestLoadTest).
+//
+// Usage:
+//   java -cp target/JavaApplication-1.0-SNAPSHOT.jar it.unipi.iot.Server.Ingest.IngestSpoolBenchmark \
+//       [records] [producers] [directory]
+public class IngestSpoolBenchmark {
+
+    private static final int BATCH_SIZE = 200;
+
+    public static void main(String[] args) throws Exception {
+        int records = args.length > 0 ? Integer.parseInt(args[0]) : 2_000_000;
+        int producers = args.length > 1 ? Integer.parseInt(args[1]) : 4;
+        Path directory = args.length > 2 ? Paths.get(args[2]) : Files.createTempDirectory("ingest-spool");
+
+        System.out.printf("Appending %d records from %d producers to %s%n", records, producers, directory);
+        IngestRecord[] samples = samples(1024);
+
+        try (IngestSpool spool = new IngestSpool(directory, 64 << 20, Long.MAX_VALUE)) {
+            long start = System.nanoTime();
+            List<Thread> threads = new ArrayList<>();
+            for (int i = 0; i < producers; i++) {
+                int first = i;
+                Thread producer = new Thread(() -> {
+                    for (int r = first; r < records; r += producers) {
+                        spool.append(samples[r % samples.length]);
+                    }
+                }, "spool-producer-" + i);
+                producer.start();
+                threads.add(producer);
+            }
+            for (Thread producer : threads) {
+                producer.join();
+            }
+            double appendSeconds = (System.nanoTime() - start) / 1e9;
+
+            start = System.nanoTime();
+            List<IngestRecord> batch = new ArrayList<>(BATCH_SIZE);
+            long drained = 0;
+            do {
+                batch.clear();
+                spool.read(batch, BATCH_SIZE);
+                spool.commit();
+                drained += batch.size();
+            } while (!batch.isEmpty());
+            double drainSeconds = (System.nanoTime() - start) / 1e9;
+
+            System.out.println(spool);
+            System.out.printf("append %.0f records/s (%.1f MB/s, %.1f bytes/record), drain %.0f records/s%n",
+                    spool.appended() / appendSeconds, spool.appendedBytes() / 1e6 / appendSeconds,
+                    (double) spool.appendedBytes() / Math.max(1, spool.appended()), drained / drainSeconds);
+        }
+
+        if (args.length <= 2) {
+            try (Stream<Path> files = Files.walk(directory)) {
+                files.sorted(Comparator.reverseOrder()).forEach(IngestSpoolBenchmark::delete);
+            }
+        }
+    }
+
+    // Notifications of the sensors and of the HVAC
+    private static IngestRecord[] samples(int count) {
+        ThreadLocalRandom random = ThreadLocalRandom.current();
+        IngestRecord[] samples = new IngestRecord[count];
+        for (int i = 0; i < count; i++) {
+            int room = 1 + random.nextInt(100);
+            String node = "fd00::" + Integer.toHexString(room) + ":" + random.nextInt(4);
+            switch (i % 3) {
+                case 0:
+                    SenMLRecord temphum = new SenMLRecord(CoapObserver.columnsOf("temperatureandhumidity"));
+                    temphum.setValue(0, 18 + random.nextDouble(10));
+                    temphum.setValue(1, 40 + random.nextDouble(30));
+                    samples[i] = new IngestRecord("temperatureandhumidity", temphum, node, room);
+                    break;
+                case 1:
+                    SenMLRecord co = new SenMLRecord(CoapObserver.columnsOf("co"));
+                    co.setValue(0, 0.002 + random.nextDouble(0.01));
+                    samples[i] = new IngestRecord("co", co, node, room);
+                    break;
+                default:
+                    SenMLRecord hvac = new SenMLRecord(CoapObserver.columnsOf("hvac"));
+                    hvac.setBoolean(0, random.nextBoolean());
+                    samples[i] = new IngestRecord("hvac", hvac, node, room);
+                    break;
+            }
+        }
+        return samples;
+    }
+
+    private static void delete(Path path) {
+        try {
+            Files.delete(path);
+        } catch (IOException e) {
+            e.printStackTrace();
+        }
+    }
+
+}
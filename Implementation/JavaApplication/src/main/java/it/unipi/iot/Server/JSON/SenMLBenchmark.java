@@ -0,0 +1,87 @@
+package it.unipi.iot.Server.JSON;
+
+import it.unipi.iot.Server.CoapObserver;
+
+import java.lang.management.ManagementFactory;
+import java.nio.charset.StandardCharsets;
+import java.util.List;
+
+
+// Compares SenMLDecoder with the string-based SenMLParser on the payloads
+// of the nodes: time and heap allocated per payload, after a warm-up.
+// Each run includes the conversion of the values done to bind them to the
+// insert query (equals("true") and Double.parseDouble for the parser).
+//
+// Usage:
+//   java -cp target/JavaApplication-1.0-SNAPSHOT.jar it.unipi.iot.Server.JSON.SenMLBenchmark [iterations]
+public class SenMLBenchmark {
+
+    private static final String[] PAYLOADS = {
+        "{\"e\":[{\"n\":\"temperature\",\"v\":2134000,\"u\":\"Cel\"},{\"n\":\"humidity\",\"v\":5512000,\"u\":\"%RH\"}],"
+            + "\"bn\":\"urn:dev:mac:F4CE3612AB01:\",\"bt\":0,\"ver\":1}",
+        "{\"e\":[{\"n\":\"co\",\"v\":712,\"u\":\"ppm\"}],\"bn\":\"urn:dev:mac:F4CE3612AB02:\",\"bt\":0,\"ver\":1}",
+        "{\"e\":[{\"n\":\"hvac\",\"bv\":true}],\"bn\":\"urn:dev:mac:F4CE3612AB03:\",\"bt\":0,\"ver\":1}",
+    };
+    private static final String[] RESOURCES = {"temperatureandhumidity", "co", "hvac"};
+
+    // Keeps the results alive
+    private static double sink;
+
+    public static void main(String[] args) {
+        int iterations = args.length > 0 ? Integer.parseInt(args[0]) : 5_000_000;
+
+        byte[][] bytes = new byte[PAYLOADS.length][];
+        SenMLRecord[] records = new SenMLRecord[PAYLOADS.length];
+        for (int i = 0; i < PAYLOADS.length; i++) {
+            bytes[i] = PAYLOADS[i].getBytes(StandardCharsets.UTF_8);
+            records[i] = new SenMLRecord(CoapObserver.columnsOf(RESOURCES[i]));
+        }
+
+        for (int round = 0; round < 2; round++) {
+            // The first round is the warm-up of the JIT
+            boolean report = round == 1;
+            run("SenMLParser", iterations, report, i -> {
+                // The notifications were received as text (getResponseText)
+                List<String> values = SenMLParser.parseSenmlPayload(new String(bytes[i], StandardCharsets.UTF_8));
+                for (String value : values) {
+                    if (value.equals("true")) {
+                        sink += 1;
+                    } else if (!value.equals("false")) {
+                        sink += Double.parseDouble(value);
+                    }
+                }
+            });
+            run("SenMLDecoder", iterations, report, i -> {
+                SenMLRecord record = records[i];
+                SenMLDecoder.decode(bytes[i], record);
+                for (int c = 0; c < record.columns().size(); c++) {
+                    sink += record.value(c);
+                }
+            });
+        }
+        System.out.println("checksum " + sink);
+    }
+
+    private interface Decode {
+        void run(int payload);
+    }
+
+    private static void run(String name, int iterations, boolean report, Decode decode) {
+        com.sun.management.ThreadMXBean threads = (com.sun.management.ThreadMXBean) ManagementFactory.getThreadMXBean();
+        long thread = Thread.currentThread().getId();
+
+        long allocated = threads.getThreadAllocatedBytes(thread);
+        long start = System.nanoTime();
+        for (int i = 0; i < iterations; i++) {
+            decode.run(i % PAYLOADS.length);
+        }
+        long elapsed = System.nanoTime() - start;
+        allocated = threads.getThreadAllocatedBytes(thread) - allocated;
+
+        if (report) {
+            System.out.printf("%-14s %8.1f ns/payload %8.1f bytes/payload%n", name,
+                    (double) elapsed / iterations, (double) allocated / iterations);
+        }
+    }
+
+}
@@ -0,0 +1,87 @@
+package it.unipi.iot.Server.JSON;
+
+import java.nio.charset.StandardCharsets;
+
+
+// Mapping of the SenML measurements notified by a resource to the columns
+// of its table: the measurements are matched by name, in any order
+public class SenMLColumns {
+
+    private final String table;
+    private final String[] names;
+    private final byte[][] measurements;
+    private final String[] columns;
+    private final String insertQuery;
+
+    public SenMLColumns(String table, String[] measurements, String[] columns) {
+        if (measurements.length != columns.length || measurements.length > 32) {
+            throw new IllegalArgumentException("One column per measurement, at most 32");
+        }
+        this.table = table;
+        this.names = measurements.clone();
+        this.columns = columns.clone();
+        this.measurements = new byte[measurements.length][];
+        for (int i = 0; i < measurements.length; i++) {
+            this.measurements[i] = measurements[i].getBytes(StandardCharsets.UTF_8);
+        }
+
+        // Values of the columns, then node, room and time of the notification,
+        // then address, uptime and aligned time of the node (TimeSeriesWriter).
+        // The rows already stored are skipped by the writer; a row of the same
+        // key inserted meanwhile by another writer is left unchanged
+        StringBuilder query = new StringBuilder("INSERT INTO ").append(table).append(" (");
+        for (String column : columns) {
+            query.append(column).append(", ");
+        }
+        query.append("node, room, timestamp, device, device_time, device_timestamp) VALUES (");
+        for (int i = 0; i < columns.length; i++) {
+            query.append("?, ");
+        }
+        insertQuery = query.append("?, ?, ?, ?, ?, ?) ON DUPLICATE KEY UPDATE node = node").toString();
+    }
+
+    public String table() {
+        return table;
+    }
+
+    public int size() {
+        return columns.length;
+    }
+
+    public String column(int index) {
+        return columns[index];
+    }
+
+    public String measurement(int index) {
+        return names[index];
+    }
+
+    public String insertQuery() {
+        return insertQuery;
+    }
+
+    // Column of the measurement named by payload[start, end), -1 if it is not stored
+    public int indexOf(byte[] payload, int start, int end) {
+        int length = end - start;
+        for (int i = 0; i < measurements.length; i++) {
+            byte[] name = measurements[i];
+            if (name.length != length) {
+                continue;
+            }
+            int j = 0;
+            while (j < length && name[j] == payload[start + j]) {
+                j++;
+            }
+            if (j == length) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    public int indexOf(String measurement) {
+        byte[] name = measurement.getBytes(StandardCharsets.UTF_8);
+        return indexOf(name, 0, name.length);
+    }
+
+}
@@ -0,0 +1,277 @@
+package it.unipi.iot.Server.JSON;
+
+import com.google.gson.JsonElement;
+import com.google.gson.JsonObject;
+
+import java.nio.charset.StandardCharsets;
+
+
+// Decodes the SenML payloads of the nodes into the columns of a SenMLRecord,
+// reading the bytes of the CoAP payload without building intermediate strings.
+// Numeric values ("v") are integers scaled by 100000, boolean values are "bv".
+// The base name ("bn", urn:dev:mac:<address>:) identifies the node, the base
+// time ("bt", uptime of the node in seconds, 0 before the nodes sent it) plus
+// the time of the records ("t") is the uptime of the node at the measurement.
+public class SenMLDecoder {
+
+    private static final double SCALE = 100000.0;
+    private static final byte[] MAC_PREFIX = "urn:dev:mac:".getBytes(StandardCharsets.US_ASCII);
+
+    // Decodes the payload into the record, true if every column was decoded
+    public static boolean decode(byte[] payload, SenMLRecord record) {
+        return payload != null && decode(payload, 0, payload.length, record);
+    }
+
+    public static boolean decode(byte[] payload, int offset, int length, SenMLRecord record) {
+        SenMLColumns columns = record.columns();
+        int end = offset + length;
+        int pos = offset;
+
+        // Measurement being decoded: its column and its value, the keys can be in any order
+        int column = -1;
+        boolean hasValue = false;
+        boolean isBoolean = false;
+        double value = 0;
+        double measurementTime = 0;
+        // Base time, and time of the first measurement decoded into a column
+        double baseTime = 0;
+        double time = 0;
+        boolean timed = false;
+
+        record.reset();
+
+        while (pos < end) {
+            byte c = payload[pos];
+
+            if (c == '{') {
+                column = -1;
+                hasValue = false;
+                measurementTime = 0;
+                pos++;
+            } else if (c == '}') {
+                if (hasValue && column >= 0) {
+                    if (isBoolean) {
+                        record.setBoolean(column, value != 0);
+                    } else {
+                        record.setValue(column, value);
+                    }
+                    if (!timed) {
+                        time = measurementTime;
+                        timed = true;
+                    }
+                }
+                column = -1;
+                hasValue = false;
+                pos++;
+            } else if (c == '"') {
+                int keyStart = pos + 1;
+                int keyEnd = closingQuote(payload, keyStart, end);
+                if (keyEnd < 0) {
+                    return false;
+                }
+                pos = skipWhitespace(payload, keyEnd + 1, end);
+                if (pos >= end || payload[pos] != ':') {
+                    // String in an array
+                    continue;
+                }
+                pos = skipWhitespace(payload, pos + 1, end);
+                if (pos >= end) {
+                    return false;
+                }
+
+                if (isKey(payload, keyStart, keyEnd, 'n') && payload[pos] == '"') {
+                    int nameEnd = closingQuote(payload, pos + 1, end);
+                    if (nameEnd < 0) {
+                        return false;
+                    }
+                    column = columns.indexOf(payload, pos + 1, nameEnd);
+                    pos = nameEnd + 1;
+                } else if (isKey(payload, keyStart, keyEnd, 'v')) {
+                    // Scaled integer
+                    boolean negative = payload[pos] == '-';
+                    if (negative) {
+                        pos++;
+                    }
+                    int digits = pos;
+                    long number = 0;
+                    while (pos < end && payload[pos] >= '0' && payload[pos] <= '9') {
+                        number = number * 10 + (payload[pos] - '0');
+                        pos++;
+                    }
+                    if (pos == digits) {
+                        return false;
+                    }
+                    value = (negative ? -number : number) / SCALE;
+                    isBoolean = false;
+                    hasValue = true;
+                } else if (isKey(payload, keyStart, keyEnd, 'b', 'v')) {
+                    value = payload[pos] == 't' ? 1 : 0;
+                    isBoolean = true;
+                    hasValue = true;
+                } else if (isKey(payload, keyStart, keyEnd, 't') || isKey(payload, keyStart, keyEnd, 'b', 't')) {
+                    int numberEnd = numberEnd(payload, pos, end);
+                    if (numberEnd == pos) {
+                        return false;
+                    }
+                    if (keyEnd - keyStart == 1) {
+                        measurementTime = parseNumber(payload, pos, numberEnd);
+                    } else {
+                        baseTime = parseNumber(payload, pos, numberEnd);
+                    }
+                    pos = numberEnd;
+                } else if (isKey(payload, keyStart, keyEnd, 'b', 'n') && payload[pos] == '"') {
+                    int nameEnd = closingQuote(payload, pos + 1, end);
+                    if (nameEnd < 0) {
+                        return false;
+                    }
+                    record.setDevice(device(payload, pos + 1, nameEnd, record.device()));
+                    pos = nameEnd + 1;
+                } else if (payload[pos] == '"') {
+                    // Other string values ("u", "sv") are skipped
+                    int stringEnd = closingQuote(payload, pos + 1, end);
+                    if (stringEnd < 0) {
+                        return false;
+                    }
+                    pos = stringEnd + 1;
+                }
+            } else {
+                pos++;
+            }
+        }
+
+        if (baseTime != 0) {
+            record.setDeviceTime(baseTime + time);
+        }
+        return record.isComplete();
+    }
+
+    // Decodes a SenML payload already parsed by Gson (e.g. an element of a batch)
+    public static boolean decode(JsonObject payload, SenMLRecord record) {
+        SenMLColumns columns = record.columns();
+
+        record.reset();
+        if (!payload.has("e") || !payload.get("e").isJsonArray()) {
+            return false;
+        }
+        if (payload.has("bn")) {
+            byte[] name = payload.get("bn").getAsString().getBytes(StandardCharsets.US_ASCII);
+            record.setDevice(device(name, 0, name.length, record.device()));
+        }
+        double baseTime = payload.has("bt") ? payload.get("bt").getAsDouble() : 0;
+        boolean timed = false;
+        for (JsonElement element : payload.getAsJsonArray("e")) {
+            if (!element.isJsonObject()) {
+                continue;
+            }
+            JsonObject measurement = element.getAsJsonObject();
+            if (!measurement.has("n")) {
+                continue;
+            }
+            int column = columns.indexOf(measurement.get("n").getAsString());
+            if (column < 0) {
+                continue;
+            }
+            if (measurement.has("v")) {
+                record.setValue(column, measurement.get("v").getAsLong() / SCALE);
+            } else if (measurement.has("bv")) {
+                record.setBoolean(column, measurement.get("bv").getAsBoolean());
+            } else {
+                continue;
+            }
+            if (!timed && baseTime != 0) {
+                record.setDeviceTime(baseTime + (measurement.has("t") ? measurement.get("t").getAsDouble() : 0));
+                timed = true;
+            }
+        }
+
+        return record.isComplete();
+    }
+
+    // Address of the node in the base name payload[start, end), the current one
+    // of the record when it did not change
+    private static String device(byte[] payload, int start, int end, String current) {
+        int length = MAC_PREFIX.length;
+        if (end - start > length) {
+            int i = 0;
+            while (i < length && payload[start + i] == MAC_PREFIX[i]) {
+                i++;
+            }
+            if (i == length) {
+                start += length;
+            }
+        }
+        if (end > start && payload[end - 1] == ':') {
+            end--;
+        }
+        if (current != null && current.length() == end - start) {
+            int i = 0;
+            while (i < end - start && current.charAt(i) == payload[start + i]) {
+                i++;
+            }
+            if (i == end - start) {
+                return current;
+            }
+        }
+        return new String(payload, start, end - start, StandardCharsets.US_ASCII);
+    }
+
+    // End of the number starting at pos: sign, digits and fraction
+    private static int numberEnd(byte[] payload, int pos, int end) {
+        if (pos < end && payload[pos] == '-') {
+            pos++;
+        }
+        while (pos < end && ((payload[pos] >= '0' && payload[pos] <= '9') || payload[pos] == '.')) {
+            pos++;
+        }
+        return pos;
+    }
+
+    private static double parseNumber(byte[] payload, int start, int end) {
+        boolean negative = payload[start] == '-';
+        long number = 0;
+        double scale = 1;
+        boolean fraction = false;
+        for (int pos = negative ? start + 1 : start; pos < end; pos++) {
+            if (payload[pos] == '.') {
+                fraction = true;
+            } else {
+                number = number * 10 + (payload[pos] - '0');
+                if (fraction) {
+                    scale *= 10;
+                }
+            }
+        }
+        return (negative ? -number : number) / scale;
+    }
+
+    // Position of the quote closing a string, -1 if it is not closed
+    private static int closingQuote(byte[] payload, int pos, int end) {
+        while (pos < end) {
+            if (payload[pos] == '\\') {
+                pos += 2;
+            } else if (payload[pos] == '"') {
+                return pos;
+            } else {
+                pos++;
+            }
+        }
+        return -1;
+    }
+
+    private static int skipWhitespace(byte[] payload, int pos, int end) {
+        while (pos < end && (payload[pos] == ' ' || payload[pos] == '\t'
+                || payload[pos] == '\n' || payload[pos] == '\r')) {
+            pos++;
+        }
+        return pos;
+    }
+
+    private static boolean isKey(byte[] payload, int start, int end, char key) {
+        return end - start == 1 && payload[start] == key;
+    }
+
+    private static boolean isKey(byte[] payload, int start, int end, char first, char second) {
+        return end - start == 2 && payload[start] == first && payload[start + 1] == second;
+    }
+
+}
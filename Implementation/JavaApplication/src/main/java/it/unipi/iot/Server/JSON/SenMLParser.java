@@ -4,6 +4,8 @@ import java.util.ArrayList;
 import java.util.List;
 
 
+// String-based parser of the values of a SenML payload, replaced by
+// SenMLDecoder in the collector and kept as the baseline of SenMLBenchmark
 public class SenMLParser {
 
     public static List<String> parseSenmlPayload(String buffer) {
@@ -0,0 +1,111 @@
+package it.unipi.iot.Server.JSON;
+
+
+// Values of a SenML payload decoded into the columns of a resource.
+// A record can be reused for every payload of the resource (reset by the decoder)
+public class SenMLRecord {
+
+    private final SenMLColumns columns;
+    private final double[] values;
+    // Bit i set when column i was decoded, and when it holds a boolean value
+    private int decoded;
+    private int booleans;
+    // Node that sent the payload (address in its base name) and its uptime when
+    // the values were measured (s, base time + time of the records), NaN if not sent
+    private String device;
+    private double deviceTime = Double.NaN;
+
+    public SenMLRecord(SenMLColumns columns) {
+        this.columns = columns;
+        this.values = new double[columns.size()];
+    }
+
+    public SenMLColumns columns() {
+        return columns;
+    }
+
+    public void reset() {
+        decoded = 0;
+        booleans = 0;
+        deviceTime = Double.NaN;
+    }
+
+    public void setValue(int column, double value) {
+        values[column] = value;
+        decoded |= 1 << column;
+        booleans &= ~(1 << column);
+    }
+
+    public void setBoolean(int column, boolean value) {
+        values[column] = value ? 1.0 : 0.0;
+        decoded |= 1 << column;
+        booleans |= 1 << column;
+    }
+
+    // The device is kept by reset: a record is reused for the payloads of the same node
+    public void setDevice(String device) {
+        this.device = device;
+    }
+
+    public void setDeviceTime(double deviceTime) {
+        this.deviceTime = deviceTime;
+    }
+
+    // True when every column was decoded
+    public boolean isComplete() {
+        return decoded == (int) ((1L << values.length) - 1);
+    }
+
+    public boolean isBoolean(int column) {
+        return (booleans & (1 << column)) != 0;
+    }
+
+    public double value(int column) {
+        return values[column];
+    }
+
+    public boolean booleanValue(int column) {
+        return values[column] != 0.0;
+    }
+
+    public String device() {
+        return device;
+    }
+
+    public double deviceTime() {
+        return deviceTime;
+    }
+
+    public boolean hasDeviceTime() {
+        return !Double.isNaN(deviceTime);
+    }
+
+    // Copy kept by the ingest queue while the record is reused
+    public SenMLRecord copy() {
+        SenMLRecord copy = new SenMLRecord(columns);
+        System.arraycopy(values, 0, copy.values, 0, values.length);
+        copy.decoded = decoded;
+        copy.booleans = booleans;
+        copy.device = device;
+        copy.deviceTime = deviceTime;
+        return copy;
+    }
+
+    @Override
+    public String toString() {
+        StringBuilder string = new StringBuilder(columns.table()).append('{');
+        for (int i = 0; i < values.length; i++) {
+            if (i > 0) {
+                string.append(", ");
+            }
+            string.append(columns.column(i)).append('=');
+            if (isBoolean(i)) {
+                string.append(booleanValue(i));
+            } else {
+                string.append(values[i]);
+            }
+        }
+        return string.append('}').toString();
+    }
+
+}
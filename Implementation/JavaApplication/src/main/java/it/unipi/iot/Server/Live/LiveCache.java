@@ -0,0 +1,147 @@
+package it.unipi.iot.Server.Live;
+
+import it.unipi.iot.Server.JSON.SenMLColumns;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+
+
+// Latest values and short window of every (node, resource), updated by the
+// observe callbacks as soon as a notification is decoded, before it is
+// inserted. The live dashboard reads the cache instead of the database.
+//
+// Settings (system properties):
+//   live.windowSeconds  length of the short window (default 300)
+//   live.windowSize     largest number of notifications kept in a window (default 512)
+public class LiveCache {
+
+    private static final long WINDOW_MS = Long.getLong("live.windowSeconds", 300L) * 1000L;
+    private static final int WINDOW_SIZE = Integer.getInteger("live.windowSize", 512);
+
+    // Notifications of a resource of a node, the last one included
+    public static class Series {
+        public final String node;
+        public final String resource;
+        public final int room;
+        private final SenMLColumns columns;
+        private final boolean[] booleans;
+        // Ring of the notifications: times and values (one row of columns per notification),
+        // booleans stored as 0/1
+        private final long[] times = new long[WINDOW_SIZE];
+        private final double[] values;
+        private int next;
+        private int count;
+
+        Series(String node, String resource, int room, SenMLRecord record) {
+            this.node = node;
+            this.resource = resource;
+            this.room = room;
+            this.columns = record.columns();
+            this.values = new double[WINDOW_SIZE * columns.size()];
+            this.booleans = new boolean[columns.size()];
+            for (int i = 0; i < booleans.length; i++) {
+                booleans[i] = record.isBoolean(i);
+            }
+        }
+
+        synchronized void add(SenMLRecord record, long time) {
+            int size = columns.size();
+            times[next] = time;
+            for (int i = 0; i < size; i++) {
+                values[next * size + i] = record.value(i);
+            }
+            next = (next + 1) % WINDOW_SIZE;
+            count = Math.min(count + 1, WINDOW_SIZE);
+        }
+
+        // Last notification as an update of the stream, null if there is none
+        public synchronized String latest() {
+            if (count == 0) {
+                return null;
+            }
+            int last = (next + WINDOW_SIZE - 1) % WINDOW_SIZE;
+            StringBuilder json = header();
+            appendValues(json, last);
+            return json.append('}').toString();
+        }
+
+        // Notifications of the last live.windowSeconds, oldest first
+        public synchronized String window(long now) {
+            StringBuilder json = header().append("\"window\":[");
+            boolean first = true;
+            for (int k = count; k > 0; k--) {
+                int index = (next + WINDOW_SIZE - k) % WINDOW_SIZE;
+                if (times[index] < now - WINDOW_MS) {
+                    continue;
+                }
+                if (!first) {
+                    json.append(',');
+                }
+                json.append('{');
+                appendValues(json, index);
+                json.append('}');
+                first = false;
+            }
+            return json.append("]}").toString();
+        }
+
+        private StringBuilder header() {
+            // Addresses and resource names need no escaping
+            return new StringBuilder(128).append("{\"node\":\"").append(node)
+                    .append("\",\"resource\":\"").append(resource)
+                    .append("\",\"room\":").append(room).append(',');
+        }
+
+        private void appendValues(StringBuilder json, int index) {
+            int size = columns.size();
+            json.append("\"time\":").append(times[index]);
+            for (int i = 0; i < size; i++) {
+                json.append(",\"").append(columns.measurement(i)).append("\":");
+                double value = values[index * size + i];
+                if (booleans[i]) {
+                    json.append(value != 0.0);
+                } else {
+                    json.append(value);
+                }
+            }
+        }
+    }
+
+    private static final Map<String, Series> series = new ConcurrentHashMap<>();
+
+    // Stores a decoded notification and pushes it to the streams
+    public static void update(String resource, SenMLRecord values, String node, int room, long time) {
+        String key = node + '/' + resource;
+        Series entry = series.get(key);
+        if (entry == null || entry.room != room) {
+            // New node or node moved to another room
+            entry = new Series(node, resource, room, values);
+            series.put(key, entry);
+        }
+        entry.add(values, time);
+        LiveServer.publish(room, entry.latest());
+    }
+
+    // Series of a room, or of all the rooms if room is null
+    public static List<Series> series(Integer room) {
+        List<Series> result = new ArrayList<>();
+        for (Series entry : series.values()) {
+            if (room == null || entry.room == room) {
+                result.add(entry);
+            }
+        }
+        return result;
+    }
+
+    public static Series series(String node, String resource) {
+        return series.get(node + '/' + resource);
+    }
+
+    public static int size() {
+        return series.size();
+    }
+
+}
@@ -0,0 +1,245 @@
+package it.unipi.iot.Server.Live;
+
+import com.sun.net.httpserver.HttpExchange;
+import com.sun.net.httpserver.HttpServer;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.InetSocketAddress;
+import java.net.URLDecoder;
+import java.nio.charset.StandardCharsets;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.LongAdder;
+
+
+// HTTP feed of the live dashboard, served from the LiveCache:
+//   GET /live/stream[?room=R]             Server-Sent Events: the latest value of every
+//                                         resource, then every notification as it arrives
+//   GET /live/latest[?room=R]             latest value of every resource (JSON)
+//   GET /live/window?node=N&resource=X    notifications of the short window (JSON)
+//   GET /                                 live dashboard page
+// A stream which does not keep up with the notifications is closed; the
+// browser reconnects and starts again from the latest values.
+//
+// Settings (system properties):
+//   live.port             port of the feed, 0 to disable (default 8080)
+//   live.queue            notifications waiting to be sent to a stream (default 1024)
+//   live.metricsInterval  seconds between two metric reports, 0 to disable (default 60)
+public class LiveServer {
+
+    private static final int PORT = Integer.getInteger("live.port", 8080);
+    private static final int QUEUE = Integer.getInteger("live.queue", 1024);
+    private static final long METRICS_INTERVAL = Long.getLong("live.metricsInterval", 60L);
+    // Comment sent on an idle stream, so that the proxies keep it open
+    private static final long HEARTBEAT_SECONDS = 15;
+
+    // Stream of a dashboard, filtered by room if room is not null
+    private static class Stream {
+        final Integer room;
+        final BlockingQueue<String> queue = new ArrayBlockingQueue<>(QUEUE);
+        volatile boolean overflow;
+
+        Stream(Integer room) {
+            this.room = room;
+        }
+    }
+
+    private static final Set<Stream> streams = ConcurrentHashMap.newKeySet();
+    private static final LongAdder published = new LongAdder();
+    private static final LongAdder overflows = new LongAdder();
+    private static HttpServer server;
+
+    public static synchronized void start() {
+        if (PORT <= 0 || server != null) {
+            return;
+        }
+        try {
+            server = HttpServer.create(new InetSocketAddress(PORT), 0);
+        } catch (IOException e) {
+            System.err.println("[Live] Unable to listen on port " + PORT + ": " + e.getMessage());
+            return;
+        }
+        server.createContext("/live/stream", LiveServer::stream);
+        server.createContext("/live/latest", LiveServer::latest);
+        server.createContext("/live/window", LiveServer::window);
+        server.createContext("/", LiveServer::page);
+        // One thread per open stream
+        AtomicInteger count = new AtomicInteger();
+        server.setExecutor(Executors.newCachedThreadPool(runnable -> {
+            Thread thread = new Thread(runnable, "live-http-" + count.getAndIncrement());
+            thread.setDaemon(true);
+            return thread;
+        }));
+        server.start();
+
+        if (METRICS_INTERVAL > 0) {
+            Thread reporter = new Thread(LiveServer::report, "live-metrics");
+            reporter.setDaemon(true);
+            reporter.start();
+        }
+        System.out.println("[Live] Dashboard feed on port " + PORT);
+    }
+
+    // Pushes an update to the streams of its room
+    static void publish(int room, String update) {
+        if (update == null || streams.isEmpty()) {
+            return;
+        }
+        for (Stream stream : streams) {
+            if (stream.room != null && stream.room != room) {
+                continue;
+            }
+            if (stream.queue.offer(update)) {
+                published.increment();
+            } else if (!stream.overflow) {
+                stream.overflow = true;
+                overflows.increment();
+            }
+        }
+    }
+
+    private static void stream(HttpExchange exchange) throws IOException {
+        Stream stream = new Stream(room(exchange));
+        exchange.getResponseHeaders().set("Content-Type", "text/event-stream; charset=utf-8");
+        exchange.getResponseHeaders().set("Cache-Control", "no-cache");
+        exchange.getResponseHeaders().set("Access-Control-Allow-Origin", "*");
+        exchange.sendResponseHeaders(200, 0);
+
+        // Registered before the latest values are sent: an update in between
+        // is sent twice rather than lost
+        streams.add(stream);
+        try (OutputStream out = exchange.getResponseBody()) {
+            for (LiveCache.Series series : LiveCache.series(stream.room)) {
+                String latest = series.latest();
+                if (latest != null) {
+                    event(out, latest);
+                }
+            }
+            out.flush();
+
+            while (!stream.overflow) {
+                String update = stream.queue.poll(HEARTBEAT_SECONDS, TimeUnit.SECONDS);
+                if (update == null) {
+                    out.write(": heartbeat\n\n".getBytes(StandardCharsets.UTF_8));
+                } else {
+                    // The updates already waiting are sent with a single flush
+                    do {
+                        event(out, update);
+                    } while ((update = stream.queue.poll()) != null);
+                }
+                out.flush();
+            }
+        } catch (IOException | InterruptedException e) {
+            // The dashboard closed the stream
+        } finally {
+            streams.remove(stream);
+            exchange.close();
+        }
+    }
+
+    private static void event(OutputStream out, String data) throws IOException {
+        out.write(("data: " + data + "\n\n").getBytes(StandardCharsets.UTF_8));
+    }
+
+    private static void latest(HttpExchange exchange) throws IOException {
+        List<LiveCache.Series> series = LiveCache.series(room(exchange));
+        StringBuilder json = new StringBuilder("[");
+        for (LiveCache.Series entry : series) {
+            String latest = entry.latest();
+            if (latest != null) {
+                json.append(json.length() > 1 ? "," : "").append(latest);
+            }
+        }
+        respond(exchange, 200, "application/json", json.append(']').toString());
+    }
+
+    private static void window(HttpExchange exchange) throws IOException {
+        Map<String, String> query = query(exchange);
+        LiveCache.Series series = query.containsKey("node") && query.containsKey("resource")
+                ? LiveCache.series(query.get("node"), query.get("resource")) : null;
+        if (series == null) {
+            respond(exchange, 404, "text/plain", "Unknown node or resource");
+            return;
+        }
+        respond(exchange, 200, "application/json", series.window(System.currentTimeMillis()));
+    }
+
+    private static void page(HttpExchange exchange) throws IOException {
+        if (!exchange.getRequestURI().getPath().equals("/")) {
+            respond(exchange, 404, "text/plain", "Not found");
+            return;
+        }
+        try (InputStream input = LiveServer.class.getClassLoader().getResourceAsStream("live/index.html")) {
+            if (input == null) {
+                respond(exchange, 404, "text/plain", "Not found");
+                return;
+            }
+            respond(exchange, 200, "text/html", new String(input.readAllBytes(), StandardCharsets.UTF_8));
+        }
+    }
+
+    private static void respond(HttpExchange exchange, int status, String type, String body) throws IOException {
+        byte[] bytes = body.getBytes(StandardCharsets.UTF_8);
+        exchange.getResponseHeaders().set("Content-Type", type + "; charset=utf-8");
+        exchange.getResponseHeaders().set("Access-Control-Allow-Origin", "*");
+        exchange.sendResponseHeaders(status, bytes.length);
+        try (OutputStream out = exchange.getResponseBody()) {
+            out.write(bytes);
+        }
+    }
+
+    private static Map<String, String> query(HttpExchange exchange) {
+        Map<String, String> parameters = new HashMap<>();
+        String query = exchange.getRequestURI().getRawQuery();
+        if (query == null) {
+            return parameters;
+        }
+        for (String parameter : query.split("&")) {
+            int equals = parameter.indexOf('=');
+            if (equals > 0) {
+                parameters.put(URLDecoder.decode(parameter.substring(0, equals), StandardCharsets.UTF_8),
+                        URLDecoder.decode(parameter.substring(equals + 1), StandardCharsets.UTF_8));
+            }
+        }
+        return parameters;
+    }
+
+    // Room of the query, null for all the rooms
+    private static Integer room(HttpExchange exchange) {
+        try {
+            String room = query(exchange).get("room");
+            return room == null ? null : Integer.valueOf(room);
+        } catch (NumberFormatException e) {
+            return null;
+        }
+    }
+
+    private static void report() {
+        String last = null;
+        while (true) {
+            try {
+                Thread.sleep(TimeUnit.SECONDS.toMillis(METRICS_INTERVAL));
+            } catch (InterruptedException e) {
+                return;
+            }
+            // Only the intervals with some traffic are reported
+            String current = String.format("[Live] series=%d streams=%d published=%d overflows=%d",
+                    LiveCache.size(), streams.size(), published.sum(), overflows.sum());
+            if (!current.equals(last)) {
+                System.out.println(current);
+                last = current;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,127 @@
+package it.unipi.iot.Server;
+
+import org.eclipse.californium.core.network.CoapEndpoint;
+import org.eclipse.californium.core.network.Endpoint;
+import org.eclipse.californium.core.network.config.NetworkConfig;
+
+import java.io.IOException;
+import java.lang.management.ManagementFactory;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.LongAdder;
+
+
+// Observe relations of the registered resources, one per (ip, resource).
+// A node registering again (e.g. after a reboot) re-registers the existing
+// relation, which keeps its token; if the room changed or the relation was
+// cancelled, the relation is replaced and the previous one cancelled.
+// All the clients share one endpoint and the executor of its callbacks.
+//
+// Settings (system properties):
+//   observers.threads          threads of the shared endpoint (default 4)
+//   observers.metricsInterval  seconds between two metric reports, 0 to disable (default 60)
+public class ObserverRegistry {
+
+    private static final int THREADS = Integer.getInteger("observers.threads", 4);
+    private static final long METRICS_INTERVAL = Long.getLong("observers.metricsInterval", 60L);
+
+    private static final Map<String, CoapObserver> observers = new ConcurrentHashMap<>();
+
+    private static final LongAdder created = new LongAdder();
+    private static final LongAdder reregistered = new LongAdder();
+    private static final LongAdder replaced = new LongAdder();
+
+    private static Endpoint endpoint;
+
+    static {
+        if (METRICS_INTERVAL > 0) {
+            Thread reporter = new Thread(ObserverRegistry::report, "observers-metrics");
+            reporter.setDaemon(true);
+            reporter.start();
+        }
+    }
+
+    // Endpoint shared by the clients of the cloud application, started on first use
+    public static synchronized Endpoint endpoint() {
+        if (endpoint == null) {
+            AtomicInteger count = new AtomicInteger();
+            ScheduledExecutorService executor = Executors.newScheduledThreadPool(THREADS, runnable -> {
+                Thread thread = new Thread(runnable, "coap-client-" + count.getAndIncrement());
+                thread.setDaemon(true);
+                return thread;
+            });
+            endpoint = new CoapEndpoint(NetworkConfig.createStandardWithoutFile());
+            endpoint.setExecutor(executor);
+            try {
+                endpoint.start();
+            } catch (IOException e) {
+                throw new IllegalStateException("Unable to start the CoAP client endpoint", e);
+            }
+        }
+        return endpoint;
+    }
+
+    // Observes a resource of a node, reusing its relation if it is already observed
+    public static void observe(String ip, String resourceExposed, int room) {
+        observers.compute(ip + "/" + resourceExposed, (key, current) -> {
+            if (current != null && current.room() == room && !current.isCanceled()) {
+                current.reregister();
+                reregistered.increment();
+                return current;
+            }
+            if (current != null) {
+                current.stopObserving();
+                replaced.increment();
+            }
+            CoapObserver observer = new CoapObserver(ip, resourceExposed, room);
+            observer.startObserving();
+            created.increment();
+            return observer;
+        });
+    }
+
+    public static void stop(String ip, String resourceExposed) {
+        CoapObserver observer = observers.remove(ip + "/" + resourceExposed);
+        if (observer != null) {
+            observer.stopObserving();
+        }
+    }
+
+    public static int relations() {
+        int active = 0;
+        for (CoapObserver observer : observers.values()) {
+            if (!observer.isCanceled()) {
+                active++;
+            }
+        }
+        return active;
+    }
+
+    public static String metrics() {
+        return String.format("[Observers] relations=%d threads=%d created=%d reregistered=%d replaced=%d",
+                relations(), ManagementFactory.getThreadMXBean().getThreadCount(),
+                created.sum(), reregistered.sum(), replaced.sum());
+    }
+
+    private static void report() {
+        String last = null;
+        while (true) {
+            try {
+                Thread.sleep(TimeUnit.SECONDS.toMillis(METRICS_INTERVAL));
+            } catch (InterruptedException e) {
+                return;
+            }
+            // Only the changes are reported
+            String current = metrics();
+            if (!current.equals(last)) {
+                System.out.println(current);
+                last = current;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,103 @@
+package it.unipi.iot.Server;
+
+import org.eclipse.californium.core.CoapResource;
+import org.eclipse.californium.core.CoapServer;
+import org.eclipse.californium.core.server.resources.CoapExchange;
+
+import java.lang.management.ManagementFactory;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
+
+
+// Reconnect storm of the ObserverRegistry: a local CoAP server exposes one
+// observable resource per simulated node, and every round all the nodes
+// register again at the same time (every fourth round in another room, so
+// the relations are replaced instead of re-registered). After every round the
+// relations of the registry, the observers counted by the server and the
+// threads of the JVM must stay constant.
+//
+// Usage:
+//   java -cp target/JavaApplication-1.0-SNAPSHOT.jar it.unipi.iot.Server.ObserverStormTest [nodes] [rounds]
+// (the server listens on the default CoAP port, as the nodes)
+public class ObserverStormTest {
+
+    // Observable resource of a simulated node, changed every second
+    private static class NodeResource extends CoapResource {
+
+        NodeResource(String name) {
+            super(name);
+            setObservable(true);
+        }
+
+        @Override
+        public void handleGET(CoapExchange exchange) {
+            exchange.respond("{\"e\":[{\"n\":\"storm\",\"v\":0}]}");
+        }
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        int nodes = args.length > 0 ? Integer.parseInt(args[0]) : 500;
+        int rounds = args.length > 1 ? Integer.parseInt(args[1]) : 20;
+
+        CoapServer server = new CoapServer();
+        List<NodeResource> resources = new ArrayList<>();
+        for (int i = 0; i < nodes; i++) {
+            NodeResource resource = new NodeResource("storm" + i);
+            server.add(resource);
+            resources.add(resource);
+        }
+        server.start();
+
+        Thread changes = new Thread(() -> {
+            while (true) {
+                for (NodeResource resource : resources) {
+                    resource.changed();
+                }
+                try {
+                    Thread.sleep(1000);
+                } catch (InterruptedException e) {
+                    return;
+                }
+            }
+        }, "storm-changes");
+        changes.setDaemon(true);
+        changes.start();
+
+        String ip = "::1";
+        ExecutorService storm = Executors.newFixedThreadPool(32);
+        System.out.printf("%5s %10s %10s %8s%n", "round", "relations", "observers", "threads");
+
+        for (int round = 0; round < rounds; round++) {
+            int room = 1 + round / 4;
+            List<Runnable> registrations = new ArrayList<>();
+            for (int i = 0; i < nodes; i++) {
+                String resource = "storm" + i;
+                // Every node registers twice in the round (a flapping node)
+                registrations.add(() -> ObserverRegistry.observe(ip, resource, room));
+                registrations.add(() -> ObserverRegistry.observe(ip, resource, room));
+            }
+            for (Runnable registration : registrations) {
+                storm.execute(registration);
+            }
+
+            // The cancellations and the registrations reach the server in the next second
+            Thread.sleep(2000);
+
+            int observers = 0;
+            for (NodeResource resource : resources) {
+                observers += resource.getObserverCount();
+            }
+            System.out.printf("%5d %10d %10d %8d%n", round, ObserverRegistry.relations(), observers,
+                    ManagementFactory.getThreadMXBean().getThreadCount());
+        }
+
+        storm.shutdown();
+        storm.awaitTermination(10, TimeUnit.SECONDS);
+        System.out.println(ObserverRegistry.metrics());
+        server.destroy();
+    }
+
+}
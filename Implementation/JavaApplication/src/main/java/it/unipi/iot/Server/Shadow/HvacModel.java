@@ -0,0 +1,36 @@
+package it.unipi.iot.Server.Shadow;
+
+
+// Random forest of the HVAC, the same model of the nodes compiled as a native
+// library (JavaApplication/native, loaded from -Dshadow.library=<path>)
+public class HvacModel {
+
+    // Features of a room: temperature, humidity, CO
+    public static final int FEATURES = 3;
+
+    private static boolean loaded;
+
+    // Loads the library, false if it is not configured or cannot be loaded
+    public static synchronized boolean load() {
+        if (loaded) {
+            return true;
+        }
+        String library = System.getProperty("shadow.library");
+        if (library == null) {
+            return false;
+        }
+        try {
+            System.load(library);
+            loaded = true;
+        } catch (UnsatisfiedLinkError e) {
+            System.err.println("[Shadow] Unable to load " + library + ": " + e.getMessage());
+        }
+        return loaded;
+    }
+
+    // Predicts the status of the HVAC of the first rows of the features
+    // (FEATURES per row, as res-hvac.c) in one call: true (ON) if the room
+    // is not habitable
+    public static native void predict(float[] features, int rows, boolean[] hvac);
+
+}
@@ -0,0 +1,191 @@
+package it.unipi.iot.Server.Shadow;
+
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+
+// Windows of the values of the sensors of a room, formed as the HVAC of the
+// room does (hvac.c update_room): when every sensor which reported recently
+// has reported since the previous window, with the median of the temperatures
+// and of the humidities and the maximum CO of those sensors; as the HVAC, no
+// window is formed while no sensor of a type is fresh. A window is resolved
+// by the first status notified by the HVAC after it.
+class RoomWindow {
+
+    // Incomplete windows after which the window is formed anyway, per sensor
+    // of the room (MAX_DETECTOR_SENSOR_OFF of hvac.c)
+    private static final int MAX_INCOMPLETE = 3;
+
+    // Window of the room, predicted once it is resolved
+    static class Prediction {
+        final int room;
+        final long time;
+        final float temperature;
+        final float humidity;
+        final float co;
+        // Status predicted by the model
+        boolean hvac;
+        // Status notified by the HVAC after the window, null if unknown
+        Boolean node;
+
+        Prediction(int room, long time, float temperature, float humidity, float co) {
+            this.room = room;
+            this.time = time;
+            this.temperature = temperature;
+            this.humidity = humidity;
+            this.co = co;
+        }
+    }
+
+    // Values of a sensor, time of its last notification and whether it
+    // reported since the last window
+    private static class Sensor {
+        final double[] values = new double[2];
+        long time;
+        boolean received;
+    }
+
+    final int room;
+    private final long staleMs;
+    private final Map<String, Sensor> temperatureAndHumidity = new HashMap<>();
+    private final Map<String, Sensor> co = new HashMap<>();
+    private int incomplete;
+    // Last status notified by the HVAC of the room and its time
+    private Boolean hvac;
+    private long hvacTime;
+    // Windows waiting for the status of the HVAC, oldest first, and windows resolved
+    private final ArrayDeque<Prediction> pending = new ArrayDeque<>();
+    private final List<Prediction> resolved = new ArrayList<>();
+
+    RoomWindow(int room, long staleMs) {
+        this.room = room;
+        this.staleMs = staleMs;
+    }
+
+    synchronized void temperatureAndHumidity(String node, double temperature, double humidity, long time) {
+        Sensor sensor = temperatureAndHumidity.computeIfAbsent(node, n -> new Sensor());
+        sensor.values[0] = temperature;
+        sensor.values[1] = humidity;
+        sensor.time = time;
+        sensor.received = true;
+        update(time);
+    }
+
+    synchronized void co(String node, double value, long time) {
+        Sensor sensor = co.computeIfAbsent(node, n -> new Sensor());
+        sensor.values[0] = value;
+        sensor.time = time;
+        sensor.received = true;
+        update(time);
+    }
+
+    synchronized void hvac(boolean status, long time) {
+        if (time >= hvacTime) {
+            hvac = status;
+            hvacTime = time;
+            resolve();
+        }
+    }
+
+    // Moves the resolved windows, and those which waited for the HVAC since
+    // before graceBefore (unknown status), to the list
+    synchronized void drain(List<Prediction> windows, long graceBefore) {
+        windows.addAll(resolved);
+        resolved.clear();
+        while (!pending.isEmpty() && pending.peekFirst().time < graceBefore) {
+            windows.add(pending.pollFirst());
+        }
+    }
+
+    // Forms a window when every sensor which did not become stale reported
+    private void update(long time) {
+        long staleBefore = time - staleMs;
+        if (!anyFresh(temperatureAndHumidity, staleBefore) || !anyFresh(co, staleBefore)) {
+            // No value of some quantity: the HVAC postpones the prediction
+            return;
+        }
+        boolean complete = allReceived(temperatureAndHumidity, staleBefore) && allReceived(co, staleBefore);
+        if (!complete && incomplete < MAX_INCOMPLETE * (temperatureAndHumidity.size() + co.size())) {
+            incomplete++;
+            return;
+        }
+        pending.addLast(new Prediction(room, time, (float) median(temperatureAndHumidity, 0, staleBefore),
+                (float) median(temperatureAndHumidity, 1, staleBefore), (float) max(co, staleBefore)));
+        for (Sensor sensor : temperatureAndHumidity.values()) {
+            sensor.received = false;
+        }
+        for (Sensor sensor : co.values()) {
+            sensor.received = false;
+        }
+        incomplete = 0;
+        // The status of the HVAC may have been inserted before the last values
+        resolve();
+    }
+
+    // A status notified after a window resolves it; the windows before it
+    // were replaced before the HVAC notified them, their status is unknown
+    private void resolve() {
+        Prediction latest = null;
+        while (!pending.isEmpty() && pending.peekFirst().time < hvacTime) {
+            if (latest != null) {
+                resolved.add(latest);
+            }
+            latest = pending.pollFirst();
+        }
+        if (latest != null) {
+            latest.node = hvac;
+            resolved.add(latest);
+        }
+    }
+
+    private static boolean anyFresh(Map<String, Sensor> sensors, long staleBefore) {
+        for (Sensor sensor : sensors.values()) {
+            if (sensor.time >= staleBefore) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    private static boolean allReceived(Map<String, Sensor> sensors, long staleBefore) {
+        for (Sensor sensor : sensors.values()) {
+            if (sensor.time >= staleBefore && !sensor.received) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private static double median(Map<String, Sensor> sensors, int index, long staleBefore) {
+        double[] values = new double[sensors.size()];
+        int count = 0;
+        for (Sensor sensor : sensors.values()) {
+            if (sensor.time >= staleBefore) {
+                values[count++] = sensor.values[index];
+            }
+        }
+        if (count == 0) {
+            return -1.0;
+        }
+        Arrays.sort(values, 0, count);
+        int middle = count / 2;
+        return count % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+    }
+
+    private static double max(Map<String, Sensor> sensors, long staleBefore) {
+        double max = -1.0;
+        boolean found = false;
+        for (Sensor sensor : sensors.values()) {
+            if (sensor.time >= staleBefore) {
+                max = found ? Math.max(max, sensor.values[0]) : sensor.values[0];
+                found = true;
+            }
+        }
+        return max;
+    }
+
+}
@@ -0,0 +1,202 @@
+package it.unipi.iot.Server.Shadow;
+
+import it.unipi.iot.Server.Driver.Database;
+import it.unipi.iot.Server.JSON.SenMLColumns;
+import it.unipi.iot.Server.JSON.SenMLRecord;
+
+import java.sql.Connection;
+import java.sql.PreparedStatement;
+import java.sql.Timestamp;
+import java.sql.Types;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+
+
+// Shadow control loop: the HVAC model of the nodes runs in the collector on
+// the values ingested from the sensors of every room, to audit the decisions
+// of the HVACs. The windows of a room are formed when the HVAC of the room
+// predicts (RoomWindow) and resolved by the status it notifies after them. At
+// every tick, the resolved windows of all the rooms are predicted in a single
+// call of the native model and stored in hvac_shadow with the status notified
+// by the HVAC, flagging the disagreements.
+//
+// Enabled by -Dshadow.library=<path of libhvacmodel.so>. Settings (system properties):
+//   shadow.tickMs           interval between two batches of predictions (default 1000)
+//   shadow.staleMs          values of a sensor older than this are not used, as on the HVAC (default 40000)
+//   shadow.graceMs          longest wait of the status of the HVAC after a window (default 10000)
+//   shadow.metricsInterval  seconds between two metric reports, 0 to disable (default 60)
+public class ShadowController {
+
+    private static final long TICK_MS = Long.getLong("shadow.tickMs", 1000L);
+    private static final long STALE_MS = Long.getLong("shadow.staleMs", 40000L);
+    private static final long GRACE_MS = Long.getLong("shadow.graceMs", 10000L);
+    private static final long METRICS_INTERVAL = Long.getLong("shadow.metricsInterval", 60L);
+
+    private static final String INSERT = "INSERT IGNORE INTO hvac_shadow "
+            + "(room, timestamp, temperature, humidity, co, shadow_status, node_status, disagreement) "
+            + "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+
+    private static final ConcurrentHashMap<Integer, RoomWindow> rooms = new ConcurrentHashMap<>();
+    private static volatile boolean enabled;
+
+    // Batch of a tick, reused by the ticks (single thread)
+    private static float[] features = new float[64 * HvacModel.FEATURES];
+    private static boolean[] predictions = new boolean[64];
+
+    // Metrics, updated and reported by the tick thread
+    private static long batches;
+    private static long predicted;
+    private static long batchNanos;
+    private static long stored;
+    private static long disagreements;
+    private static long unknown;
+    private static long failed;
+
+    // Starts the ticks if the native model is available
+    public static synchronized void start() {
+        if (enabled || !HvacModel.load()) {
+            return;
+        }
+        ScheduledExecutorService executor = Executors.newSingleThreadScheduledExecutor(r -> {
+            Thread thread = new Thread(r, "shadow-tick");
+            thread.setDaemon(true);
+            return thread;
+        });
+        executor.scheduleWithFixedDelay(ShadowController::tick, TICK_MS, TICK_MS, TimeUnit.MILLISECONDS);
+        if (METRICS_INTERVAL > 0) {
+            executor.scheduleAtFixedRate(new Runnable() {
+                private String last;
+
+                @Override
+                public void run() {
+                    // Only the intervals with some traffic are reported
+                    String current = metrics();
+                    if (!current.equals(last)) {
+                        System.out.println(current);
+                        last = current;
+                    }
+                }
+            }, METRICS_INTERVAL, METRICS_INTERVAL, TimeUnit.SECONDS);
+        }
+        enabled = true;
+        System.out.println("[Shadow] HVAC predictions every " + TICK_MS + " ms");
+    }
+
+    public static boolean enabled() {
+        return enabled;
+    }
+
+    // Adds the values inserted for a node at the given time (ms) to the window of its room
+    public static void accept(SenMLRecord values, int room, String node, long time) {
+        if (!enabled) {
+            return;
+        }
+        SenMLColumns columns = values.columns();
+        int temperature = columns.indexOf("temperature");
+        int humidity = columns.indexOf("humidity");
+        int co = columns.indexOf("co");
+        int hvac = columns.indexOf("hvac");
+
+        RoomWindow window = rooms.computeIfAbsent(room, r -> new RoomWindow(r, STALE_MS));
+        if (temperature >= 0 && humidity >= 0) {
+            window.temperatureAndHumidity(node, values.value(temperature), values.value(humidity), time);
+        } else if (co >= 0) {
+            window.co(node, values.value(co), time);
+        } else if (hvac >= 0) {
+            window.hvac(values.booleanValue(hvac), time);
+        }
+    }
+
+    private static void tick() {
+        try {
+            List<RoomWindow.Prediction> resolved = new ArrayList<>();
+            long graceBefore = System.currentTimeMillis() - GRACE_MS;
+            for (RoomWindow window : rooms.values()) {
+                window.drain(resolved, graceBefore);
+            }
+            int rows = resolved.size();
+            if (rows == 0) {
+                return;
+            }
+
+            if (rows > predictions.length) {
+                grow(rows);
+            }
+            for (int i = 0; i < rows; i++) {
+                RoomWindow.Prediction window = resolved.get(i);
+                int offset = i * HvacModel.FEATURES;
+                features[offset] = window.temperature;
+                features[offset + 1] = window.humidity;
+                features[offset + 2] = window.co;
+            }
+
+            batches++;
+            long start = System.nanoTime();
+            HvacModel.predict(features, rows, predictions);
+            batchNanos += System.nanoTime() - start;
+            predicted += rows;
+            for (int i = 0; i < rows; i++) {
+                resolved.get(i).hvac = predictions[i];
+            }
+
+            store(resolved);
+        } catch (Exception e) {
+            // The next ticks go on
+            e.printStackTrace();
+        }
+    }
+
+    private static void grow(int rows) {
+        int size = Math.max(rows, predictions.length * 2);
+        features = Arrays.copyOf(features, size * HvacModel.FEATURES);
+        predictions = Arrays.copyOf(predictions, size);
+    }
+
+    // Inserts the resolved predictions with one JDBC batch
+    private static void store(List<RoomWindow.Prediction> resolved) {
+        try (Connection connection = Database.getConnection();
+             PreparedStatement ps = connection.prepareStatement(INSERT)) {
+            for (RoomWindow.Prediction prediction : resolved) {
+                ps.setInt(1, prediction.room);
+                ps.setTimestamp(2, new Timestamp(prediction.time));
+                ps.setDouble(3, prediction.temperature);
+                ps.setDouble(4, prediction.humidity);
+                ps.setDouble(5, prediction.co);
+                ps.setBoolean(6, prediction.hvac);
+                if (prediction.node == null) {
+                    ps.setNull(7, Types.BOOLEAN);
+                    ps.setNull(8, Types.BOOLEAN);
+                    unknown++;
+                } else {
+                    boolean disagreement = prediction.node != prediction.hvac;
+                    ps.setBoolean(7, prediction.node);
+                    ps.setBoolean(8, disagreement);
+                    if (disagreement) {
+                        disagreements++;
+                    }
+                }
+                ps.addBatch();
+            }
+            ps.executeBatch();
+            stored += resolved.size();
+        } catch (Exception e) {
+            // Error handling
+            failed += resolved.size();
+            e.printStackTrace();
+        }
+    }
+
+    private static String metrics() {
+        return String.format("[Shadow] rooms=%d batches=%d predicted=%d avg_batch=%.1f avg_predict_us=%.1f " +
+                        "stored=%d disagreements=%d unknown=%d failed=%d",
+                rooms.size(), batches, predicted, batches > 0 ? (double) predicted / batches : 0.0,
+                batches > 0 ? batchNanos / 1e3 / batches : 0.0,
+                stored, disagreements, unknown, failed);
+    }
+
+}
@@ -0,0 +1,128 @@
+package it.unipi.iot.UserApplication;
+
+import it.unipi.iot.Server.ObserverRegistry;
+import org.eclipse.californium.core.CoapClient;
+import org.eclipse.californium.core.CoapHandler;
+import org.eclipse.californium.core.CoapResponse;
+import org.eclipse.californium.core.coap.MediaTypeRegistry;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+
+
+// Commands of the User Application to the movement nodes (the button of the
+// door of a room). Every room keeps one client on the shared endpoint of the
+// cloud application; the commands are confirmable POSTs sent asynchronously,
+// completed by the response or by the end of the retransmissions, and their
+// round-trip latency is recorded per room.
+public class CommandService {
+
+    private static final String PAYLOAD = "Button pressed from UserApplication.";
+
+    // Result of the command of a room
+    public static class Result {
+        public final int room;
+        public final boolean success;
+        // Response code, null if the node did not respond
+        public final String code;
+        public final long nanos;
+
+        Result(int room, boolean success, String code, long nanos) {
+            this.room = room;
+            this.success = success;
+            this.code = code;
+            this.nanos = nanos;
+        }
+    }
+
+    private static final Map<Integer, CoapClient> clients = new ConcurrentHashMap<>();
+    private static final Map<Integer, LatencyHistogram> latencies = new ConcurrentHashMap<>();
+    private static volatile int lastRoom = -1;
+
+    // Movement node of a room, replacing the previous one of the room
+    public static void register(int room, String uri) {
+        clients.compute(room, (r, client) -> {
+            if (client != null && client.getURI().equals(uri)) {
+                return client;
+            }
+            return new CoapClient(uri).setEndpoint(ObserverRegistry.endpoint());
+        });
+        latencies.computeIfAbsent(room, r -> new LatencyHistogram());
+        lastRoom = room;
+    }
+
+    public static boolean isRegistered(int room) {
+        return clients.containsKey(room);
+    }
+
+    // Room of the last movement node registered, -1 if there is none
+    public static int lastRoom() {
+        return lastRoom;
+    }
+
+    public static List<Integer> rooms() {
+        List<Integer> rooms = new ArrayList<>(clients.keySet());
+        rooms.sort(null);
+        return rooms;
+    }
+
+    // Presses the button of a room
+    public static CompletableFuture<Result> press(int room) {
+        CompletableFuture<Result> future = new CompletableFuture<>();
+        CoapClient client = clients.get(room);
+        if (client == null) {
+            future.complete(new Result(room, false, null, 0));
+            return future;
+        }
+
+        long start = System.nanoTime();
+        client.post(new CoapHandler() {
+            @Override
+            public void onLoad(CoapResponse response) {
+                long nanos = System.nanoTime() - start;
+                latencies.get(room).record(nanos);
+                future.complete(new Result(room, response.isSuccess(), response.getCode().toString(), nanos));
+            }
+
+            @Override
+            public void onError() {
+                // Retransmissions exhausted or request rejected
+                latencies.get(room).fail();
+                future.complete(new Result(room, false, null, System.nanoTime() - start));
+            }
+        }, PAYLOAD, MediaTypeRegistry.TEXT_PLAIN);
+        return future;
+    }
+
+    // Presses the buttons of several rooms at once, completed when all the rooms responded
+    public static CompletableFuture<List<Result>> press(Collection<Integer> rooms) {
+        List<CompletableFuture<Result>> futures = new ArrayList<>(rooms.size());
+        for (int room : rooms) {
+            futures.add(press(room));
+        }
+        return CompletableFuture.allOf(futures.toArray(new CompletableFuture[0])).thenApply(done -> {
+            List<Result> results = new ArrayList<>(futures.size());
+            for (CompletableFuture<Result> future : futures) {
+                results.add(future.join());
+            }
+            return results;
+        });
+    }
+
+    // Latency histograms of the rooms with some commands
+    public static Map<Integer, LatencyHistogram> latencies() {
+        Map<Integer, LatencyHistogram> result = new TreeMap<>();
+        for (Map.Entry<Integer, LatencyHistogram> entry : latencies.entrySet()) {
+            if (entry.getValue().count() > 0 || entry.getValue().failures() > 0) {
+                result.put(entry.getKey(), entry.getValue());
+            }
+        }
+        return result;
+    }
+
+}
@@ -0,0 +1,80 @@
+package it.unipi.iot.UserApplication;
+
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.atomic.LongAccumulator;
+import java.util.concurrent.atomic.LongAdder;
+
+
+// Round-trip latency of the commands of a room in fixed buckets (ms):
+// the percentiles are the upper bounds of their buckets
+public class LatencyHistogram {
+
+    // Upper bounds of the buckets, the last bucket has no bound
+    private static final long[] BOUNDS_MS = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000};
+
+    private final AtomicLongArray buckets = new AtomicLongArray(BOUNDS_MS.length + 1);
+    private final LongAdder count = new LongAdder();
+    private final LongAdder totalNanos = new LongAdder();
+    private final LongAccumulator maxNanos = new LongAccumulator(Long::max, 0);
+    // Commands without response, not in the buckets
+    private final LongAdder failures = new LongAdder();
+
+    public void record(long nanos) {
+        long ms = nanos / 1_000_000;
+        int bucket = 0;
+        while (bucket < BOUNDS_MS.length && ms >= BOUNDS_MS[bucket]) {
+            bucket++;
+        }
+        buckets.incrementAndGet(bucket);
+        count.increment();
+        totalNanos.add(nanos);
+        maxNanos.accumulate(nanos);
+    }
+
+    public void fail() {
+        failures.increment();
+    }
+
+    public long failures() {
+        return failures.sum();
+    }
+
+    public long count() {
+        return count.sum();
+    }
+
+    // Upper bound (ms) of the bucket of the percentile, -1 without samples
+    // or if it is beyond the last bound
+    public long percentile(int p) {
+        long total = 0;
+        for (int i = 0; i < buckets.length(); i++) {
+            total += buckets.get(i);
+        }
+        long rank = (total * p + 99) / 100;
+        long seen = 0;
+        for (int i = 0; i < BOUNDS_MS.length && total > 0; i++) {
+            seen += buckets.get(i);
+            if (seen >= rank) {
+                return BOUNDS_MS[i];
+            }
+        }
+        return -1;
+    }
+
+    @Override
+    public String toString() {
+        long samples = count.sum();
+        StringBuilder string = new StringBuilder(String.format("count=%d failures=%d avg_ms=%.1f max_ms=%.1f p50_ms<%d p99_ms<%d |",
+                samples, failures.sum(), samples > 0 ? totalNanos.sum() / 1e6 / samples : 0.0, maxNanos.get() / 1e6,
+                percentile(50), percentile(99)));
+        for (int i = 0; i < buckets.length(); i++) {
+            long bucket = buckets.get(i);
+            if (bucket > 0) {
+                string.append(' ').append(i < BOUNDS_MS.length ? "<" + BOUNDS_MS[i] : ">=" + BOUNDS_MS[i - 1])
+                        .append(':').append(bucket);
+            }
+        }
+        return string.toString();
+    }
+
+}
@@ -1,71 +1,73 @@
 package it.unipi.iot.UserApplication;
 
-import org.eclipse.californium.core.CoapClient;
-import org.eclipse.californium.core.CoapResponse;
-import org.eclipse.californium.core.coap.MediaTypeRegistry;
-
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
 import java.util.Scanner;
 
 
 public class UserApplication {
 
-    private static String coapUri = null;
+    // Signalled when the first movement node registers
+    private static final Object ready = new Object();
 
     public static void startGUI() {
 
         Scanner scanner = new Scanner(System.in);
         boolean running = true;
-        boolean loadingMessageDisplayed = false;
-        boolean readyMessageDisplayed = false;
 
-        while (running) {
-            
-            if (coapUri == null) {
-              
-                if (!loadingMessageDisplayed) {
-                    System.out.println("===========================================");
-                    System.out.println("Application is loading...");
-                    System.out.println("Waiting for URI initialization.");
-                    System.out.println("===========================================");
-                    loadingMessageDisplayed = true;
+        System.out.println("===========================================");
+        System.out.println("Application is loading...");
+        System.out.println("Waiting for URI initialization.");
+        System.out.println("===========================================");
+
+        // Waiting for a movement node instead of polling
+        synchronized (ready) {
+            while (CommandService.lastRoom() < 0) {
+                try {
+                    ready.wait();
+                } catch (InterruptedException e) {
+                    Thread.currentThread().interrupt();
+                    return;
                 }
+            }
+        }
+        System.out.println("===========================================");
+        System.out.println("Application ready.");
 
-            } 
-            else {
+        while (running) {
 
-                if (!readyMessageDisplayed) {
-                    System.out.println("===========================================");
-                    System.out.println("Application ready.");
-                    readyMessageDisplayed = true;
-                }
-                System.out.println("===========================================");
-                System.out.println("Type 'p' to press the button.");
-                System.out.println("Type 'q' to quit.");
-                System.out.println("===========================================");
+            System.out.println("===========================================");
+            System.out.println("Type 'p' to press the button.");
+            System.out.println("Type 'p <room> [<room> ...]' or 'p all' to press the buttons of several rooms.");
+            System.out.println("Type 's' to show the command latencies.");
+            System.out.println("Type 'q' to quit.");
+            System.out.println("===========================================");
 
-                String input = scanner.nextLine();
+            if (!scanner.hasNextLine()) {
+                break;
+            }
+            String[] input = scanner.nextLine().trim().split("\\s+");
 
-                if (input.equalsIgnoreCase("p")) {
-                
-                    sendPostRequest(coapUri, "Button pressed from UserApplication.");
+            if (input[0].equalsIgnoreCase("p")) {
 
-                } 
-                else if (input.equalsIgnoreCase("q")) {
-                    running = false;
-                } 
-                else {
-                    System.out.println("===========================================");
-                    System.out.println("Unrecognized command.");
-                    System.out.println("Use 'p' to press the button or 'q' to quit.");
-                    System.out.println("===========================================");
+                List<Integer> rooms = rooms(input);
+                if (rooms != null) {
+                    press(rooms);
                 }
+
             }
-            // Delay to avoid too fast looping
-            try {
-                Thread.sleep(500);
+            else if (input[0].equalsIgnoreCase("s")) {
+                showLatencies();
+            }
+            else if (input[0].equalsIgnoreCase("q")) {
+                running = false;
             } 
-            catch (InterruptedException e) {
-                e.printStackTrace();
+            else {
+                System.out.println("===========================================");
+                System.out.println("Unrecognized command.");
+                System.out.println("Use 'p' to press the button, 's' to show the latencies or 'q' to quit.");
+                System.out.println("===========================================");
             }
 
         }
@@ -74,11 +76,14 @@ public class UserApplication {
         System.out.println("Application terminated.");
     }
 
-    public static void initializeUri(String uri) {
+    public static void initializeUri(int room, String uri) {
 
         if (uri.startsWith("coap://")) {
-            coapUri = uri;
-            // System.out.println("URI initialized: " + coapUri);
+            CommandService.register(room, uri);
+            synchronized (ready) {
+                ready.notifyAll();
+            }
+            // System.out.println("URI initialized: " + uri);
         } 
         else {
             // System.out.println("Invalid URI. Make sure it starts with 'coap://'.");
@@ -86,19 +91,61 @@ public class UserApplication {
 
     }
 
-    private static void sendPostRequest(String uri, String payload) {
-
-        CoapClient client = new CoapClient(uri);
-        CoapResponse response = client.post(payload, MediaTypeRegistry.TEXT_PLAIN);
+    // Rooms of a press command, null if a room is not valid
+    private static List<Integer> rooms(String[] input) {
 
-        if (response != null) {
-            System.out.println("--> Button pressed.");
-            // System.out.println("Response code: " + response.getCode());
-            // System.out.println("Response text: " + response.getResponseText());
-        } 
+        List<Integer> rooms = new ArrayList<>();
+        if (input.length == 1) {
+            // Room of the last movement node registered
+            rooms.add(CommandService.lastRoom());
+        }
+        else if (input[1].equalsIgnoreCase("all")) {
+            rooms.addAll(CommandService.rooms());
+        }
         else {
-            System.out.println("Error, button NOT pressed.");
-            // System.out.println("No response received.");
+            for (int i = 1; i < input.length; i++) {
+                try {
+                    int room = Integer.parseInt(input[i]);
+                    if (!CommandService.isRegistered(room)) {
+                        System.out.println("Error, no movement node in room " + room + ".");
+                        return null;
+                    }
+                    rooms.add(room);
+                } catch (NumberFormatException e) {
+                    System.out.println("Error, invalid room " + input[i] + ".");
+                    return null;
+                }
+            }
+        }
+        return rooms;
+
+    }
+
+    // The commands of all the rooms are sent at once, without waiting for the responses
+    private static void press(List<Integer> rooms) {
+
+        CommandService.press(rooms).thenAccept(results -> {
+            for (CommandService.Result result : results) {
+                if (result.success) {
+                    System.out.printf("--> Button pressed in room %d (%.1f ms).%n", result.room, result.nanos / 1e6);
+                }
+                else {
+                    System.out.println("Error, button NOT pressed in room " + result.room
+                            + (result.code != null ? " (" + result.code + ")." : "."));
+                }
+            }
+        });
+
+    }
+
+    private static void showLatencies() {
+
+        Map<Integer, LatencyHistogram> latencies = CommandService.latencies();
+        if (latencies.isEmpty()) {
+            System.out.println("No command sent yet.");
+        }
+        for (Map.Entry<Integer, LatencyHistogram> entry : latencies.entrySet()) {
+            System.out.println("Room " + entry.getKey() + ": " + entry.getValue());
         }
 
     }
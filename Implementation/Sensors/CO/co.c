@@ -5,9 +5,23 @@
 #include "sys/log.h"
 #include "os/dev/leds.h"
 #include "json-senml.h"
+#include "sensor-model.h"
 #include "coap-observe-client.h"
 #include "sys/clock.h"
 
+#ifdef VAULTSTATUS_MULTICAST
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uiplib.h"
+#endif
+
+#ifdef WATERMARK
+#include "watermark.h"
+#endif
+
+#ifdef BENCH
+#include "bench.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -22,9 +36,25 @@
 // Discovery resource exposed by the CoAP server
 #define DISCOVERY_RESOURCE "/discovery"
 
+// Room where the node is deployed (set with make ROOM=<id>)
+#ifndef ROOM_ID
+#define ROOM_ID 0
+#endif
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+#define ROOM_ID_STR STRINGIFY(ROOM_ID)
+
 // Resource exposed by the VaultStatus
 #define VAULTSTATUS_RESOURCE "vaultstatus"
 
+#ifdef VAULTSTATUS_MULTICAST
+// Multicast group where the VaultStatus of the room publishes the room state
+#define ROOMSTATE_MULTICAST_GROUP "ff03::76:" ROOM_ID_STR
+// Resource receiving the room state published on the multicast group
+#define ROOMSTATE_RESOURCE "roomstate"
+extern coap_resource_t res_roomstate;
+#endif
+
 // Resource exposed by the current node
 #define RESOURCE_NAME "co"
 
@@ -51,28 +81,56 @@ static bool sleeping_mode = true;
 
 bool hvac_status = false;
 
+#ifndef VAULTSTATUS_MULTICAST
 // Observe the vaultstatus resource
 static coap_observee_t *vaultstatus_resource;
+#endif
 
 PROCESS(co_sensor_process, "CO sensor process");
 AUTOSTART_PROCESSES(&co_sensor_process);
 
-// Callback for the VaultStatus
-static void notification_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
+// Update the sensor state with the room state published by the VaultStatus
+void vaultstatus_update(const uint8_t *buffer, int buffer_size)
 {
-  static senml_payload_t payload;
-  static senml_measurement_t measurements[1];
-  payload.measurements = measurements;
-  payload.num_measurements = 1;
-
-  static char base_name[MAX_STRING_LEN];
-  static char name[1][MAX_STRING_LEN];
-  static char unit[1][MAX_STRING_LEN];
+  senml_payload_t *payload = senml_scratch_acquire(1);
+  if(payload == NULL){
+    LOG_ERR("[CO] SenML scratch arena in use.\n");
+    return;
+  }
+
+  LOG_DBG("[CO] In vaultstatus_update payload->num_measurements is: %d\n", payload->num_measurements);
+
+  if(parse_senml_payload((char*)buffer, buffer_size, payload) == -1){
+    LOG_ERR("[CO] ERROR in parsing the payload.\n");
+    senml_scratch_release();
+    return;
+  }
+
+  // If all LEDs are off, the human operator is no longer in the room -> sleep mode is on
+  // If the red LED is on, HVAC is active -> sleep mode is off
+  // If the green LED is on, HVAC is inactive -> sleep mode is off
+  // If the yellow LED is on, the human operator is waiting -> sleep mode is off
   
-  payload.base_name = base_name;
-  payload.measurements[0].name = name[0];
-  payload.measurements[0].unit = unit[0];
+  int led_value = (int) payload->measurements[0].value.v;
+  senml_scratch_release();
+
+  sleeping_mode = false;
+  hvac_status = false;
+  if(led_value == ALL_LEDS_OFF)
+    sleeping_mode = true;
+  if(led_value == LEDS_RED)
+    hvac_status = true;
+
+  if(!sleeping_mode){
+    // Wake up the CO sensor
+    process_poll(&co_sensor_process);
+  }
+}
 
+#ifndef VAULTSTATUS_MULTICAST
+// Callback for the VaultStatus
+static void notification_callback(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
+{
   const uint8_t *buffer = NULL;
 
   int buffer_size = 0;
@@ -85,30 +143,7 @@ static void notification_callback(coap_observee_t *obs, void *notification, coap
 
       LOG_DBG("[CO] Notification received from VaultStatus: %s\n", buffer);
       
-      LOG_DBG("[CO] In notification_callback payload.num_measurements is: %d\n", payload.num_measurements);
-
-      if(parse_senml_payload((char*)buffer, buffer_size, &payload) == -1){
-        LOG_ERR("[CO] ERROR in parsing the payload.\n");
-        return;
-      } 
-
-      // If all LEDs are off, the human operator is no longer in the room -> sleep mode is on
-      // If the red LED is on, HVAC is active -> sleep mode is off
-      // If the green LED is on, HVAC is inactive -> sleep mode is off
-      // If the yellow LED is on, the human operator is waiting -> sleep mode is off
-      
-      int led_value = (int) payload.measurements[0].value.v;
-      sleeping_mode = false;
-      hvac_status = false;
-      if(led_value == ALL_LEDS_OFF)
-        sleeping_mode = true;
-      if(led_value == LEDS_RED)
-        hvac_status = true;
-
-      if(!sleeping_mode){
-        // Wake up the CO sensor
-        process_poll(&co_sensor_process);
-      }
+      vaultstatus_update(buffer, buffer_size);
 
       break;
 
@@ -134,6 +169,7 @@ static void notification_callback(coap_observee_t *obs, void *notification, coap
   }
 
 }
+#endif
 
 // Callback for the registration to the CoAP server
 void client_chunk_handler(coap_message_t *response){
@@ -157,8 +193,10 @@ void client_chunk_handler(coap_message_t *response){
 
 // IP of the node where the VaultStatus is located
 static char ip_vault_status[40];
+#ifndef VAULTSTATUS_MULTICAST
 // CoAP endpoint of the node where the VaultStatus is located
 static coap_endpoint_t coap_vault_status;
+#endif
 
 // Callback for the request of the IP of the node where the VaultStatus is located
 void resource_request_handler(coap_message_t *response){
@@ -192,6 +230,16 @@ PROCESS_THREAD(co_sensor_process, ev, data)
 
   PROCESS_BEGIN();
 
+#ifdef WATERMARK
+  // Sampling of the high-water marks of the buffers and tables
+  watermark_init();
+#endif
+
+#ifdef BENCH
+  // Reports of the duty cycle for Simulation/benchmark.py
+  bench_init();
+#endif
+
   // Activate the resource exposed by the current node
   coap_activate_resource(&res_co, RESOURCE_NAME);
 
@@ -203,6 +251,8 @@ PROCESS_THREAD(co_sensor_process, ev, data)
     // Initializing the request
 		coap_init_message(request, COAP_TYPE_CON, COAP_POST, 0);
 		coap_set_header_uri_path(request, REGISTRATION_RESOURCE);
+    // Room of the node
+    coap_set_header_uri_query(request, "room=" ROOM_ID_STR);
     // Setting the payload of the request
 		coap_set_payload(request, (uint8_t *)RESOURCE_NAME, sizeof(RESOURCE_NAME) - 1);
 	
@@ -217,6 +267,16 @@ PROCESS_THREAD(co_sensor_process, ev, data)
 		}
 	}
 
+#ifdef VAULTSTATUS_MULTICAST
+  // Joining the multicast group where the VaultStatus publishes the room state,
+  // instead of opening an observe relation with the VaultStatus
+  uip_ipaddr_t roomstate_group;
+  uiplib_ipaddrconv(ROOMSTATE_MULTICAST_GROUP, &roomstate_group);
+  if(uip_ds6_maddr_add(&roomstate_group) == NULL){
+    LOG_ERR("[CO] Unable to join the room state multicast group\n");
+  }
+  coap_activate_resource(&res_roomstate, ROOMSTATE_RESOURCE);
+#else
   retry_requests = MAX_REQUESTS;
   // Requesting the IP of the node where there is the VaultStatus
   while(retry_requests!=0){
@@ -225,7 +285,7 @@ PROCESS_THREAD(co_sensor_process, ev, data)
 		coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
 		coap_set_header_uri_path(request, DISCOVERY_RESOURCE);
     // Add uri query to the request
-    coap_set_header_uri_query(request, "requested_resource="VAULTSTATUS_RESOURCE);  
+    coap_set_header_uri_query(request, "requested_resource="VAULTSTATUS_RESOURCE"&room=" ROOM_ID_STR);  
     
     // Sending the request
 		COAP_BLOCKING_REQUEST(&coap_server, request, resource_request_handler);
@@ -246,8 +306,10 @@ PROCESS_THREAD(co_sensor_process, ev, data)
   // Observing the VaultStatus
   vaultstatus_resource = coap_obs_request_registration(&coap_vault_status, VAULTSTATUS_RESOURCE, notification_callback, NULL);
 
-  // Initializing the sampling timer
-  etimer_set(&timer, SAMPLE_INTERVAL);
+#endif
+
+  // Initializing the sampling timer (the recorded interval when a trace is replayed)
+  etimer_set(&timer, sensor_model_interval(SAMPLE_INTERVAL));
 
   while(1) {
 
@@ -263,14 +325,16 @@ PROCESS_THREAD(co_sensor_process, ev, data)
       PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&timer));
       if(!sleeping_mode){
         res_co.trigger();
-        etimer_reset(&timer);
+        etimer_reset_with_new_interval(&timer, sensor_model_interval(SAMPLE_INTERVAL));
       }
     }
 
   }
 
+#ifndef VAULTSTATUS_MULTICAST
   // Stopping the observation
   coap_obs_remove_observee(vaultstatus_resource);
+#endif
 
   PROCESS_END();
 }
@@ -5,19 +5,16 @@
 #include <stdbool.h>
 #include "json-senml.h"
 #include "sys/log.h"
-#include "random-number-generator.h"
+#include "sensor-model.h"
+
+#ifdef BENCH
+#include "bench.h"
+#endif
 
 
 #define LOG_MODULE "App"
 #define LOG_LEVEL LOG_LEVEL_APP
 
-// Minimum and maximum CO levels
-#define MIN_CO_LEVEL 0.00117
-#define MAX_CO_LEVEL 0.01442
-
-// Maximum percentage variation (5%)
-#define MAX_PERCENTAGE_VARIATION 0.05
-
 static void res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
 static void res_event_handler(void);
 
@@ -33,6 +30,12 @@ EVENT_RESOURCE(res_co,
 // Current CO level (-1.0 means not initialized)
 static double co_level = -1.0;
 
+// Simulated room of the sensor
+static sensor_model_t model;
+
+// Uptime of the node when the CO level was measured (s)
+static unsigned long sample_time;
+
 extern bool hvac_status;
 
 static void
@@ -40,15 +43,21 @@ res_event_handler(void)
 {
     // New CO level measurement
     if(co_level < 0){
-        // Initialize the CO level with a random value
-        co_level = init_random_number(MIN_CO_LEVEL, MAX_CO_LEVEL);
+        // Initialize the simulated room
+        sensor_model_init(&model);
     }
     else{
-        co_level = generate_random_number(MIN_CO_LEVEL, MAX_CO_LEVEL, co_level, MAX_PERCENTAGE_VARIATION, hvac_status);
+        sensor_model_step(&model, hvac_status);
     }
+    co_level = (double) model.co / SENSOR_MODEL_SCALE;
+    sample_time = clock_seconds();
     
     // LOG_DBG("New CO level: %f\n", co_level);
     
+#ifdef BENCH
+    bench_stage("sample");
+#endif
+
     // Notify all the observers
     coap_notify_observers(&res_co);
 }
@@ -58,23 +67,26 @@ static void
 res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
 {
     
-    static senml_measurement_t measurements[1];
+    senml_payload_t *payload = senml_scratch_acquire(1);
+    if (payload == NULL) {
+        coap_set_status_code(response, SERVICE_UNAVAILABLE_5_03);
+        LOG_ERR("[CO] SenML scratch arena in use\n");
+        return;
+    }
+    // Base time: uptime of the node, the time of the measurement is relative to it
+    unsigned long now = clock_seconds();
+    payload->base_time = (int) now;
+
+    senml_measurement_t *measurements = payload->measurements;
     measurements[0].name = "co";
     measurements[0].type = SENML_TYPE_V;
     measurements[0].value.v = co_level;
     measurements[0].unit = "ppm";
-    static char base_name[BASE_NAME_LEN];
-    get_mac_address(base_name);
-
-    static senml_payload_t payload = {
-        .base_name = base_name,
-        .base_time = 0,
-        .version = 1,
-        .measurements = measurements,
-        .num_measurements = 1
-    };
+    measurements[0].time = (int) sample_time - (int) now;
+    get_mac_address(payload->base_name);
 
-    int length = create_senml_payload((char *)buffer, preferred_size, &payload);
+    int length = create_senml_payload((char *)buffer, preferred_size, payload);
+    senml_scratch_release();
 
     if (length < 0) {
         coap_set_status_code(response, BAD_REQUEST_4_00);
@@ -82,6 +94,9 @@ res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buff
     } else {
         coap_set_header_content_format(response, APPLICATION_JSON);
         coap_set_payload(response, buffer, length);
+#ifdef BENCH
+        bench_stage("sent");
+#endif
         
         // Printing the payload for debugging purposes
         LOG_DBG("[CO] Sending the payload: %s\n", buffer);
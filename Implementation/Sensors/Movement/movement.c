@@ -5,6 +5,14 @@
 #include "sys/etimer.h"
 #include "sys/log.h"
 
+#ifdef WATERMARK
+#include "watermark.h"
+#endif
+
+#ifdef BENCH
+#include "bench.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -16,6 +24,14 @@
 // Registration resource exposed by the CoAP server
 #define REGISTRATION_RESOURCE "/register"
 
+// Room where the node is deployed (set with make ROOM=<id>)
+#ifndef ROOM_ID
+#define ROOM_ID 0
+#endif
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+#define ROOM_ID_STR STRINGIFY(ROOM_ID)
+
 // Resource exposed by the current node
 #define RESOURCE_NAME "movement"
 
@@ -61,6 +77,16 @@ PROCESS_THREAD(pir_motion_sensor_process, ev, data)
 
   PROCESS_BEGIN();
 
+#ifdef WATERMARK
+  // Sampling of the high-water marks of the buffers and tables
+  watermark_init();
+#endif
+
+#ifdef BENCH
+  // Reports of the duty cycle for Simulation/benchmark.py
+  bench_init();
+#endif
+
   // Activate the resource exposed by the current node	
   coap_activate_resource(&res_movement, RESOURCE_NAME);
   
@@ -72,6 +98,8 @@ PROCESS_THREAD(pir_motion_sensor_process, ev, data)
     // Initializing the request
 		coap_init_message(request, COAP_TYPE_CON, COAP_POST, 0);
 		coap_set_header_uri_path(request, REGISTRATION_RESOURCE);
+    // Room of the node
+    coap_set_header_uri_query(request, "room=" ROOM_ID_STR);
     // Setting the payload of the request
 		coap_set_payload(request, (uint8_t *)RESOURCE_NAME, sizeof(RESOURCE_NAME) - 1);
 
@@ -32,6 +32,12 @@
 #define PROJECT_CONF_H_
 
 
+#ifdef RAM_PROFILE
+// Buffers and tables sized from the high-water marks measured in simulation
+// (make PROFILE=1, see Simulation/ram_profiles.py)
+#include RAM_PROFILE
+#else
+
 // Set the max response payload before enable fragmentation:
 
 #undef REST_MAX_CHUNK_SIZE
@@ -50,9 +56,22 @@
 
 #undef UIP_CONF_BUFFER_SIZE
 #define UIP_CONF_BUFFER_SIZE    680 // 240
+#endif
+
 
+// Records of the SenML scratch arena shared by all the payloads of the node.
+// Only the movement record is encoded, nothing is decoded:
+
+#define SENML_ARENA_CONF_RECORDS    1
+#define SENML_ARENA_CONF_STRING_RECORDS    0
 
 #define LOG_LEVEL_APP LOG_LEVEL_DBG
 
 
+#ifdef VAULTSTATUS_MULTICAST
+// Multicast engine forwarding the room state published by the VaultStatus
+#undef UIP_MCAST6_CONF_ENGINE
+#define UIP_MCAST6_CONF_ENGINE UIP_MCAST6_ENGINE_MPL
+#endif
+
 #endif /* PROJECT_CONF_H_ */
@@ -36,22 +36,20 @@ res_event_handler(void)
 static void
 res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
 {
-    static senml_measurement_t measurements[1];
+    senml_payload_t *payload = senml_scratch_acquire(1);
+    if (payload == NULL) {
+        coap_set_status_code(response, SERVICE_UNAVAILABLE_5_03);
+        LOG_ERR("[Movement] SenML scratch arena in use\n");
+        return;
+    }
+    senml_measurement_t *measurements = payload->measurements;
     measurements[0].name = "movement";
     measurements[0].type = SENML_TYPE_BV;
     measurements[0].value.bv = vault_activated;
-    static char base_name[BASE_NAME_LEN];
-    get_mac_address(base_name);
-
-    static senml_payload_t payload = {
-        .base_name = base_name,
-        .base_time = 0,
-        .version = 1,
-        .measurements = measurements,
-        .num_measurements = 1
-    };
+    get_mac_address(payload->base_name);
 
-    int length = create_senml_payload((char *)buffer, preferred_size, &payload);
+    int length = create_senml_payload((char *)buffer, preferred_size, payload);
+    senml_scratch_release();
 
     if (length < 0) {
         coap_set_status_code(response, BAD_REQUEST_4_00);
@@ -5,24 +5,16 @@
 #include <stdbool.h>
 #include "json-senml.h"
 #include "sys/log.h"
-#include "random-number-generator.h"
+#include "sensor-model.h"
+
+#ifdef BENCH
+#include "bench.h"
+#endif
 
 
 #define LOG_MODULE "App"
 #define LOG_LEVEL LOG_LEVEL_APP
 
-// Minimum and maximum temperature levels
-#define MIN_TEMPERATURE_LEVEL 0.0
-#define MAX_TEMPERATURE_LEVEL 30.6
-// Maximum percentage variation for temperature (5%)
-#define MAX_PERCENTAGE_VARIATION_TEMPERATURE 0.05
-
-// Minimum and maximum humidity levels
-#define MIN_HUMIDITY_LEVEL 1.1
-#define MAX_HUMIDITY_LEVEL 99.9
-// Maximum percentage variation for humidity (5%)
-#define MAX_PERCENTAGE_VARIATION_HUMIDITY 0.05
-
 static void res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
 static void res_event_handler(void);
 
@@ -38,6 +30,12 @@ EVENT_RESOURCE(res_temperatureandhumidity,
 static double temperature_level = -1.0;
 static double humidity_level = -1.0;
 
+// Simulated room of the sensor
+static sensor_model_t model;
+
+// Uptime of the node when temperature and humidity were measured (s)
+static unsigned long sample_time;
+
 extern bool hvac_status;
 
 static void
@@ -45,18 +43,23 @@ res_event_handler(void)
 {
     // New Measurement of temperature and humidity
     if(temperature_level < 0 && humidity_level < 0) {
-        // Initialize the temperature and humidity levels with random values
-        temperature_level = init_random_number(MIN_TEMPERATURE_LEVEL, MAX_TEMPERATURE_LEVEL);
-        humidity_level = init_random_number(MIN_HUMIDITY_LEVEL, MAX_HUMIDITY_LEVEL);
+        // Initialize the simulated room
+        sensor_model_init(&model);
     }
     else{
-        temperature_level = generate_random_number(MIN_TEMPERATURE_LEVEL, MAX_TEMPERATURE_LEVEL, temperature_level, MAX_PERCENTAGE_VARIATION_TEMPERATURE, hvac_status);
-        humidity_level = generate_random_number(MIN_HUMIDITY_LEVEL, MAX_HUMIDITY_LEVEL, humidity_level, MAX_PERCENTAGE_VARIATION_HUMIDITY, hvac_status);
+        sensor_model_step(&model, hvac_status);
     }
+    temperature_level = (double) model.temperature / SENSOR_MODEL_SCALE;
+    humidity_level = (double) model.humidity / SENSOR_MODEL_SCALE;
+    sample_time = clock_seconds();
     
     // LOG_DBG("New Temperature level: %f\n", temperature_level);
     // LOG_DBG("New Humidity level: %f\n", humidity_level);
 
+#ifdef BENCH
+    bench_stage("sample");
+#endif
+
     // Notify all the observers
     coap_notify_observers(&res_temperatureandhumidity);
 }
@@ -66,32 +69,36 @@ static void
 res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
 {
     
-    static senml_measurement_t measurements[2];
+    senml_payload_t *payload = senml_scratch_acquire(2);
+    if (payload == NULL) {
+        coap_set_status_code(response, SERVICE_UNAVAILABLE_5_03);
+        LOG_ERR("[TemperatureAndHumidity] SenML scratch arena in use\n");
+        return;
+    }
+    // Base time: uptime of the node, the time of the measurements is relative to it
+    unsigned long now = clock_seconds();
+    payload->base_time = (int) now;
+
+    senml_measurement_t *measurements = payload->measurements;
 
     // Temperature Measurement
     measurements[0].name = "temperature";
     measurements[0].type = SENML_TYPE_V;
     measurements[0].value.v = temperature_level;
     measurements[0].unit = "Cel";
+    measurements[0].time = (int) sample_time - (int) now;
     
     // Humidity Measurement
     measurements[1].name = "humidity";
     measurements[1].type = SENML_TYPE_V;
     measurements[1].value.v = humidity_level;
     measurements[1].unit = "%RH";
+    measurements[1].time = measurements[0].time;
 
-    static char base_name[BASE_NAME_LEN];
-    get_mac_address(base_name);
-
-    static senml_payload_t payload = {
-        .base_name = base_name,
-        .base_time = 0,
-        .version = 1,
-        .measurements = measurements,
-        .num_measurements = 2
-    };
+    get_mac_address(payload->base_name);
 
-    int length = create_senml_payload((char *)buffer, preferred_size, &payload);
+    int length = create_senml_payload((char *)buffer, preferred_size, payload);
+    senml_scratch_release();
 
     if (length < 0) {
         coap_set_status_code(response, BAD_REQUEST_4_00);
@@ -99,6 +106,9 @@ res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buff
     } else {
         coap_set_header_content_format(response, APPLICATION_JSON);
         coap_set_payload(response, buffer, length);
+#ifdef BENCH
+        bench_stage("sent");
+#endif
         
         // Printing the payload for debugging purposes
         LOG_DBG("[TemperatureAndHumidity] Sending the payload: %s\n", buffer);
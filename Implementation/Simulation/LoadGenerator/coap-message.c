@@ -0,0 +1,235 @@
+#include <string.h>
+#include "coap-message.h"
+
+// Bounded writer of a message
+typedef struct {
+    uint8_t *pos;
+    size_t remaining;
+    int overflow;
+    uint16_t last_option;
+} coap_writer_t;
+
+
+static void writer_append(coap_writer_t *writer, const void *data, size_t len) {
+    if (len > writer->remaining) {
+        writer->overflow = 1;
+        return;
+    }
+    memcpy(writer->pos, data, len);
+    writer->pos += len;
+    writer->remaining -= len;
+}
+
+static void writer_append_byte(coap_writer_t *writer, uint8_t byte) {
+    writer_append(writer, &byte, 1);
+}
+
+/**
+ * Appends an option, the options must be appended in ascending order.
+ */
+static void writer_append_option(coap_writer_t *writer, uint16_t number, const void *value, size_t len) {
+    uint16_t delta = number - writer->last_option;
+    uint8_t nibbles[2];
+    uint8_t extended[4];
+    size_t extended_len = 0;
+    uint16_t fields[2] = { delta, (uint16_t) len };
+
+    for (int i = 0; i < 2; i++) {
+        if (fields[i] < 13) {
+            nibbles[i] = fields[i];
+        } else if (fields[i] < 269) {
+            nibbles[i] = 13;
+            extended[extended_len++] = fields[i] - 13;
+        } else {
+            nibbles[i] = 14;
+            extended[extended_len++] = (fields[i] - 269) >> 8;
+            extended[extended_len++] = (fields[i] - 269) & 0xFF;
+        }
+    }
+
+    writer_append_byte(writer, (nibbles[0] << 4) | nibbles[1]);
+    writer_append(writer, extended, extended_len);
+    writer_append(writer, value, len);
+    writer->last_option = number;
+}
+
+static void writer_append_uint_option(coap_writer_t *writer, uint16_t number, uint32_t value) {
+    uint8_t bytes[4];
+    size_t len = 0;
+
+    // Minimal big-endian encoding, 0 is the empty value
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (len > 0 || (value >> shift) != 0) {
+            bytes[len++] = (value >> shift) & 0xFF;
+        }
+    }
+    writer_append_option(writer, number, bytes, len);
+}
+
+/**
+ * Appends one option per segment of the string, split by the separator.
+ */
+static void writer_append_segments(coap_writer_t *writer, uint16_t number, const char *str, char separator) {
+    while (*str != '\0') {
+        const char *end = strchr(str, separator);
+        size_t len = end != NULL ? (size_t) (end - str) : strlen(str);
+        if (len > 0) {
+            writer_append_option(writer, number, str, len);
+        }
+        str += len;
+        if (*str == separator) {
+            str++;
+        }
+    }
+}
+
+
+/**
+ * Initializes a message without token, options and payload.
+ */
+void coap_msg_init(coap_msg_t *msg, coap_type_t type, uint8_t code, uint16_t mid) {
+    memset(msg, 0, sizeof(*msg));
+    msg->type = type;
+    msg->code = code;
+    msg->mid = mid;
+    msg->observe = -1;
+    msg->content_format = -1;
+}
+
+
+/**
+ * Serializes a message.
+ *
+ * @param msg The message.
+ * @param buffer The buffer where the message is written.
+ * @param buffer_size The size of the buffer.
+ * @return The length of the message or -1 if it does not fit in the buffer.
+ */
+int coap_msg_serialize(const coap_msg_t *msg, uint8_t *buffer, size_t buffer_size) {
+    coap_writer_t writer = { buffer, buffer_size, 0, 0 };
+
+    writer_append_byte(&writer, (COAP_VERSION << 6) | (msg->type << 4) | msg->token_len);
+    writer_append_byte(&writer, msg->code);
+    writer_append_byte(&writer, msg->mid >> 8);
+    writer_append_byte(&writer, msg->mid & 0xFF);
+    writer_append(&writer, msg->token, msg->token_len);
+
+    if (msg->observe >= 0) {
+        writer_append_uint_option(&writer, COAP_OPTION_OBSERVE, (uint32_t) msg->observe);
+    }
+    writer_append_segments(&writer, COAP_OPTION_URI_PATH, msg->uri_path, '/');
+    if (msg->content_format >= 0) {
+        writer_append_uint_option(&writer, COAP_OPTION_CONTENT_FORMAT, (uint32_t) msg->content_format);
+    }
+    writer_append_segments(&writer, COAP_OPTION_URI_QUERY, msg->uri_query, '&');
+
+    if (msg->payload_len > 0) {
+        writer_append_byte(&writer, 0xFF);
+        writer_append(&writer, msg->payload, msg->payload_len);
+    }
+
+    return writer.overflow ? -1 : (int) (buffer_size - writer.remaining);
+}
+
+
+static uint32_t read_uint(const uint8_t *value, size_t len) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < len && i < 4; i++) {
+        result = (result << 8) | value[i];
+    }
+    return result;
+}
+
+/**
+ * Appends a segment to a string option joined by the separator.
+ */
+static void append_segment(char *str, const uint8_t *value, size_t len, char separator) {
+    size_t used = strlen(str);
+    size_t needed = (used > 0 ? 1 : 0) + len;
+    if (used + needed >= COAP_MAX_URI_LEN) {
+        return;
+    }
+    if (used > 0) {
+        str[used++] = separator;
+    }
+    memcpy(str + used, value, len);
+    str[used + len] = '\0';
+}
+
+
+/**
+ * Parses a message, the payload points into the buffer.
+ *
+ * @param msg The parsed message.
+ * @param buffer The received datagram.
+ * @param length The length of the datagram.
+ * @return 0 on success or -1 if the message is malformed.
+ */
+int coap_msg_parse(coap_msg_t *msg, const uint8_t *buffer, size_t length) {
+    const uint8_t *pos = buffer + 4;
+    const uint8_t *end = buffer + length;
+    uint16_t number = 0;
+
+    if (length < 4 || (buffer[0] >> 6) != COAP_VERSION) {
+        return -1;
+    }
+    coap_msg_init(msg, (buffer[0] >> 4) & 0x03, buffer[1], (buffer[2] << 8) | buffer[3]);
+    msg->token_len = buffer[0] & 0x0F;
+    if (msg->token_len > COAP_MAX_TOKEN_LEN || pos + msg->token_len > end) {
+        return -1;
+    }
+    memcpy(msg->token, pos, msg->token_len);
+    pos += msg->token_len;
+
+    while (pos < end) {
+        if (*pos == 0xFF) {
+            msg->payload = pos + 1;
+            msg->payload_len = end - (pos + 1);
+            break;
+        }
+
+        uint32_t fields[2] = { *pos >> 4, *pos & 0x0F };
+        pos++;
+        for (int i = 0; i < 2; i++) {
+            if (fields[i] == 13) {
+                if (pos >= end) {
+                    return -1;
+                }
+                fields[i] = 13 + *pos++;
+            } else if (fields[i] == 14) {
+                if (pos + 1 >= end) {
+                    return -1;
+                }
+                fields[i] = 269 + ((pos[0] << 8) | pos[1]);
+                pos += 2;
+            } else if (fields[i] == 15) {
+                return -1;
+            }
+        }
+        if (pos + fields[1] > end) {
+            return -1;
+        }
+
+        number += fields[0];
+        switch (number) {
+            case COAP_OPTION_OBSERVE:
+                msg->observe = (int32_t) read_uint(pos, fields[1]);
+                break;
+            case COAP_OPTION_URI_PATH:
+                append_segment(msg->uri_path, pos, fields[1], '/');
+                break;
+            case COAP_OPTION_CONTENT_FORMAT:
+                msg->content_format = (int32_t) read_uint(pos, fields[1]);
+                break;
+            case COAP_OPTION_URI_QUERY:
+                append_segment(msg->uri_query, pos, fields[1], '&');
+                break;
+            default:
+                // Other options are ignored
+                break;
+        }
+        pos += fields[1];
+    }
+
+    return 0;
+}
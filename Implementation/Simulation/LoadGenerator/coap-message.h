@@ -0,0 +1,58 @@
+#ifndef COAP_MESSAGE_H
+#define COAP_MESSAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Subset of CoAP (RFC 7252, RFC 7641) spoken by the VoltVault nodes
+
+#define COAP_VERSION 1
+#define COAP_MAX_TOKEN_LEN 8
+#define COAP_MAX_URI_LEN 128
+
+typedef enum {
+    COAP_TYPE_CON = 0,
+    COAP_TYPE_NON = 1,
+    COAP_TYPE_ACK = 2,
+    COAP_TYPE_RST = 3
+} coap_type_t;
+
+// Codes as class.detail
+#define COAP_CODE(class, detail) (((class) << 5) | (detail))
+#define COAP_EMPTY          COAP_CODE(0, 0)
+#define COAP_GET            COAP_CODE(0, 1)
+#define COAP_POST           COAP_CODE(0, 2)
+#define COAP_CREATED        COAP_CODE(2, 1)
+#define COAP_CONTENT        COAP_CODE(2, 5)
+#define COAP_NOT_FOUND      COAP_CODE(4, 4)
+#define COAP_CODE_CLASS(code) ((code) >> 5)
+#define COAP_CODE_DETAIL(code) ((code) & 0x1F)
+
+#define COAP_OPTION_OBSERVE         6
+#define COAP_OPTION_URI_PATH        11
+#define COAP_OPTION_CONTENT_FORMAT  12
+#define COAP_OPTION_URI_QUERY       15
+
+#define COAP_CONTENT_TEXT_PLAIN 0
+#define COAP_CONTENT_JSON       50
+
+typedef struct {
+    coap_type_t type;
+    uint8_t code;
+    uint16_t mid;
+    uint8_t token[COAP_MAX_TOKEN_LEN];
+    uint8_t token_len;
+    // Uri-Path segments joined by '/' and Uri-Query options joined by '&'
+    char uri_path[COAP_MAX_URI_LEN];
+    char uri_query[COAP_MAX_URI_LEN];
+    int32_t observe;            // -1 if the option is missing
+    int32_t content_format;     // -1 if the option is missing
+    const uint8_t *payload;
+    size_t payload_len;
+} coap_msg_t;
+
+void coap_msg_init(coap_msg_t *msg, coap_type_t type, uint8_t code, uint16_t mid);
+int coap_msg_serialize(const coap_msg_t *msg, uint8_t *buffer, size_t buffer_size);
+int coap_msg_parse(coap_msg_t *msg, const uint8_t *buffer, size_t length);
+
+#endif  // COAP_MESSAGE_H
@@ -0,0 +1,10 @@
+#ifndef CONTIKI_H
+#define CONTIKI_H
+
+// Host build of the SenML library: the few definitions it takes from
+// Contiki-NG. The scratch arena is sized by its defaults (json-senml.h)
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif  // CONTIKI_H
@@ -0,0 +1,805 @@
+/*
+ * Load generator of virtual VoltVault motes for the cloud application.
+ *
+ * Every room is emulated by a CO sensor, a temperature and humidity sensor
+ * and an HVAC, each with its own IPv6 address and CoAP port 5683, speaking
+ * the protocol of the nodes: registration (POST /register?room=<id>),
+ * discovery (GET /discovery?requested_resource=...&room=<id>) and an
+ * observable resource notifying SenML payloads built by Utility/JSON_SenML.
+ * The rooms are started in steps to find the load where the latencies of
+ * the server start to grow.
+ *
+ * The addresses of the motes are taken from a prefix routed to the loopback
+ * interface (see README.md), the server must listen on another address
+ * (-Dcoap.address=::1).
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "coap-message.h"
+#include "contiki.h"
+#include "json-senml.h"
+#include "random-number-generator.h"
+
+#ifndef IPV6_FREEBIND
+#define IPV6_FREEBIND 78
+#endif
+
+#define COAP_PORT 5683
+#define BUFFER_SIZE 512
+
+// Retransmissions of the confirmable requests (RFC 7252 defaults)
+#define ACK_TIMEOUT_MS 2000
+#define MAX_RETRANSMIT 4
+// Wait before registering again after a failed registration
+#define REGISTRATION_RETRY_MS 5000
+// Every COAP_OBSERVE_REFRESH_INTERVAL-th notification is confirmable, as in Contiki-NG
+#define OBSERVE_REFRESH_INTERVAL 20
+#define MAX_OBSERVERS 4
+
+typedef enum {
+    MOTE_CO,
+    MOTE_TEMPERATUREANDHUMIDITY,
+    MOTE_HVAC,
+    MOTE_KINDS
+} mote_kind_t;
+
+static const char *resource_names[MOTE_KINDS] = { "co", "temperatureandhumidity", "hvac" };
+
+typedef enum {
+    STATE_IDLE,
+    STATE_REGISTERING,
+    STATE_DISCOVERING,
+    STATE_RUNNING
+} mote_state_t;
+
+// Confirmable request waiting for its response
+typedef struct {
+    int active;
+    uint16_t mid;
+    uint8_t token[4];
+    int acked;              // Empty ACK received, the response is separate
+    int retransmissions;
+    double sent_ms;         // First transmission
+    double timeout_ms;      // Next retransmission
+    uint8_t datagram[BUFFER_SIZE];
+    int length;
+} request_t;
+
+typedef struct {
+    struct sockaddr_in6 address;
+    uint8_t token[COAP_MAX_TOKEN_LEN];
+    uint8_t token_len;
+    uint16_t con_mid;       // Confirmable notification waiting for its ACK
+    double con_sent_ms;     // 0 if none
+} observer_t;
+
+typedef struct {
+    int fd;
+    int index;
+    int room;
+    mote_kind_t kind;
+    mote_state_t state;
+    struct sockaddr_in6 address;
+    char base_name[MAX_STRING_LEN];
+    uint16_t next_mid;
+
+    request_t request;
+    int discoveries;        // Discovery requests still to send
+    double start_ms;
+    double next_notification_ms;
+
+    observer_t observers[MAX_OBSERVERS];
+    int num_observers;
+    uint32_t observe_seq;
+
+    // Simulated readings
+    double co, temperature, humidity;
+    bool hvac;
+} mote_t;
+
+// Samples of a latency (ms)
+typedef struct {
+    double *values;
+    size_t count, capacity;
+} samples_t;
+
+typedef struct {
+    samples_t registration;
+    samples_t discovery;
+    samples_t notification_ack;
+    unsigned long notifications;
+    unsigned long registration_failures;
+    unsigned long discovery_failures;
+    unsigned long notification_timeouts;
+    unsigned long resets;
+    unsigned long send_errors;
+} stats_t;
+
+static struct {
+    struct sockaddr_in6 server;
+    struct in6_addr prefix;
+    int rooms;
+    int first_room;
+    int step;
+    int step_interval;
+    int duration;
+    int interval_ms;
+    int hvac_interval_ms;
+} config;
+
+static mote_t *motes;
+static int num_motes;
+static int active_motes;
+static stats_t step_stats, total_stats;
+
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double jitter_ms(int max_ms) {
+    return random_number_between(0, max_ms);
+}
+
+static void samples_add(samples_t *samples, double value) {
+    if (samples->count == samples->capacity) {
+        samples->capacity = samples->capacity ? samples->capacity * 2 : 256;
+        samples->values = realloc(samples->values, samples->capacity * sizeof(double));
+        if (samples->values == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    samples->values[samples->count++] = value;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Nearest-rank percentile of the samples, -1 without samples.
+ */
+static double percentile(samples_t *samples, int p) {
+    if (samples->count == 0) {
+        return -1;
+    }
+    qsort(samples->values, samples->count, sizeof(double), compare_doubles);
+    size_t rank = (samples->count * p + 99) / 100;
+    return samples->values[rank > 0 ? rank - 1 : 0];
+}
+
+static void stats_reset(stats_t *stats) {
+    samples_t *samples[] = { &stats->registration, &stats->discovery, &stats->notification_ack };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        free(samples[i]->values);
+    }
+    memset(stats, 0, sizeof(*stats));
+}
+
+// Samples and counters are recorded for the current step and for the whole run
+#define STATS_ADD(field, value) do { \
+        samples_add(&step_stats.field, (value)); \
+        samples_add(&total_stats.field, (value)); \
+    } while (0)
+#define STATS_COUNT(field) do { step_stats.field++; total_stats.field++; } while (0)
+
+
+static void send_datagram(mote_t *mote, const struct sockaddr_in6 *to, const uint8_t *datagram, int length) {
+    if (sendto(mote->fd, datagram, length, 0, (const struct sockaddr *) to, sizeof(*to)) < 0) {
+        STATS_COUNT(send_errors);
+    }
+}
+
+static void send_message(mote_t *mote, const struct sockaddr_in6 *to, const coap_msg_t *msg) {
+    uint8_t datagram[BUFFER_SIZE];
+    int length = coap_msg_serialize(msg, datagram, sizeof(datagram));
+    if (length > 0) {
+        send_datagram(mote, to, datagram, length);
+    }
+}
+
+
+/**
+ * Sends a confirmable request to the server, retransmitted until its response.
+ */
+static void send_request(mote_t *mote, uint8_t code, const char *path, const char *query, const char *payload) {
+    request_t *request = &mote->request;
+    coap_msg_t msg;
+
+    coap_msg_init(&msg, COAP_TYPE_CON, code, mote->next_mid++);
+    uint32_t token = random_number_next();
+    memcpy(msg.token, &token, sizeof(token));
+    msg.token_len = sizeof(token);
+    snprintf(msg.uri_path, sizeof(msg.uri_path), "%s", path);
+    snprintf(msg.uri_query, sizeof(msg.uri_query), "%s", query);
+    if (payload != NULL) {
+        msg.payload = (const uint8_t *) payload;
+        msg.payload_len = strlen(payload);
+    }
+
+    request->length = coap_msg_serialize(&msg, request->datagram, sizeof(request->datagram));
+    request->active = 1;
+    request->mid = msg.mid;
+    memcpy(request->token, msg.token, sizeof(request->token));
+    request->acked = 0;
+    request->retransmissions = 0;
+    request->sent_ms = now_ms();
+    request->timeout_ms = request->sent_ms + ACK_TIMEOUT_MS;
+    send_datagram(mote, &config.server, request->datagram, request->length);
+}
+
+static void send_registration(mote_t *mote) {
+    char query[32];
+    snprintf(query, sizeof(query), "room=%d", mote->room);
+    mote->state = STATE_REGISTERING;
+    send_request(mote, COAP_POST, "register", query, resource_names[mote->kind]);
+}
+
+/**
+ * Sends the next discovery request of the mote, as its firmware does after
+ * the registration: the sensors look for the VaultStatus of the room, the
+ * HVAC for all the temperature and humidity and the CO sensors.
+ */
+static void send_discovery(mote_t *mote) {
+    char query[96];
+    if (mote->kind == MOTE_HVAC) {
+        const char *resource = mote->discoveries == 2 ? "temperatureandhumidity" : "co";
+        snprintf(query, sizeof(query), "requested_resource=%s&room=%d&all=1", resource, mote->room);
+    } else {
+        snprintf(query, sizeof(query), "requested_resource=vaultstatus&room=%d", mote->room);
+    }
+    mote->discoveries--;
+    mote->state = STATE_DISCOVERING;
+    send_request(mote, COAP_GET, "discovery", query, NULL);
+}
+
+static void start_running(mote_t *mote) {
+    mote->state = STATE_RUNNING;
+    int interval = mote->kind == MOTE_HVAC ? config.hvac_interval_ms : config.interval_ms;
+    mote->next_notification_ms = now_ms() + jitter_ms(interval);
+}
+
+/**
+ * Handles the response to the pending request of the mote.
+ */
+static void request_completed(mote_t *mote, uint8_t code) {
+    double latency = now_ms() - mote->request.sent_ms;
+    mote->request.active = 0;
+
+    if (mote->state == STATE_REGISTERING) {
+        if (code == COAP_CREATED) {
+            STATS_ADD(registration, latency);
+            mote->discoveries = mote->kind == MOTE_HVAC ? 2 : 1;
+            send_discovery(mote);
+        } else {
+            STATS_COUNT(registration_failures);
+            mote->state = STATE_IDLE;
+            mote->start_ms = now_ms() + REGISTRATION_RETRY_MS;
+        }
+    } else if (mote->state == STATE_DISCOVERING) {
+        // 4.04 is an answer as well (e.g. no VaultStatus among the virtual motes)
+        if (COAP_CODE_CLASS(code) == 2 || code == COAP_NOT_FOUND) {
+            STATS_ADD(discovery, latency);
+        } else {
+            STATS_COUNT(discovery_failures);
+        }
+        if (mote->discoveries > 0) {
+            send_discovery(mote);
+        } else {
+            start_running(mote);
+        }
+    }
+}
+
+static void request_timeout(mote_t *mote) {
+    request_t *request = &mote->request;
+
+    if (request->retransmissions < MAX_RETRANSMIT && !request->acked) {
+        request->retransmissions++;
+        request->timeout_ms = now_ms() + ((double) ACK_TIMEOUT_MS * (1 << request->retransmissions));
+        send_datagram(mote, &config.server, request->datagram, request->length);
+        return;
+    }
+
+    // Given up, also for a separate response that never came
+    request->active = 0;
+    if (mote->state == STATE_REGISTERING) {
+        STATS_COUNT(registration_failures);
+        mote->state = STATE_IDLE;
+        mote->start_ms = now_ms() + REGISTRATION_RETRY_MS;
+    } else {
+        STATS_COUNT(discovery_failures);
+        if (mote->discoveries > 0) {
+            send_discovery(mote);
+        } else {
+            start_running(mote);
+        }
+    }
+}
+
+
+/**
+ * Builds the SenML representation of the resource of the mote.
+ *
+ * @return The length of the payload or -1 on error.
+ */
+static int build_payload(mote_t *mote, char *buffer, uint16_t buffer_size) {
+    int num_measurements = mote->kind == MOTE_TEMPERATUREANDHUMIDITY ? 2 : 1;
+    senml_payload_t *payload = senml_scratch_acquire(num_measurements);
+    if (payload == NULL) {
+        return -1;
+    }
+    senml_measurement_t *measurements = payload->measurements;
+
+    switch (mote->kind) {
+        case MOTE_CO:
+            measurements[0].name = "co";
+            measurements[0].type = SENML_TYPE_V;
+            measurements[0].value.v = mote->co;
+            measurements[0].unit = "ppm";
+            break;
+        case MOTE_TEMPERATUREANDHUMIDITY:
+            measurements[0].name = "temperature";
+            measurements[0].type = SENML_TYPE_V;
+            measurements[0].value.v = mote->temperature;
+            measurements[0].unit = "Cel";
+            measurements[1].name = "humidity";
+            measurements[1].type = SENML_TYPE_V;
+            measurements[1].value.v = mote->humidity;
+            measurements[1].unit = "%RH";
+            break;
+        default:
+            measurements[0].name = "hvac";
+            measurements[0].type = SENML_TYPE_BV;
+            measurements[0].value.bv = mote->hvac;
+            break;
+    }
+    // Base name of the mote instead of the simulated MAC address of get_mac_address()
+    payload->base_name = mote->base_name;
+    // Uptime of the motes: the monotonic clock of the host, sampled at the notification
+    payload->base_time = (int) (now_ms() / 1000);
+
+    int length = create_senml_payload(buffer, buffer_size, payload);
+    senml_scratch_release();
+    return length;
+}
+
+static void update_readings(mote_t *mote) {
+    switch (mote->kind) {
+        case MOTE_CO:
+            mote->co += random_number_between(-50, 50) / 100.0;
+            mote->co = mote->co < 0 ? 0 : mote->co > 50 ? 50 : mote->co;
+            break;
+        case MOTE_TEMPERATUREANDHUMIDITY:
+            mote->temperature += random_number_between(-20, 20) / 100.0;
+            mote->humidity += random_number_between(-50, 50) / 100.0;
+            mote->humidity = mote->humidity < 20 ? 20 : mote->humidity > 90 ? 90 : mote->humidity;
+            break;
+        default:
+            mote->hvac = !mote->hvac;
+            break;
+    }
+}
+
+static observer_t *find_observer(mote_t *mote, const coap_msg_t *msg) {
+    for (int i = 0; i < mote->num_observers; i++) {
+        observer_t *observer = &mote->observers[i];
+        if (observer->token_len == msg->token_len
+            && memcmp(observer->token, msg->token, msg->token_len) == 0) {
+            return observer;
+        }
+    }
+    return NULL;
+}
+
+static void remove_observer(mote_t *mote, observer_t *observer) {
+    *observer = mote->observers[--mote->num_observers];
+}
+
+static void notify_observers(mote_t *mote) {
+    char payload[BUFFER_SIZE];
+    int length = build_payload(mote, payload, sizeof(payload));
+    if (length < 0) {
+        return;
+    }
+    mote->observe_seq++;
+
+    for (int i = 0; i < mote->num_observers; i++) {
+        observer_t *observer = &mote->observers[i];
+        int confirmable = mote->observe_seq % OBSERVE_REFRESH_INTERVAL == 0;
+        coap_msg_t msg;
+
+        // A confirmable notification without ACK removes the observer, as in Contiki-NG
+        if (observer->con_sent_ms > 0 && now_ms() - observer->con_sent_ms > ACK_TIMEOUT_MS * 2) {
+            STATS_COUNT(notification_timeouts);
+            remove_observer(mote, observer);
+            i--;
+            continue;
+        }
+
+        coap_msg_init(&msg, confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, COAP_CONTENT, mote->next_mid++);
+        memcpy(msg.token, observer->token, observer->token_len);
+        msg.token_len = observer->token_len;
+        msg.observe = mote->observe_seq & 0xFFFFFF;
+        msg.content_format = COAP_CONTENT_JSON;
+        msg.payload = (const uint8_t *) payload;
+        msg.payload_len = length;
+        if (confirmable && observer->con_sent_ms == 0) {
+            observer->con_mid = msg.mid;
+            observer->con_sent_ms = now_ms();
+        }
+        send_message(mote, &observer->address, &msg);
+        STATS_COUNT(notifications);
+    }
+}
+
+/**
+ * Handles a GET of the resource of the mote: registers or cancels an
+ * observation and responds with the current representation.
+ */
+static void handle_get(mote_t *mote, const coap_msg_t *request, const struct sockaddr_in6 *from) {
+    char payload[BUFFER_SIZE];
+    coap_msg_t response;
+    observer_t *observer = find_observer(mote, request);
+
+    if (request->observe == 0 && observer == NULL && mote->num_observers < MAX_OBSERVERS) {
+        observer = &mote->observers[mote->num_observers++];
+        memset(observer, 0, sizeof(*observer));
+        observer->address = *from;
+        memcpy(observer->token, request->token, request->token_len);
+        observer->token_len = request->token_len;
+    } else if (request->observe == 1 && observer != NULL) {
+        remove_observer(mote, observer);
+        observer = NULL;
+    }
+
+    if (request->type == COAP_TYPE_CON) {
+        coap_msg_init(&response, COAP_TYPE_ACK, COAP_CONTENT, request->mid);
+    } else {
+        coap_msg_init(&response, COAP_TYPE_NON, COAP_CONTENT, mote->next_mid++);
+    }
+    memcpy(response.token, request->token, request->token_len);
+    response.token_len = request->token_len;
+
+    if (strcmp(request->uri_path, resource_names[mote->kind]) != 0) {
+        response.code = COAP_NOT_FOUND;
+    } else {
+        int length = build_payload(mote, payload, sizeof(payload));
+        if (observer != NULL && request->observe == 0) {
+            response.observe = mote->observe_seq & 0xFFFFFF;
+        }
+        response.content_format = COAP_CONTENT_JSON;
+        response.payload = (const uint8_t *) payload;
+        response.payload_len = length > 0 ? length : 0;
+    }
+    send_message(mote, from, &response);
+}
+
+static void handle_datagram(mote_t *mote, const uint8_t *datagram, size_t length, const struct sockaddr_in6 *from) {
+    coap_msg_t msg;
+    request_t *request = &mote->request;
+
+    if (coap_msg_parse(&msg, datagram, length) < 0) {
+        return;
+    }
+
+    // Response to the pending request, piggybacked or separate
+    if (request->active && (msg.type == COAP_TYPE_ACK || msg.type == COAP_TYPE_CON || msg.type == COAP_TYPE_NON)
+        && COAP_CODE_CLASS(msg.code) >= 2 && msg.token_len == sizeof(request->token)
+        && memcmp(msg.token, request->token, sizeof(request->token)) == 0) {
+        if (msg.type == COAP_TYPE_CON) {
+            coap_msg_t ack;
+            coap_msg_init(&ack, COAP_TYPE_ACK, COAP_EMPTY, msg.mid);
+            send_message(mote, from, &ack);
+        }
+        request_completed(mote, msg.code);
+        return;
+    }
+
+    if (msg.type == COAP_TYPE_ACK && msg.code == COAP_EMPTY) {
+        if (request->active && msg.mid == request->mid) {
+            // Separate response: wait for it without retransmitting
+            request->acked = 1;
+            request->timeout_ms = now_ms() + ACK_TIMEOUT_MS * (1 << MAX_RETRANSMIT);
+            return;
+        }
+    }
+
+    if (msg.type == COAP_TYPE_ACK || msg.type == COAP_TYPE_RST) {
+        // ACK or RST of a confirmable notification
+        for (int i = 0; i < mote->num_observers; i++) {
+            observer_t *observer = &mote->observers[i];
+            if (observer->con_sent_ms > 0 && observer->con_mid == msg.mid) {
+                if (msg.type == COAP_TYPE_ACK) {
+                    STATS_ADD(notification_ack, now_ms() - observer->con_sent_ms);
+                    observer->con_sent_ms = 0;
+                } else {
+                    STATS_COUNT(resets);
+                    remove_observer(mote, observer);
+                }
+                return;
+            }
+        }
+        if (msg.type == COAP_TYPE_RST) {
+            // RST of a non-confirmable notification: the observer is gone
+            for (int i = 0; i < mote->num_observers; i++) {
+                if (memcmp(&mote->observers[i].address, from, sizeof(*from)) == 0) {
+                    STATS_COUNT(resets);
+                    remove_observer(mote, &mote->observers[i]);
+                    break;
+                }
+            }
+        }
+        return;
+    }
+
+    // The server observes the resource as soon as the mote is registered
+    if (msg.code == COAP_GET) {
+        handle_get(mote, &msg, from);
+    } else if (COAP_CODE_CLASS(msg.code) == 0 && msg.code != COAP_EMPTY && msg.type == COAP_TYPE_CON) {
+        // Other methods
+        coap_msg_t response;
+        coap_msg_init(&response, COAP_TYPE_ACK, COAP_CODE(4, 5), msg.mid);
+        memcpy(response.token, msg.token, msg.token_len);
+        response.token_len = msg.token_len;
+        send_message(mote, from, &response);
+    }
+}
+
+
+static void run_timers(mote_t *mote, double now) {
+    if (mote->state == STATE_IDLE && now >= mote->start_ms) {
+        send_registration(mote);
+    } else if (mote->request.active && now >= mote->request.timeout_ms) {
+        request_timeout(mote);
+    } else if (mote->state == STATE_RUNNING && now >= mote->next_notification_ms) {
+        int interval = mote->kind == MOTE_HVAC ? config.hvac_interval_ms : config.interval_ms;
+        update_readings(mote);
+        notify_observers(mote);
+        mote->next_notification_ms += interval;
+        if (mote->next_notification_ms < now) {
+            // The generator is late: the notifications are not sent in bursts
+            mote->next_notification_ms = now + interval;
+        }
+    }
+}
+
+static int open_mote(mote_t *mote, int epoll_fd) {
+    int one = 1;
+
+    mote->fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (mote->fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    // The addresses of the prefix are not assigned to an interface
+    setsockopt(mote->fd, IPPROTO_IPV6, IPV6_FREEBIND, &one, sizeof(one));
+    if (bind(mote->fd, (struct sockaddr *) &mote->address, sizeof(mote->address)) < 0) {
+        char address[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &mote->address.sin6_addr, address, sizeof(address));
+        fprintf(stderr, "Unable to bind [%s]:%d: %s\n", address, COAP_PORT, strerror(errno));
+        return -1;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = mote->index };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, mote->fd, &event) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    return 0;
+}
+
+static void init_mote(mote_t *mote, int index) {
+    memset(mote, 0, sizeof(*mote));
+    mote->index = index;
+    mote->room = config.first_room + index / MOTE_KINDS;
+    mote->kind = index % MOTE_KINDS;
+    mote->state = STATE_IDLE;
+
+    // <prefix>::<index + 1>
+    mote->address.sin6_family = AF_INET6;
+    mote->address.sin6_port = htons(COAP_PORT);
+    mote->address.sin6_addr = config.prefix;
+    uint32_t host = htonl(index + 1);
+    memcpy(&mote->address.sin6_addr.s6_addr[12], &host, sizeof(host));
+
+    snprintf(mote->base_name, sizeof(mote->base_name), "urn:dev:mac:0200%08X:", index + 1);
+    mote->next_mid = random_number_next() & 0xFFFF;
+    mote->co = random_number_between(500, 1500) / 100.0;
+    mote->temperature = random_number_between(2000, 2800) / 100.0;
+    mote->humidity = random_number_between(4000, 6000) / 100.0;
+}
+
+
+static void print_header(void) {
+    printf("%6s %6s %8s %9s %9s %9s %9s %9s %9s %8s %8s %8s %8s\n",
+           "time", "rooms", "running", "reg_p50", "reg_p99", "disc_p50", "disc_p99",
+           "notif/s", "ack_p50", "ack_p99", "reg_err", "timeout", "reset");
+}
+
+static void print_stats(double elapsed_s, double window_s, stats_t *stats) {
+    int running = 0;
+    for (int i = 0; i < active_motes; i++) {
+        running += motes[i].state == STATE_RUNNING;
+    }
+    printf("%6.0f %6d %8d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %8.1f %8lu %8lu %8lu\n",
+           elapsed_s, active_motes / MOTE_KINDS, running,
+           percentile(&stats->registration, 50), percentile(&stats->registration, 99),
+           percentile(&stats->discovery, 50), percentile(&stats->discovery, 99),
+           window_s > 0 ? stats->notifications / window_s : 0,
+           percentile(&stats->notification_ack, 50), percentile(&stats->notification_ack, 99),
+           stats->registration_failures, stats->notification_timeouts, stats->resets);
+    fflush(stdout);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --server <addr>         address of the cloud application (default ::1)\n"
+            "  --prefix <prefix>       prefix of the addresses of the motes (default fd00:1::)\n"
+            "  --rooms <n>             rooms, 3 motes each (default 10)\n"
+            "  --first-room <id>       id of the first room (default 1)\n"
+            "  --step <n>              rooms started at every step (default: all)\n"
+            "  --step-interval <s>     seconds between two steps (default 30)\n"
+            "  --duration <s>          seconds of load after the last step (default 60)\n"
+            "  --interval <ms>         notification interval of the sensors (default 5000)\n"
+            "  --hvac-interval <ms>    interval between two switches of the HVAC (default 30000)\n"
+            "  --seed <n>              seed of the readings (default 1)\n",
+            name);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option options[] = {
+        { "server", required_argument, NULL, 's' },
+        { "prefix", required_argument, NULL, 'p' },
+        { "rooms", required_argument, NULL, 'r' },
+        { "first-room", required_argument, NULL, 'f' },
+        { "step", required_argument, NULL, 'S' },
+        { "step-interval", required_argument, NULL, 'I' },
+        { "duration", required_argument, NULL, 'd' },
+        { "interval", required_argument, NULL, 'i' },
+        { "hvac-interval", required_argument, NULL, 'h' },
+        { "seed", required_argument, NULL, 'x' },
+        { NULL, 0, NULL, 0 }
+    };
+    const char *server = "::1";
+    const char *prefix = "fd00:1::";
+    uint32_t seed = 1;
+    int option;
+
+    config.rooms = 10;
+    config.first_room = 1;
+    config.step = 0;
+    config.step_interval = 30;
+    config.duration = 60;
+    config.interval_ms = 5000;
+    config.hvac_interval_ms = 30000;
+
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+            case 's': server = optarg; break;
+            case 'p': prefix = optarg; break;
+            case 'r': config.rooms = atoi(optarg); break;
+            case 'f': config.first_room = atoi(optarg); break;
+            case 'S': config.step = atoi(optarg); break;
+            case 'I': config.step_interval = atoi(optarg); break;
+            case 'd': config.duration = atoi(optarg); break;
+            case 'i': config.interval_ms = atoi(optarg); break;
+            case 'h': config.hvac_interval_ms = atoi(optarg); break;
+            case 'x': seed = strtoul(optarg, NULL, 10); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (config.rooms < 1 || config.interval_ms < 1 || config.hvac_interval_ms < 1 || config.step_interval < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (config.step < 1 || config.step > config.rooms) {
+        config.step = config.rooms;
+    }
+
+    config.server.sin6_family = AF_INET6;
+    config.server.sin6_port = htons(COAP_PORT);
+    if (inet_pton(AF_INET6, server, &config.server.sin6_addr) != 1
+        || inet_pton(AF_INET6, prefix, &config.prefix) != 1) {
+        fprintf(stderr, "Invalid IPv6 address\n");
+        return 1;
+    }
+    random_number_seed(seed);
+
+    int epoll_fd = epoll_create1(0);
+    num_motes = config.rooms * MOTE_KINDS;
+    motes = calloc(num_motes, sizeof(mote_t));
+    if (epoll_fd < 0 || motes == NULL) {
+        perror("init");
+        return 1;
+    }
+    for (int i = 0; i < num_motes; i++) {
+        init_mote(&motes[i], i);
+        if (open_mote(&motes[i], epoll_fd) < 0) {
+            return 1;
+        }
+    }
+
+    int steps = (config.rooms + config.step - 1) / config.step;
+    double start = now_ms();
+    double end = start + ((double) (steps - 1) * config.step_interval + config.duration) * 1000.0;
+    double next_step = start;
+    double step_start = start;
+    int step = 0;
+    struct epoll_event events[64];
+
+    print_header();
+    while (now_ms() < end) {
+        double now = now_ms();
+
+        if (step < steps && now >= next_step) {
+            if (step > 0) {
+                print_stats((now - start) / 1000.0, (now - step_start) / 1000.0, &step_stats);
+                stats_reset(&step_stats);
+                step_start = now;
+            }
+            // The motes of the new rooms register within a second
+            int last = (step + 1) * config.step * MOTE_KINDS;
+            last = last > num_motes ? num_motes : last;
+            for (int i = active_motes; i < last; i++) {
+                motes[i].start_ms = now + jitter_ms(1000);
+            }
+            active_motes = last;
+            step++;
+            next_step = now + config.step_interval * 1000.0;
+        }
+
+        int count = epoll_wait(epoll_fd, events, sizeof(events) / sizeof(events[0]), 5);
+        for (int e = 0; e < count; e++) {
+            mote_t *mote = &motes[events[e].data.u32];
+            uint8_t datagram[BUFFER_SIZE];
+            struct sockaddr_in6 from;
+            socklen_t from_len = sizeof(from);
+            ssize_t length;
+
+            while ((length = recvfrom(mote->fd, datagram, sizeof(datagram), 0,
+                                      (struct sockaddr *) &from, &from_len)) > 0) {
+                if (mote->index < active_motes) {
+                    handle_datagram(mote, datagram, length, &from);
+                }
+                from_len = sizeof(from);
+            }
+        }
+
+        now = now_ms();
+        for (int i = 0; i < active_motes; i++) {
+            run_timers(&motes[i], now);
+        }
+    }
+
+    print_stats((now_ms() - start) / 1000.0, (now_ms() - step_start) / 1000.0, &step_stats);
+    printf("\nTotal: %d rooms, %.0f s\n", config.rooms, (now_ms() - start) / 1000.0);
+    print_header();
+    print_stats((now_ms() - start) / 1000.0, (now_ms() - start) / 1000.0, &total_stats);
+    printf("notifications=%lu discovery_errors=%lu send_errors=%lu\n",
+           total_stats.notifications, total_stats.discovery_failures, total_stats.send_errors);
+
+    for (int i = 0; i < num_motes; i++) {
+        close(motes[i].fd);
+    }
+    free(motes);
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""
+Runs the headless benchmark scenarios of the control loop and reports its
+latency and the radio duty cycle of the nodes.
+
+Every scenario is a simulation generated by generate_simulation.py with a
+number of motes and a radio loss. The nodes are built with make BENCH=1 and
+log every stage of the control loop:
+
+    sample    the sensor takes a new reading
+    sent      the sensor sends the notification
+    parse     the HVAC parses the notification
+    predict   the HVAC predicts its status
+    notify    the HVAC notifies its status
+    led       the VaultStatus switches the LEDs
+
+A script of the simulation writes the logs to <scenario>_events.csv with the
+simulated time. The inserts of the HVAC status in the database are logged by
+the cloud application started with -Dbench.log=<file> (--cloud-log) and are
+matched on the wall clock, so the simulations run in real time.
+
+For every scenario, the control loops are written to <scenario>_loops.csv and
+a summary row (p50/p99 latency of the loop and of every stage, duty cycle of
+the radio) is appended to benchmark.csv, labelled with --label to compare
+the releases.
+
+Usage:
+    python3 benchmark.py --contiki ../../../contiki-ng --label v1.2 \\
+        --tunslip "sudo tunslip6 -a 127.0.0.1 -p 60001 fd00::1/64" \\
+        --cloud-log /tmp/cloud-bench.log
+    python3 benchmark.py --analyze --label v1.2
+"""
+
+import argparse
+import bisect
+import csv
+import os
+import re
+import subprocess
+import time
+
+import generate_simulation
+
+SIMULATION = os.path.dirname(os.path.abspath(__file__))
+
+# Motes of a room besides the CO and TemperatureAndHumidity sensors
+# (Movement, VaultStatus and HVAC)
+ROOM_ACTUATORS = 3
+# Stages of the control loop in order
+STAGES = ("sample", "sent", "parse", "predict", "notify", "led")
+
+EVENT = re.compile(r"(\w+) room=(\d+)(.*)")
+FIELD = re.compile(r"(\w+)=(\S+)")
+
+
+def scenario_name(motes, loss):
+    return "m%d_l%d" % (motes, round(loss * 100))
+
+
+def run_scenario(args, motes, loss):
+    """Generates and runs the simulation of a scenario, returns the events file."""
+    rooms = max(1, round(motes / (ROOM_ACTUATORS + 2 * args.sensors_per_room)))
+    name = scenario_name(motes, loss)
+    events = os.path.abspath(os.path.join(args.output, "%s_events.csv" % name))
+    csc = os.path.join(SIMULATION, "bench_%s.csc" % name)
+
+    with open(csc, "w") as f:
+        f.write(generate_simulation.generate(rooms, args.sensors_per_room, False, args.seed,
+                                             bench=(events, args.duration), loss=loss))
+
+    cooja = os.path.join(args.contiki, "tools", "cooja")
+    command = [os.path.join(cooja, "gradlew"), "--no-watch-fs", "-p", cooja, "run",
+               "--args=--contiki=%s --no-gui --logdir=%s %s"
+               % (os.path.abspath(args.contiki), os.path.abspath(args.output), csc)]
+    print("%s: %d rooms, %.0f%% loss" % (name, rooms, loss * 100))
+    simulation = subprocess.Popen(command, stdout=subprocess.DEVNULL)
+
+    tunslip = None
+    if args.tunslip:
+        # The serial socket of the border router is open once the motes are built
+        time.sleep(args.tunslip_delay)
+        tunslip = subprocess.Popen(args.tunslip, shell=True, stdout=subprocess.DEVNULL)
+    try:
+        simulation.wait()
+    finally:
+        if tunslip is not None:
+            tunslip.terminate()
+    os.remove(csc)
+    return events
+
+
+def read_events(path):
+    """Returns {room: {stage: [(time_us, wall_ms)]}} and [energest fields] of a scenario."""
+    stages = {}
+    energest = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            match = EVENT.match(row["event"])
+            if match is None:
+                continue
+            stage, room, rest = match.group(1), int(match.group(2)), match.group(3)
+            if stage == "energest":
+                fields = dict(FIELD.findall(rest))
+                fields["mote"] = row["mote"]
+                energest.append(fields)
+            else:
+                stages.setdefault(room, {s: [] for s in STAGES})[stage].append(
+                    (int(row["time_us"]), int(row["wall_ms"])))
+    return stages, energest
+
+
+def read_inserts(path):
+    """Returns {room: [wall_ms]} of the HVAC status inserted by the cloud application."""
+    inserts = {}
+    if path is None or not os.path.exists(path):
+        return inserts
+    with open(path) as f:
+        for line in f:
+            wall, stage, resource, room = line.strip().split(",")
+            if stage == "insert" and resource == "hvac":
+                inserts.setdefault(int(room), []).append(int(wall))
+    for walls in inserts.values():
+        walls.sort()
+    return inserts
+
+
+def last_before(events, t):
+    """Last event at or before t, None if there is none."""
+    index = bisect.bisect_right(events, (t, float("inf"))) - 1
+    return events[index] if index >= 0 else None
+
+
+def first_after(events, t):
+    """First event at or after t, None if there is none."""
+    index = bisect.bisect_left(events, (t, -1))
+    return events[index] if index < len(events) else None
+
+
+def control_loops(stages, inserts):
+    """Rebuilds the control loops of every room from the logged stages.
+
+    Every prediction ends a loop: the parses since the previous prediction
+    are the readings it aggregates. The stages follow the reading that
+    triggered the prediction (the last one), the wait is the time since the
+    first reading of the loop."""
+    loops = []
+    for room, events in sorted(stages.items()):
+        previous = -1
+        for predict in events["predict"]:
+            parses = [p for p in events["parse"] if previous < p[0] <= predict[0]]
+            previous = predict[0]
+            if not parses:
+                continue
+
+            loop = {"room": room}
+            # The notification is sent while the reading is taken
+            sample = last_before(events["sample"], parses[-1][0])
+            sent = first_after(events["sent"], sample[0]) if sample else None
+            first_sample = last_before(events["sample"], parses[0][0])
+            notify = first_after(events["notify"], predict[0])
+            led = first_after(events["led"], notify[0]) if notify else None
+
+            for stage, event in zip(STAGES, (sample, sent, parses[-1], predict, notify, led)):
+                loop[stage] = event
+            loop["first_sample"] = first_sample
+
+            loop["insert_ms"] = None
+            if notify and room in inserts:
+                walls = inserts[room]
+                index = bisect.bisect_left(walls, notify[1])
+                if index < len(walls):
+                    loop["insert_ms"] = walls[index] - notify[1]
+            loops.append(loop)
+    return loops
+
+
+def duration_ms(start, end):
+    if start is None or end is None:
+        return None
+    return (end[0] - start[0]) / 1000.0
+
+
+def percentile(values, p):
+    """Nearest-rank percentile, None without values."""
+    values = sorted(v for v in values if v is not None)
+    if not values:
+        return None
+    return values[max(0, -(-len(values) * p // 100) - 1)]
+
+
+def write_loops(path, loops):
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["room"] + ["%s_us" % s for s in STAGES] + ["wait_ms", "loop_ms", "insert_ms"])
+        for loop in loops:
+            writer.writerow([loop["room"]]
+                            + [loop[s][0] if loop[s] else "" for s in STAGES]
+                            + [duration_ms(loop["first_sample"], loop["sample"]),
+                               duration_ms(loop["sample"], loop["led"]),
+                               loop["insert_ms"]])
+
+
+def summary(label, name, motes, loss, loops, energest):
+    row = {
+        "label": label,
+        "scenario": name,
+        "motes": motes,
+        "loss": loss,
+        "rooms": len(set(loop["room"] for loop in loops)),
+        "loops": len(loops),
+    }
+    total = [duration_ms(loop["sample"], loop["led"]) for loop in loops]
+    row["p50_ms"] = percentile(total, 50)
+    row["p99_ms"] = percentile(total, 99)
+    row["wait_p50_ms"] = percentile([duration_ms(loop["first_sample"], loop["sample"]) for loop in loops], 50)
+    for start, end in zip(STAGES, STAGES[1:]):
+        row["%s_p50_ms" % end] = percentile([duration_ms(loop[start], loop[end]) for loop in loops], 50)
+    row["insert_p50_ms"] = percentile([loop["insert_ms"] for loop in loops], 50)
+    row["insert_p99_ms"] = percentile([loop["insert_ms"] for loop in loops], 99)
+
+    # Last report of every mote, cumulated since the boot (in thousandths)
+    last = {}
+    for fields in energest:
+        last[fields["mote"]] = fields
+    radio = [(int(f["listen"]) + int(f["transmit"])) / 10.0 for f in last.values()]
+    transmit = [int(f["transmit"]) / 10.0 for f in last.values()]
+    row["radio_duty_pct"] = round(sum(radio) / len(radio), 2) if radio else None
+    row["tx_duty_pct"] = round(sum(transmit) / len(transmit), 2) if transmit else None
+    return row
+
+
+def append_summary(path, row):
+    exists = os.path.exists(path)
+    with open(path, "a", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(row))
+        if not exists:
+            writer.writeheader()
+        writer.writerow(row)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Runs the headless benchmark scenarios of the control loop.")
+    parser.add_argument("--contiki", default=os.path.join(SIMULATION, "..", "..", "..", "contiki-ng"),
+                        help="Contiki-NG directory (default: ../../../contiki-ng)")
+    parser.add_argument("--motes", type=int, nargs="+", default=[5, 20, 50, 100],
+                        help="motes of the scenarios besides the border router (default: 5 20 50 100)")
+    parser.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.1, 0.3],
+                        help="radio loss of the scenarios (default: 0.0 0.1 0.3)")
+    parser.add_argument("--sensors-per-room", type=int, default=1,
+                        help="CO and TemperatureAndHumidity sensors per room (default: 1)")
+    parser.add_argument("--duration", type=int, default=600,
+                        help="simulated seconds of every scenario (default: 600)")
+    parser.add_argument("--seed", type=int, default=123456, help="random seed of the simulations")
+    parser.add_argument("--tunslip", default=None,
+                        help="command connecting the border router to the cloud application")
+    parser.add_argument("--tunslip-delay", type=int, default=60,
+                        help="seconds between the start of a simulation and of --tunslip (default: 60)")
+    parser.add_argument("--cloud-log", default=None,
+                        help="log of the cloud application started with -Dbench.log=<file>")
+    parser.add_argument("--label", default="dev", help="label of the results, e.g. the release")
+    parser.add_argument("--output", default=os.path.join(SIMULATION, "bench"),
+                        help="directory of the results (default: Simulation/bench)")
+    parser.add_argument("--analyze", action="store_true",
+                        help="only analyze the events of the previous runs")
+    args = parser.parse_args()
+
+    if any(not 0.0 <= loss < 1.0 for loss in args.loss):
+        parser.error("--loss must be between 0.0 and 1.0")
+    os.makedirs(args.output, exist_ok=True)
+
+    for motes in args.motes:
+        for loss in args.loss:
+            name = scenario_name(motes, loss)
+            if args.analyze:
+                events = os.path.join(args.output, "%s_events.csv" % name)
+                if not os.path.exists(events):
+                    continue
+            else:
+                events = run_scenario(args, motes, loss)
+
+            stages, energest = read_events(events)
+            loops = control_loops(stages, read_inserts(args.cloud_log))
+            write_loops(os.path.join(args.output, "%s_loops.csv" % name), loops)
+            row = summary(args.label, name, motes, loss, loops, energest)
+            append_summary(os.path.join(args.output, "benchmark.csv"), row)
+            print("%-12s %5d loops  p50 %s ms  p99 %s ms  radio %s%%"
+                  % (name, row["loops"], row["p50_ms"], row["p99_ms"], row["radio_duty_pct"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""
+Generates a Cooja simulation with several VoltVault rooms.
+
+Every room contains a Movement sensor, a VaultStatus, an HVAC and a
+configurable number of CO and TemperatureAndHumidity sensors. All the
+nodes of a room are built from the same sources with make ROOM=<id>,
+so that they register and discover resources in their own room.
+
+Usage:
+    python3 generate_simulation.py --rooms 10 --sensors-per-room 2 \
+        --output simulation_10_rooms.csc
+"""
+
+import argparse
+import math
+from xml.sax.saxutils import escape
+
+# Distance between the centers of two neighbouring rooms (the UDGM
+# transmitting range is 50, so neighbouring rooms can relay traffic)
+ROOM_SPACING = 40.0
+# Radius of the circle where the nodes of a room are placed
+ROOM_RADIUS = 12.0
+
+MOTE_INTERFACES = [
+    "org.contikios.cooja.interfaces.Position",
+    "org.contikios.cooja.interfaces.Battery",
+    "org.contikios.cooja.contikimote.interfaces.ContikiVib",
+    "org.contikios.cooja.contikimote.interfaces.ContikiMoteID",
+    "org.contikios.cooja.contikimote.interfaces.ContikiRS232",
+    "org.contikios.cooja.contikimote.interfaces.ContikiBeeper",
+    "org.contikios.cooja.interfaces.IPAddress",
+    "org.contikios.cooja.contikimote.interfaces.ContikiRadio",
+    "org.contikios.cooja.contikimote.interfaces.ContikiButton",
+    "org.contikios.cooja.contikimote.interfaces.ContikiPIR",
+    "org.contikios.cooja.contikimote.interfaces.ContikiClock",
+    "org.contikios.cooja.contikimote.interfaces.ContikiLED",
+    "org.contikios.cooja.contikimote.interfaces.ContikiCFS",
+    "org.contikios.cooja.contikimote.interfaces.ContikiEEPROM",
+    "org.contikios.cooja.interfaces.Mote2MoteRelations",
+    "org.contikios.cooja.interfaces.MoteAttributes",
+]
+
+# (description, source relative to the Simulation directory, firmware name)
+ROOM_NODES = {
+    "movement": ("Movement Sensor", "../Sensors/Movement/movement.c", "movement"),
+    "vaultstatus": ("VaultStatus Actuator", "../Actuators/VaultStatus/vaultstatus.c", "vaultstatus"),
+    "hvac": ("HVAC Actuator", "../Actuators/HVAC/hvac.c", "hvac"),
+    "co": ("co-sensor", "../Sensors/CO/co.c", "co"),
+    "temperatureandhumidity": ("TemperatureAndHumidity Sensor",
+                               "../Sensors/TemperatureAndHumidity/temperatureandhumidity.c",
+                               "temperatureandhumidity"),
+}
+
+
+def mote_type(description, source, commands, motes):
+    """Returns the XML of a mote type with the given motes as (id, x, y)."""
+    lines = [
+        "    <motetype>",
+        "      org.contikios.cooja.contikimote.ContikiMoteType",
+        "      <description>%s</description>" % escape(description),
+        "      <source>[CONFIG_DIR]/%s</source>" % source,
+        "      <commands>%s</commands>" % escape(commands),
+    ]
+    lines += ["      <moteinterface>%s</moteinterface>" % i for i in MOTE_INTERFACES]
+    for mote_id, x, y in motes:
+        lines += [
+            "      <mote>",
+            "        <interface_config>",
+            "          org.contikios.cooja.interfaces.Position",
+            '          <pos x="%.2f" y="%.2f" />' % (x, y),
+            "        </interface_config>",
+            "        <interface_config>",
+            "          org.contikios.cooja.contikimote.interfaces.ContikiMoteID",
+            "          <id>%d</id>" % mote_id,
+            "        </interface_config>",
+            "      </mote>",
+        ]
+    lines.append("    </motetype>")
+    return "\n".join(lines)
+
+
+def room_center(room, grid_size):
+    """Rooms are placed on a square grid, the border router is at the origin."""
+    row, column = divmod(room, grid_size)
+    return (column + 1) * ROOM_SPACING, row * ROOM_SPACING
+
+
+def generate(rooms, sensors_per_room, multicast, seed, watermark=False, profile=False, trace=None, speedup=1,
+             bench=None, loss=0.0):
+    """Returns the XML of the simulation. With bench=(events, duration in
+    seconds), the nodes are built with BENCH=1 and a headless script writes
+    their [Bench] logs to the events CSV file until the end of the run."""
+    grid_size = max(1, math.ceil(math.sqrt(rooms)))
+    make_options = " MULTICAST=1" if multicast else ""
+    # Options of the nodes only, the border router does not support them
+    node_options = make_options
+    node_options += " WATERMARK=1" if watermark else ""
+    node_options += " PROFILE=1" if profile else ""
+    node_options += {"flash": " TRACE=1", "cfs": " TRACE=cfs"}.get(trace, "")
+    node_options += " SPEEDUP=%d" % speedup if trace and speedup > 1 else ""
+    node_options += " BENCH=1" if bench else ""
+    # The sensors replay the same readings with the same simulation seed
+    node_options += " SEED=%d" % seed
+    mote_types = []
+
+    # The border router must be the first mote (serial socket on mote 0)
+    mote_types.append(mote_type(
+        "Border Router", "../BorderRouter/border-router.c",
+        "$(MAKE) -j$(CPUS) border-router.cooja TARGET=cooja" + make_options,
+        [(1, 0.0, 0.0)]))
+
+    next_id = 2
+    for room in range(1, rooms + 1):
+        center_x, center_y = room_center(room - 1, grid_size)
+        roles = ["movement", "vaultstatus", "hvac"]
+        roles += ["co"] * sensors_per_room
+        roles += ["temperatureandhumidity"] * sensors_per_room
+
+        motes = {}
+        for index, role in enumerate(roles):
+            angle = 2 * math.pi * index / len(roles)
+            x = center_x + ROOM_RADIUS * math.cos(angle)
+            y = center_y + ROOM_RADIUS * math.sin(angle)
+            motes.setdefault(role, []).append((next_id, x, y))
+            next_id += 1
+
+        for role, role_motes in motes.items():
+            description, source, firmware = ROOM_NODES[role]
+            # ROOM is a compile-time option: the previous objects are removed
+            # so that every mote type is built with its own room
+            commands = ("$(MAKE) TARGET=cooja clean && "
+                        "$(MAKE) -j$(CPUS) %s.cooja TARGET=cooja ROOM=%d%s"
+                        % (firmware, room, node_options))
+            mote_types.append(mote_type("%s (room %d)" % (description, room),
+                                        source, commands, role_motes))
+
+    if bench:
+        events, duration = bench
+        script = BENCH_SCRIPT % {
+            "events": events,
+            "duration": duration * 1000000,
+            # Cooja times out in simulated milliseconds
+            "timeout": (duration + 120) * 1000,
+        }
+        plugins = BENCH_PLUGIN % escape(script)
+    else:
+        plugins = GUI_PLUGINS
+
+    return TEMPLATE % {
+        "title": "IoT-project %d rooms" % rooms,
+        "seed": seed,
+        "success_ratio": round(1.0 - loss, 3),
+        "motetypes": "\n".join(mote_types),
+        "plugins": plugins,
+    }
+
+
+TEMPLATE = """<?xml version="1.0" encoding="UTF-8"?>
+<simconf version="2023090101">
+  <simulation>
+    <title>%(title)s</title>
+    <speedlimit>1.0</speedlimit>
+    <randomseed>%(seed)d</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      org.contikios.cooja.radiomediums.UDGM
+      <transmitting_range>50.0</transmitting_range>
+      <interference_range>100.0</interference_range>
+      <success_ratio_tx>%(success_ratio)s</success_ratio_tx>
+      <success_ratio_rx>%(success_ratio)s</success_ratio_rx>
+    </radiomedium>
+    <events>
+      <logoutput>40000</logoutput>
+    </events>
+%(motetypes)s
+  </simulation>
+%(plugins)s
+  <plugin>
+    org.contikios.cooja.serialsocket.SerialSocketServer
+    <mote_arg>0</mote_arg>
+    <plugin_config>
+      <port>60001</port>
+      <bound>true</bound>
+    </plugin_config>
+    <bounds x="37" y="701" height="116" width="362" z="1" />
+  </plugin>
+</simconf>
+"""
+
+# Plugins of the interactive simulations
+GUI_PLUGINS = """  <plugin>
+    org.contikios.cooja.plugins.Visualizer
+    <plugin_config>
+      <moterelations>true</moterelations>
+      <skin>org.contikios.cooja.plugins.skins.IDVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.GridVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.TrafficVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.UDGMVisualizerSkin</skin>
+    </plugin_config>
+    <bounds x="1" y="0" height="400" width="400" z="3" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.LogListener
+    <plugin_config>
+      <filter />
+      <formatted_time />
+      <coloring />
+    </plugin_config>
+    <bounds x="400" y="0" height="814" width="1450" z="2" />
+  </plugin>"""
+
+# Script of the headless benchmark scenarios: the [Bench] logs of the nodes
+# (make BENCH=1) are written to a CSV file with the simulated time and the
+# wall clock, used to match the inserts logged by the cloud application
+BENCH_SCRIPT = """var FileWriter = Java.type("java.io.FileWriter");
+var System = Java.type("java.lang.System");
+var events = new FileWriter("%(events)s");
+events.write("time_us,wall_ms,mote,event\\n");
+TIMEOUT(%(timeout)d);
+while(time < %(duration)d) {
+  YIELD();
+  if(msg.indexOf("[Bench] ") >= 0) {
+    events.write(time + "," + System.currentTimeMillis() + "," + id + ",\\"" +
+                 msg.substring(msg.indexOf("[Bench] ") + 8) + "\\"\\n");
+  }
+}
+events.close();
+log.testOK();
+"""
+
+BENCH_PLUGIN = """  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>%s</script>
+      <active>true</active>
+    </plugin_config>
+  </plugin>"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates a multi-room VoltVault Cooja simulation.")
+    parser.add_argument("--rooms", type=int, default=10, help="number of rooms (default: 10)")
+    parser.add_argument("--sensors-per-room", type=int, default=1,
+                        help="number of CO and of TemperatureAndHumidity sensors per room (default: 1, max: 4)")
+    parser.add_argument("--multicast", action="store_true",
+                        help="build the nodes with MULTICAST=1")
+    parser.add_argument("--watermark", action="store_true",
+                        help="build the nodes with WATERMARK=1 to log the input of ram_profiles.py")
+    parser.add_argument("--profile", action="store_true",
+                        help="build the nodes with PROFILE=1 (RAM profiles generated by ram_profiles.py)")
+    parser.add_argument("--trace", choices=["flash", "cfs"], default=None,
+                        help="replay the trace generated by telemetry_trace.py from the flash (TRACE=1) "
+                             "or from the CFS of the sensors (TRACE=cfs)")
+    parser.add_argument("--speedup", type=int, default=1,
+                        help="time compression of the replayed trace (default: 1)")
+    parser.add_argument("--loss", type=float, default=0.0,
+                        help="share of the packets lost by the radio medium (default: 0.0)")
+    parser.add_argument("--seed", type=int, default=123456, help="random seed of the simulation")
+    parser.add_argument("--output", default=None, help="output file (default: simulation_<rooms>_rooms.csc)")
+    args = parser.parse_args()
+
+    if args.rooms < 1:
+        parser.error("--rooms must be at least 1")
+    if not 1 <= args.sensors_per_room <= 4:
+        parser.error("--sensors-per-room must be between 1 and 4 (MAX_ROOM_SENSORS of the HVAC)")
+    if args.speedup < 1:
+        parser.error("--speedup must be at least 1")
+    if not 0.0 <= args.loss < 1.0:
+        parser.error("--loss must be between 0.0 and 1.0")
+
+    output = args.output or "simulation_%d_rooms.csc" % args.rooms
+    with open(output, "w") as f:
+        f.write(generate(args.rooms, args.sensors_per_room, args.multicast, args.seed,
+                         args.watermark, args.profile, args.trace, args.speedup, loss=args.loss))
+    print("Simulation with %d rooms written to %s" % (args.rooms, output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+Generates the RAM profiles of the nodes from the high-water marks measured
+in a simulation.
+
+The nodes built with make WATERMARK=1 periodically log the largest SenML
+payload they built and the peak number of open CoAP transactions, CoAP
+observers, neighbors and routes:
+
+    [Watermark] node=co payload=152 transactions=2 observers=1 neighbors=4 routes=0
+
+This script reads one or more logs of a simulation (e.g. COOJA.testlog or
+the output of the LogListener), keeps the peak of every firmware and writes
+Utility/RamProfiles/<firmware>.h, used by project-conf.h when the node is
+built with make PROFILE=1.
+
+Usage:
+    python3 ram_profiles.py COOJA.testlog --margin 50
+"""
+
+import argparse
+import math
+import os
+import re
+
+WATERMARK = re.compile(r"\[Watermark\] node=(\w+) payload=(\d+) transactions=(\d+) "
+                       r"observers=(\d+) neighbors=(\d+) routes=(\d+)")
+FIELDS = ("payload", "transactions", "observers", "neighbors", "routes")
+
+DEFAULT_OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Utility", "RamProfiles")
+
+# Bytes of a packet besides the CoAP payload: IPv6 (40) and UDP (8) headers
+# and the largest CoAP header (COAP_MAX_HEADER_SIZE, 70)
+PACKET_OVERHEAD = 40 + 8 + 70
+# Smallest and largest CoAP block sizes
+MIN_CHUNK_SIZE = 16
+MAX_CHUNK_SIZE = 1024
+# Smallest values kept for the tables, a node must be able to reach its
+# parent and answer a request while another one is open
+MIN_NEIGHBORS = 2
+MIN_ROUTES = 0
+MIN_TRANSACTIONS = 2
+MIN_OBSERVERS = 1
+
+
+def read_peaks(logs):
+    """Returns the peak of every field for every firmware found in the logs."""
+    peaks = {}
+    for log in logs:
+        with open(log, errors="replace") as f:
+            for line in f:
+                match = WATERMARK.search(line)
+                if match is None:
+                    continue
+                node = peaks.setdefault(match.group(1), dict.fromkeys(FIELDS, 0))
+                for field, value in zip(FIELDS, match.groups()[1:]):
+                    node[field] = max(node[field], int(value))
+    return peaks
+
+
+def with_margin(value, margin, minimum):
+    return max(minimum, math.ceil(value * (100 + margin) / 100))
+
+
+def chunk_size(payload):
+    """Smallest CoAP block size holding the payload (block sizes are powers of 2)."""
+    size = MIN_CHUNK_SIZE
+    while size < payload and size < MAX_CHUNK_SIZE:
+        size *= 2
+    return size
+
+
+def profile(node, peak, max_payload, margin, logs):
+    # The nodes also receive the payloads built by the other ones (e.g. the
+    # HVAC parses the notifications of the sensors), so the buffers are sized
+    # on the largest payload of the whole network. The rounding to the next
+    # block size already leaves room for longer values, no margin is added
+    chunk = chunk_size(max_payload)
+    buffer_size = chunk + PACKET_OVERHEAD
+    values = [
+        ("REST_MAX_CHUNK_SIZE", chunk),
+        ("COAP_MAX_CHUNK_SIZE", chunk),
+        ("UIP_CONF_BUFFER_SIZE", buffer_size),
+        ("COAP_MAX_OPEN_TRANSACTIONS", with_margin(peak["transactions"], margin, MIN_TRANSACTIONS)),
+        ("COAP_MAX_OBSERVERS", with_margin(peak["observers"], margin, MIN_OBSERVERS)),
+        ("NBR_TABLE_CONF_MAX_NEIGHBORS", with_margin(peak["neighbors"], margin, MIN_NEIGHBORS)),
+        ("UIP_CONF_MAX_ROUTES", with_margin(peak["routes"], margin, MIN_ROUTES)),
+    ]
+
+    lines = [
+        "// RAM profile of the %s node, generated by Simulation/ram_profiles.py" % node,
+        "// from %s" % ", ".join(os.path.basename(log) for log in logs),
+        "//",
+        "// Measured peaks: payload %d bytes (network %d), %d transactions, %d observers,"
+        % (peak["payload"], max_payload, peak["transactions"], peak["observers"]),
+        "// %d neighbors, %d routes; margin %d%%" % (peak["neighbors"], peak["routes"], margin),
+        "",
+    ]
+    for name, value in values:
+        lines += ["#undef %s" % name, "#define %s %d" % (name, value), ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates the RAM profiles of the nodes from a simulation log.")
+    parser.add_argument("logs", nargs="+", help="simulation logs of nodes built with make WATERMARK=1")
+    parser.add_argument("--margin", type=int, default=50,
+                        help="margin in percent added to the measured peaks (default: 50)")
+    parser.add_argument("--output", default=DEFAULT_OUTPUT,
+                        help="directory of the profiles (default: Utility/RamProfiles)")
+    args = parser.parse_args()
+
+    if args.margin < 0:
+        parser.error("--margin must not be negative")
+
+    peaks = read_peaks(args.logs)
+    if not peaks:
+        parser.error("no [Watermark] line found, build the nodes with make WATERMARK=1")
+    max_payload = max(peak["payload"] for peak in peaks.values())
+
+    os.makedirs(args.output, exist_ok=True)
+    for node, peak in sorted(peaks.items()):
+        output = os.path.join(args.output, "%s.h" % node)
+        with open(output, "w") as f:
+            f.write(profile(node, peak, max_payload, args.margin, args.logs))
+        print("%-24s %s" % (node, os.path.normpath(output)))
+
+
+if __name__ == "__main__":
+    main()
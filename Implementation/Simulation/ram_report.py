@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""
+Reports the flash and RAM used by every firmware with the default
+configuration and with its RAM profile (make PROFILE=1).
+
+Every firmware is built twice with the given target and measured with
+size (Berkeley format): flash is text + data, RAM is data + bss.
+
+With --map, the static RAM (.data and .bss) of every application object
+(the sources of the firmware and of Utility/) is listed as well, e.g. to
+compare the RAM map of two revisions.
+
+Usage:
+    python3 ram_report.py --target nrf52840 --board dongle --size arm-none-eabi-size
+    python3 ram_report.py --target cooja --map
+"""
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+
+IMPLEMENTATION = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+# (directory relative to Implementation, firmware name)
+FIRMWARES = [
+    ("Sensors/CO", "co"),
+    ("Sensors/TemperatureAndHumidity", "temperatureandhumidity"),
+    ("Sensors/Movement", "movement"),
+    ("Actuators/HVAC", "hvac"),
+    ("Actuators/VaultStatus", "vaultstatus"),
+]
+
+
+def build(directory, firmware, target, board, profile):
+    """Builds the firmware and returns the path of the binary."""
+    options = ["TARGET=%s" % target]
+    if board:
+        options.append("BOARD=%s" % board)
+    subprocess.run(["make", "-C", directory, "clean"] + options,
+                   check=True, stdout=subprocess.DEVNULL)
+    if profile:
+        options.append("PROFILE=1")
+    subprocess.run(["make", "-C", directory, "-j%d" % (os.cpu_count() or 1), firmware] + options,
+                   check=True, stdout=subprocess.DEVNULL)
+
+    build_dir = os.path.join(directory, "build", target)
+    if board:
+        build_dir = os.path.join(build_dir, board)
+    return os.path.join(build_dir, "%s.%s" % (firmware, target))
+
+
+def application_objects(directory, binary):
+    """Returns the objects built from the sources of the firmware and of Utility/."""
+    sources = glob.glob(os.path.join(directory, "**", "*.c"), recursive=True)
+    sources += glob.glob(os.path.join(IMPLEMENTATION, "Utility", "**", "*.c"), recursive=True)
+    names = set(os.path.splitext(os.path.basename(source))[0] for source in sources)
+    objects = glob.glob(os.path.join(os.path.dirname(binary), "obj", "*.o"))
+    return sorted(o for o in objects if os.path.splitext(os.path.basename(o))[0] in names)
+
+
+def measure_ram_map(size, objects):
+    """Returns [(object, data, bss)] from the output of size."""
+    ram_map = []
+    for obj in objects:
+        output = subprocess.run([size, obj], check=True, capture_output=True, text=True).stdout
+        _, data, bss = (int(value) for value in output.splitlines()[1].split()[:3])
+        ram_map.append((os.path.basename(obj), data, bss))
+    return ram_map
+
+
+def measure(size, binary):
+    """Returns (flash, ram) in bytes from the output of size."""
+    output = subprocess.run([size, binary], check=True, capture_output=True, text=True).stdout
+    text, data, bss = (int(value) for value in output.splitlines()[1].split()[:3])
+    return text + data, data + bss
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reports the memory saved by the RAM profiles of the nodes.")
+    parser.add_argument("--target", default="cooja", help="Contiki-NG target (default: cooja)")
+    parser.add_argument("--board", default=None, help="board of the target (e.g. dongle)")
+    parser.add_argument("--size", default="size", help="size tool of the toolchain (default: size)")
+    parser.add_argument("--map", action="store_true",
+                        help="also list the static RAM of the application objects")
+    args = parser.parse_args()
+
+    rows = []
+    ram_maps = []
+    for directory, firmware in FIRMWARES:
+        path = os.path.join(IMPLEMENTATION, directory)
+        binary = build(path, firmware, args.target, args.board, False)
+        default = measure(args.size, binary)
+        if args.map:
+            ram_maps.append((firmware, measure_ram_map(args.size, application_objects(path, binary))))
+        if os.path.exists(os.path.join(IMPLEMENTATION, "Utility", "RamProfiles", "%s.h" % firmware)):
+            profiled = measure(args.size, build(path, firmware, args.target, args.board, True))
+        else:
+            print("%s: no RAM profile" % firmware, file=sys.stderr)
+            profiled = default
+        rows.append((firmware, default, profiled))
+
+    print("%-24s %10s %10s %8s %10s %10s %8s" % ("firmware", "flash", "profile", "saved",
+                                                "RAM", "profile", "saved"))
+    for firmware, (flash, ram), (profile_flash, profile_ram) in rows:
+        print("%-24s %10d %10d %8d %10d %10d %8d" % (firmware, flash, profile_flash, flash - profile_flash,
+                                                    ram, profile_ram, ram - profile_ram))
+
+    for firmware, ram_map in ram_maps:
+        print()
+        print("%-24s %-32s %8s %8s" % (firmware, "object", "data", "bss"))
+        for obj, data, bss in ram_map:
+            print("%-24s %-32s %8d %8d" % ("", obj, data, bss))
+        print("%-24s %-32s %8d %8d" % ("", "total", sum(m[1] for m in ram_map), sum(m[2] for m in ram_map)))
+
+
+if __name__ == "__main__":
+    main()
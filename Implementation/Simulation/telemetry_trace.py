@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Generates the trace replayed by the CO and TemperatureAndHumidity sensors
+built with make TRACE=1 or TRACE=cfs, from the recorded telemetry of the
+dataset (MachineLearning/iot_telemetry_data.csv).
+
+The readings of one device are packed as delta-encoded fixed-point values
+(see Utility/SensorModel/sensor-trace.c for the format) and written to:
+
+    Utility/SensorModel/sensor-trace.bin       uploaded on the CFS of the node (TRACE=cfs)
+    Utility/SensorModel/sensor-trace-data.h    built in the flash of the firmware (TRACE=1)
+
+Every sample keeps the recorded time until the next one, so the sensors
+replay the trace at its own pace, compressed with make SPEEDUP=<n>.
+
+Usage:
+    python3 telemetry_trace.py --device b8:27:eb:bf:9d:51 --samples 512
+"""
+
+import argparse
+import csv
+import os
+import struct
+
+DEFAULT_DATASET = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               "..", "..", "MachineLearning", "iot_telemetry_data.csv")
+DEFAULT_OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "Utility", "SensorModel")
+
+MAGIC = b"VVT1"
+# Fixed-point scale of the sensor model (5 decimals, as in SenML)
+SCALE = 100000
+# (column of the dataset, resolution of the trace in units of 1 / SCALE)
+QUANTITIES = [
+    ("temp", 1000),         # 0.01 Cel
+    ("humidity", 1000),     # 0.01 %RH
+    ("co", 1),              # 0.00001 ppm
+]
+# Size of the file system of a Cooja mote (CFS_FILE_SIZE of cfs-cooja.c)
+COOJA_CFS_SIZE = 4000
+
+
+def varint(value):
+    """Unsigned LEB128 encoding."""
+    encoded = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            encoded.append(byte | 0x80)
+        else:
+            encoded.append(byte)
+            return bytes(encoded)
+
+
+def zigzag(value):
+    return value << 1 if value >= 0 else ((-value) << 1) - 1
+
+
+def read_samples(dataset, device, samples):
+    """Returns the readings of the device (the first one if not given), sorted by time."""
+    rows = []
+    with open(dataset, newline="") as f:
+        for row in csv.DictReader(f):
+            if device is None:
+                device = row["device"]
+            if row["device"] == device:
+                rows.append(row)
+    if not rows:
+        raise SystemExit("no reading of device %s in %s" % (device, dataset))
+    rows.sort(key=lambda row: float(row["ts"]))
+    return device, rows[:samples]
+
+
+def encode(rows, max_gap):
+    """Packs the readings in the binary trace."""
+    times = [float(row["ts"]) for row in rows]
+    # Milliseconds until the next sample, the last one repeats the previous
+    # interval; the gaps of the recording are shortened to max_gap seconds
+    intervals = [min(round((b - a) * 1000), max_gap * 1000) for a, b in zip(times, times[1:])]
+    intervals.append(intervals[-1] if intervals else 1000)
+
+    trace = bytearray(MAGIC)
+    trace += struct.pack("<H", len(rows))
+    trace += struct.pack("<%dH" % len(QUANTITIES), *(quantum for _, quantum in QUANTITIES))
+
+    previous = [0] * len(QUANTITIES)
+    for row, interval in zip(rows, intervals):
+        trace += varint(interval)
+        for i, (column, quantum) in enumerate(QUANTITIES):
+            value = int(round(float(row[column]) * SCALE / quantum))
+            trace += varint(zigzag(value - previous[i]))
+            previous[i] = value
+    return bytes(trace)
+
+
+def header(trace, device, samples, dataset):
+    lines = [
+        "// Trace of the sensor model, generated by Simulation/telemetry_trace.py",
+        "// from %s (device %s, %d samples, %d bytes)" % (os.path.basename(dataset), device, samples, len(trace)),
+        "",
+        "#ifndef SENSOR_TRACE_DATA_H",
+        "#define SENSOR_TRACE_DATA_H",
+        "",
+        "static const uint8_t sensor_trace_data[%d] = {" % len(trace),
+    ]
+    for i in range(0, len(trace), 12):
+        lines.append("    " + " ".join("0x%02x," % byte for byte in trace[i:i + 12]))
+    lines += ["};", "", "#endif  // SENSOR_TRACE_DATA_H", ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates the trace replayed by the sensors built with make TRACE=1.")
+    parser.add_argument("--dataset", default=DEFAULT_DATASET,
+                        help="telemetry dataset (default: MachineLearning/iot_telemetry_data.csv)")
+    parser.add_argument("--device", default=None, help="device of the dataset (default: the first one)")
+    parser.add_argument("--samples", type=int, default=512, help="samples of the trace (default: 512)")
+    parser.add_argument("--max-gap", type=int, default=60,
+                        help="longest interval between two samples in seconds (default: 60)")
+    parser.add_argument("--output", default=DEFAULT_OUTPUT,
+                        help="output directory (default: Utility/SensorModel)")
+    args = parser.parse_args()
+
+    if not 1 <= args.samples <= 65535:
+        parser.error("--samples must be between 1 and 65535")
+    if args.max_gap < 1:
+        parser.error("--max-gap must be at least 1")
+
+    device, rows = read_samples(args.dataset, args.device, args.samples)
+    trace = encode(rows, args.max_gap)
+
+    with open(os.path.join(args.output, "sensor-trace.bin"), "wb") as f:
+        f.write(trace)
+    with open(os.path.join(args.output, "sensor-trace-data.h"), "w") as f:
+        f.write(header(trace, device, len(rows), args.dataset))
+    print("Trace of %d samples of device %s: %d bytes (%.1f per sample)"
+          % (len(rows), device, len(trace), len(trace) / len(rows)))
+    if len(trace) > COOJA_CFS_SIZE:
+        print("Warning: larger than the CFS of a Cooja mote (%d bytes), reduce --samples for TRACE=cfs"
+              % COOJA_CFS_SIZE)
+
+
+if __name__ == "__main__":
+    main()
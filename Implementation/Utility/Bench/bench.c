@@ -0,0 +1,69 @@
+#include "contiki.h"
+#include "sys/energest.h"
+#include "sys/ctimer.h"
+#include "sys/log.h"
+
+#include "bench.h"
+
+#define LOG_MODULE "App"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Interval between two reports of the energy counters
+#ifndef BENCH_CONF_REPORT_INTERVAL
+#define BENCH_REPORT_INTERVAL (60 * CLOCK_SECOND)
+#else
+#define BENCH_REPORT_INTERVAL BENCH_CONF_REPORT_INTERVAL
+#endif
+
+#ifndef ROOM_ID
+#define ROOM_ID 0
+#endif
+
+static struct ctimer report_timer;
+
+/**
+ * Returns the share of the time since the boot spent in a state, in
+ * thousandths.
+ */
+static unsigned long permille(energest_type_t type, uint64_t total) {
+
+    return total > 0 ? (unsigned long) (energest_type_time(type) * 1000 / total) : 0;
+}
+
+/**
+ * Logs the duty cycle of the CPU and of the radio in the format parsed by
+ * Simulation/benchmark.py.
+ */
+static void report(void *ptr) {
+
+    uint64_t total;
+
+    energest_flush();
+    total = ENERGEST_GET_TOTAL_TIME();
+
+    LOG_INFO("[Bench] energest room=%d node=%s cpu=%lu listen=%lu transmit=%lu\n",
+             ROOM_ID, BENCH_NODE, permille(ENERGEST_TYPE_CPU, total),
+             permille(ENERGEST_TYPE_LISTEN, total), permille(ENERGEST_TYPE_TRANSMIT, total));
+
+    ctimer_reset(&report_timer);
+}
+
+/**
+ * Starts the periodic reports of the energy counters. Must be called from
+ * the main process of the node.
+ */
+void bench_init(void) {
+
+    ctimer_set(&report_timer, BENCH_REPORT_INTERVAL, report, NULL);
+}
+
+/**
+ * Logs a stage of the control loop (sample, sent, parse, predict, notify,
+ * led); the simulation script adds the time of the log.
+ *
+ * @param stage The name of the stage.
+ */
+void bench_stage(const char *stage) {
+
+    LOG_INFO("[Bench] %s room=%d\n", stage, ROOM_ID);
+}
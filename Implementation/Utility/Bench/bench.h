@@ -0,0 +1,12 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Name of the firmware in the reports (set by the Makefile)
+#ifndef BENCH_NODE
+#define BENCH_NODE "node"
+#endif
+
+void bench_init(void);
+void bench_stage(const char *stage);
+
+#endif  // BENCH_H
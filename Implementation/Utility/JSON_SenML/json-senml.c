@@ -2,15 +2,91 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <locale.h>
 
 #ifndef COOJA
 #include <nrfx.h>
 #endif
 
 #include <stdint.h>
+// Configuration of the node (project-conf.h), sizing the scratch arena
+#include "contiki.h"
 #include "json-senml.h"
 
+#ifdef WATERMARK
+#include "watermark.h"
+#endif
+
+// Bounded writer of a JSON payload
+typedef struct {
+    char *pos;          // Next character to write (NULL to only count)
+    size_t remaining;   // Bytes left in the buffer
+    size_t length;      // Length of the payload, also past the end of the buffer
+    bool overflow;      // Set when the payload does not fit in the buffer
+} senml_builder_t;
+
+// Scratch arena shared by all the SenML encoders and decoders of the node.
+// Contiki processes are cooperative, so a single payload is built or parsed
+// at a time: the arena is acquired for the encoding or decoding of one
+// payload and released right after.
+static senml_payload_t scratch_payload;
+static senml_measurement_t scratch_measurements[SENML_ARENA_RECORDS];
+static char scratch_base_name[MAX_STRING_LEN];
+#if SENML_ARENA_STRING_RECORDS > 0
+static char scratch_names[SENML_ARENA_STRING_RECORDS][MAX_STRING_LEN];
+static char scratch_units[SENML_ARENA_STRING_RECORDS][MAX_STRING_LEN];
+#endif
+static bool scratch_in_use = false;
+
+
+/**
+ * Acquires the scratch arena for one payload. The records are cleared, the
+ * base name and the names and units of the first SENML_ARENA_STRING_RECORDS
+ * records point to the buffers of the arena, so that a payload can be parsed
+ * into it; an encoder may point them to its own strings instead.
+ *
+ * The arena must be released with senml_scratch_release() before doing
+ * anything that may build another payload (e.g. notifying the observers).
+ *
+ * @param num_measurements The number of records of the payload.
+ * @return The payload of the arena, or NULL if it is in use or too small.
+ */
+senml_payload_t *senml_scratch_acquire(int num_measurements) {
+
+    if (scratch_in_use || num_measurements < 1 || num_measurements > SENML_ARENA_RECORDS) {
+        return NULL;
+    }
+    scratch_in_use = true;
+
+    memset(scratch_measurements, 0, num_measurements * sizeof(senml_measurement_t));
+#if SENML_ARENA_STRING_RECORDS > 0
+    for (int i = 0; i < num_measurements && i < SENML_ARENA_STRING_RECORDS; i++) {
+        scratch_names[i][0] = '\0';
+        scratch_units[i][0] = '\0';
+        scratch_measurements[i].name = scratch_names[i];
+        scratch_measurements[i].unit = scratch_units[i];
+    }
+#endif
+    scratch_base_name[0] = '\0';
+
+    scratch_payload.base_name = scratch_base_name;
+    scratch_payload.base_time = 0;
+    scratch_payload.version = 1;
+    scratch_payload.measurements = scratch_measurements;
+    scratch_payload.num_measurements = num_measurements;
+
+    return &scratch_payload;
+}
+
+
+/**
+ * Releases the scratch arena, the payload returned by senml_scratch_acquire()
+ * must not be used anymore.
+ */
+void senml_scratch_release(void) {
+    scratch_in_use = false;
+}
+
+
 /**
  * Retrieves the MAC address of the node and formats it as a string.
  *
@@ -43,71 +119,179 @@ void get_mac_address(char *mac_str) {
 
 
 /**
- * Creates a SenML payload in JSON format.
+ * Initializes a builder writing into the given buffer. A builder without
+ * buffer (NULL, 0) only counts the length of the payload.
  *
- * @param buffer A buffer to hold the generated JSON string.
+ * @param builder The builder to initialize.
+ * @param buffer The buffer where the payload is written, or NULL.
  * @param buffer_size The size of the buffer.
- * @param payload A structure containing the SenML measurements and metadata.
- * @return The length of the generated JSON string or -1 on error.
  */
-int create_senml_payload(char *buffer, uint16_t buffer_size, senml_payload_t *payload)
-{
-    if (buffer == NULL || payload == NULL || payload->measurements == NULL || payload->num_measurements == 0) {
-        return -1;
+static void builder_init(senml_builder_t *builder, char *buffer, size_t buffer_size) {
+    builder->pos = buffer;
+    builder->remaining = buffer_size;
+    builder->length = 0;
+    builder->overflow = false;
+}
+
+/**
+ * Appends len characters to the payload. Once the buffer is full nothing
+ * else is written and the overflow flag is set, the length keeps counting.
+ */
+static void builder_append(senml_builder_t *builder, const char *str, size_t len) {
+    builder->length += len;
+    if (builder->pos == NULL || builder->overflow) {
+        return;
     }
+    // One byte is kept for the null terminator
+    if (len >= builder->remaining) {
+        builder->overflow = true;
+        return;
+    }
+    memcpy(builder->pos, str, len);
+    builder->pos += len;
+    builder->remaining -= len;
+    *builder->pos = '\0';
+}
 
-    // Save the current locale
-    char *current_locale = setlocale(LC_NUMERIC, NULL);
+static void builder_append_str(senml_builder_t *builder, const char *str) {
+    builder_append(builder, str, strlen(str));
+}
 
-    // Set the locale to "C" to use the dot as decimal separator
-    setlocale(LC_NUMERIC, "C");
+// Appends a string literal, its length is known at compile time
+#define builder_append_literal(builder, literal) \
+    builder_append((builder), (literal), sizeof(literal) - 1)
 
-    size_t offset = 0;
-    offset += snprintf(buffer + offset, buffer_size - offset, "{\"e\":[");
+static void builder_append_int(senml_builder_t *builder, int value) {
+    char digits[12];
+    int len = snprintf(digits, sizeof(digits), "%d", value);
+    builder_append(builder, digits, len);
+}
 
-    int temp = 0;
-    for (size_t i = 0; i < payload->num_measurements; ++i) {
-        const char *format = NULL;
+/**
+ * Writes the JSON representation of the payload with the builder.
+ *
+ * @return 0 on success or -1 if the payload contains an unknown record type.
+ */
+static int encode_senml_payload(senml_builder_t *builder, const senml_payload_t *payload) {
+
+    builder_append_literal(builder, "{\"e\":[");
+
+    for (int i = 0; i < payload->num_measurements; ++i) {
+        const senml_measurement_t *measurement = &payload->measurements[i];
+
+        builder_append_literal(builder, "{\"n\":\"");
+        builder_append_str(builder, measurement->name);
 
-        switch (payload->measurements[i].type) {
+        switch (measurement->type) {
             case SENML_TYPE_V:
-                temp =  (int) (payload->measurements[i].value.v * 100000);
-                format = "{\"n\":\"%s\",\"v\":%d,\"u\":\"%s\"}";
-                offset += snprintf(buffer + offset, buffer_size - offset, format,
-                                   payload->measurements[i].name, temp, payload->measurements[i].unit);
+                builder_append_literal(builder, "\",\"v\":");
+                builder_append_int(builder, (int) (measurement->value.v * 100000));
+                builder_append_literal(builder, ",\"u\":\"");
+                builder_append_str(builder, measurement->unit);
+                builder_append_literal(builder, "\"");
                 break;
             case SENML_TYPE_BV:
-                format = "{\"n\":\"%s\",\"bv\":%s}";
-                offset += snprintf(buffer + offset, buffer_size - offset, format,
-                                   payload->measurements[i].name, payload->measurements[i].value.bv ? "true" : "false");
+                builder_append_literal(builder, "\",\"bv\":");
+                if (measurement->value.bv) {
+                    builder_append_literal(builder, "true");
+                } else {
+                    builder_append_literal(builder, "false");
+                }
                 break;
             case SENML_TYPE_SV:
-                format = "{\"n\":\"%s\",\"sv\":\"%s\",\"u\":\"%s\"}";
-                offset += snprintf(buffer + offset, buffer_size - offset, format,
-                                   payload->measurements[i].name, payload->measurements[i].value.sv, payload->measurements[i].unit);
+                builder_append_literal(builder, "\",\"sv\":\"");
+                builder_append_str(builder, measurement->value.sv);
+                builder_append_literal(builder, "\",\"u\":\"");
+                builder_append_str(builder, measurement->unit);
+                builder_append_literal(builder, "\"");
                 break;
             default:
-                // Restore the original locale
-                setlocale(LC_NUMERIC, current_locale);
                 return -1;
         }
 
+        // The time of the record is omitted when it is the default (0)
+        if (measurement->time != 0) {
+            builder_append_literal(builder, ",\"t\":");
+            builder_append_int(builder, measurement->time);
+        }
+        builder_append_literal(builder, "}");
+
         if (i < payload->num_measurements - 1) {
-            offset += snprintf(buffer + offset, buffer_size - offset, ",");
+            builder_append_literal(builder, ",");
         }
     }
 
-    offset += snprintf(buffer + offset, buffer_size - offset, "],\"bn\":\"%s\",\"bt\":%d,\"ver\":%d}", 
-                       payload->base_name, payload->base_time, payload->version);
+    builder_append_literal(builder, "],\"bn\":\"");
+    builder_append_str(builder, payload->base_name);
+    builder_append_literal(builder, "\",\"bt\":");
+    builder_append_int(builder, payload->base_time);
+    builder_append_literal(builder, ",\"ver\":");
+    builder_append_int(builder, payload->version);
+    builder_append_literal(builder, "}");
 
-    // Restore the original locale
-    setlocale(LC_NUMERIC, current_locale);
-    
-    if (offset >= buffer_size) {
+    return 0;
+}
+
+
+/**
+ * Computes the exact length of the JSON representation of a SenML payload,
+ * without writing it.
+ *
+ * @param payload A structure containing the SenML measurements and metadata.
+ * @return The length of the JSON string (without the null terminator) or -1 on error.
+ */
+int senml_payload_length(const senml_payload_t *payload)
+{
+    senml_builder_t builder;
+
+    if (payload == NULL || payload->measurements == NULL || payload->num_measurements == 0) {
+        return -1;
+    }
+
+    builder_init(&builder, NULL, 0);
+    if (encode_senml_payload(&builder, payload) < 0) {
+        return -1;
+    }
+
+    return builder.length;
+}
+
+
+/**
+ * Creates a SenML payload in JSON format.
+ *
+ * The length of the payload is computed before writing it, so a payload
+ * larger than the buffer is rejected without writing past its end.
+ *
+ * @param buffer A buffer to hold the generated JSON string.
+ * @param buffer_size The size of the buffer.
+ * @param payload A structure containing the SenML measurements and metadata.
+ * @return The length of the generated JSON string or -1 on error.
+ */
+int create_senml_payload(char *buffer, uint16_t buffer_size, senml_payload_t *payload)
+{
+    senml_builder_t builder;
+
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    int length = senml_payload_length(payload);
+    if (length < 0 || length >= buffer_size) {
         return -1; // Error or buffer overflow
     }
 
-    return offset;
+    builder_init(&builder, buffer, buffer_size);
+    encode_senml_payload(&builder, payload);
+    if (builder.overflow) {
+        return -1;
+    }
+
+#ifdef WATERMARK
+    watermark_payload(builder.length);
+#endif
+
+    return builder.length;
 }
 
 
@@ -171,6 +355,11 @@ int parse_senml_payload(char *buffer, uint16_t buffer_size, senml_payload_t *pay
                     return -1;
                 }
                 senml_measurement_t *measurement = &payload->measurements[measurements_count];
+                if (measurement->name == NULL || measurement->unit == NULL) {
+                    // No room for the strings of the record
+                    printf("ERROR in parse_senml_payload: POSITION 13\n"); 
+                    return -1;
+                }
 
                 if (strncmp(pos, "{\"n\"", 4) == 0) {
                     pos += 5;
@@ -235,6 +424,10 @@ int parse_senml_payload(char *buffer, uint16_t buffer_size, senml_payload_t *pay
                         return -1;
                     }
                     *finish = '\0';
+                    if (measurement->value.sv == NULL) {
+                        printf("ERROR in parse_senml_payload: POSITION 14\n"); 
+                        return -1;
+                    }
                     strncpy(measurement->value.sv, start + 1, MAX_STRING_LEN - 1);
                     measurement->value.sv[MAX_STRING_LEN - 1] = '\0'; // Null-terminated string
                     pos = finish + 2;
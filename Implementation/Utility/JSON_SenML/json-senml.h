@@ -4,6 +4,21 @@
 #define BASE_NAME_LEN 32
 #define MAX_STRING_LEN 50
 
+// Records of the scratch arena shared by the SenML encoders and decoders
+#ifndef SENML_ARENA_CONF_RECORDS
+#define SENML_ARENA_RECORDS 2
+#else
+#define SENML_ARENA_RECORDS SENML_ARENA_CONF_RECORDS
+#endif
+
+// Records of the scratch arena with room for a decoded name and unit
+// (0 on the nodes that only encode payloads)
+#ifndef SENML_ARENA_CONF_STRING_RECORDS
+#define SENML_ARENA_STRING_RECORDS 2
+#else
+#define SENML_ARENA_STRING_RECORDS SENML_ARENA_CONF_STRING_RECORDS
+#endif
+
 
 typedef union {
     double v;       // Numeric value
@@ -22,6 +37,7 @@ typedef struct {
     char *unit;
     senml_value_t value;
     senml_value_type_t type;
+    int time;       // Time of the record (0 if not set)
 } senml_measurement_t;
 
 typedef struct {
@@ -32,6 +48,9 @@ typedef struct {
     int num_measurements;
 } senml_payload_t;
 
+senml_payload_t *senml_scratch_acquire(int num_measurements);
+void senml_scratch_release(void);
+int senml_payload_length(const senml_payload_t *payload);
 int create_senml_payload(char *buffer, uint16_t buffer_size, senml_payload_t *payload);
 void get_mac_address(char *mac_str);
 int parse_senml_payload(char *buffer, uint16_t buffer_size, senml_payload_t *payload);
@@ -1,7 +1,10 @@
 #ifndef RANDOM_NUMBER_GENERATOR_H
 #define RANDOM_NUMBER_GENERATOR_H
 
-double init_random_number(double min, double max);
-double generate_random_number(double min, double max, double old_value, double max_delta, bool hvac_status);
+#include <stdint.h>
 
-#endif  // RANDOM_NUMBER_GENERATOR_H
\ No newline at end of file
+void random_number_seed(uint32_t seed);
+uint32_t random_number_next(void);
+int32_t random_number_between(int32_t min, int32_t max);
+
+#endif  // RANDOM_NUMBER_GENERATOR_H
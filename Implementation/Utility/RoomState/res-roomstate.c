@@ -0,0 +1,42 @@
+#include "contiki.h"
+#include "coap-engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "sys/log.h"
+
+#define LOG_MODULE "App"
+#define LOG_LEVEL LOG_LEVEL_APP
+
+// Room state published by the VaultStatus on the multicast group, received
+// by the sensors built with MULTICAST=1
+
+static void res_put_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+RESOURCE(res_roomstate,
+         "title=\"VoltVault: \";rt=\"senml+json\";if=\"sensor\"",
+         NULL,
+         NULL,
+         res_put_handler,
+         NULL);
+
+
+extern void vaultstatus_update(const uint8_t *buffer, int buffer_size);
+
+
+static void
+res_put_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+    // Room state published by the VaultStatus on the multicast group
+    const uint8_t *payload = NULL;
+    int payload_len = coap_get_payload(request, &payload);
+
+    if (payload_len > 0) {
+        LOG_DBG("[RoomState] Room state received: %.*s\n", payload_len, (char *)payload);
+        vaultstatus_update(payload, payload_len);
+    }
+
+    // Responses to group requests are suppressed, otherwise every
+    // member of the group would answer to the VaultStatus
+    coap_status_code = MANUAL_RESPONSE;
+}
@@ -0,0 +1,137 @@
+#include "contiki.h"
+#include "sys/node-id.h"
+
+#include "random-number-generator.h"
+#include "sensor-model.h"
+
+#if SENSOR_MODEL_TRACE
+#include "sensor-trace.h"
+#endif
+
+// Ranges of the quantities, the same of the telemetry dataset
+#define MIN_TEMPERATURE 0                   // 0.0 Cel
+#define MAX_TEMPERATURE 3060000             // 30.6 Cel
+#define MIN_HUMIDITY 110000                 // 1.1 %RH
+#define MAX_HUMIDITY 9990000                // 99.9 %RH
+#define MIN_CO 117                          // 0.00117 ppm
+#define MAX_CO 1442                         // 0.01442 ppm
+
+// Values reached by the room without HVAC (equipment heat and outside air)
+#define AMBIENT_TEMPERATURE 2700000         // 27.0 Cel
+#define AMBIENT_HUMIDITY 6500000            // 65.0 %RH
+
+// Thermal inertia: every step the room closes 1/16 of the gap to the ambient
+#define INERTIA 16
+// Effect of the HVAC at full power in one step
+#define HVAC_COOLING 40000                  // -0.4 Cel
+#define HVAC_DEHUMIDIFICATION 80000         // -0.8 %RH
+// Percentage of the HVAC effect gained or lost in one step after a switch
+#define HVAC_RAMP 25
+
+// CO emitted by the equipment in one step, and fraction of the excess over
+// the background level removed by natural (1/64) and HVAC (1/8) ventilation
+#define CO_EMISSION 20
+#define CO_DECAY 64
+#define CO_VENTILATION 8
+
+// Noise of the readings in one step
+#define TEMPERATURE_NOISE 5000              // 0.05 Cel
+#define HUMIDITY_NOISE 20000                // 0.2 %RH
+#define CO_NOISE 2
+
+static int32_t
+clamp(int32_t value, int32_t min, int32_t max)
+{
+    return value < min ? min : (value > max ? max : value);
+}
+
+static int32_t
+noise(int32_t amplitude)
+{
+    return random_number_between(-amplitude, amplitude);
+}
+
+/**
+ * Initializes the model with random values within plausible ranges. The
+ * random generator is seeded with the node id, so a simulation always
+ * produces the same readings. With a trace, the model starts from its
+ * first sample and falls back to the simulated dynamics if it is missing.
+ *
+ * @param model The sensor model.
+ */
+void
+sensor_model_init(sensor_model_t *model)
+{
+    random_number_seed(SENSOR_MODEL_SEED ^ ((uint32_t) node_id * 2654435761u));
+
+    model->step = 0;
+    model->hvac_effect = 0;
+    model->temperature = random_number_between(1800000, 2800000);
+    model->humidity = random_number_between(3000000, 7000000);
+    model->co = random_number_between(200, 800);
+
+#if SENSOR_MODEL_TRACE
+    if(sensor_trace_open() == 0){
+        sensor_trace_next(&model->temperature, &model->humidity, &model->co);
+    }
+#endif
+}
+
+/**
+ * Advances the model of one step (one reading of the sensor).
+ *
+ * @param model The sensor model.
+ * @param hvac_status The status of the HVAC system (true if on, false if off).
+ */
+void
+sensor_model_step(sensor_model_t *model, bool hvac_status)
+{
+    model->step++;
+
+#if SENSOR_MODEL_TRACE
+    if(sensor_trace_next(&model->temperature, &model->humidity, &model->co) == 0){
+        return;
+    }
+#endif
+
+    // The HVAC does not act at once after a switch
+    model->hvac_effect = clamp(model->hvac_effect + (hvac_status ? HVAC_RAMP : -HVAC_RAMP), 0, 100);
+
+    // Temperature and humidity drift toward the ambient, pulled down by the HVAC
+    model->temperature += (AMBIENT_TEMPERATURE - model->temperature) / INERTIA
+                          - HVAC_COOLING * model->hvac_effect / 100
+                          + noise(TEMPERATURE_NOISE);
+    model->temperature = clamp(model->temperature, MIN_TEMPERATURE, MAX_TEMPERATURE);
+
+    model->humidity += (AMBIENT_HUMIDITY - model->humidity) / INERTIA
+                       - HVAC_DEHUMIDIFICATION * model->hvac_effect / 100
+                       + noise(HUMIDITY_NOISE);
+    model->humidity = clamp(model->humidity, MIN_HUMIDITY, MAX_HUMIDITY);
+
+    // CO accumulates until the HVAC ventilates the room
+    model->co += CO_EMISSION
+                 - (model->co - MIN_CO) / CO_DECAY
+                 - (model->co - MIN_CO) * model->hvac_effect / (CO_VENTILATION * 100)
+                 + noise(CO_NOISE);
+    model->co = clamp(model->co, MIN_CO, MAX_CO);
+}
+
+/**
+ * Returns the time until the next reading: the recorded one with a trace,
+ * the sample interval of the sensor otherwise.
+ *
+ * @param interval The sample interval of the sensor.
+ * @return The interval in clock ticks.
+ */
+clock_time_t
+sensor_model_interval(clock_time_t interval)
+{
+#if SENSOR_MODEL_TRACE
+    clock_time_t recorded = sensor_trace_interval();
+
+    if(recorded > 0){
+        return recorded;
+    }
+#endif
+    return interval;
+}
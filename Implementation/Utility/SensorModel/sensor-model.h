@@ -0,0 +1,40 @@
+#ifndef SENSOR_MODEL_H
+#define SENSOR_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "contiki.h"
+
+// Fixed-point scale of the simulated quantities (5 decimals, as in SenML)
+#define SENSOR_MODEL_SCALE 100000
+
+// Seed of the simulation, combined with the node id so that every node
+// replays its own sequence run after run
+#ifndef SENSOR_MODEL_CONF_SEED
+#define SENSOR_MODEL_SEED 0x5EED1234
+#else
+#define SENSOR_MODEL_SEED SENSOR_MODEL_CONF_SEED
+#endif
+
+// Replay of a recorded trace (make TRACE=1 or TRACE=cfs, see
+// Simulation/telemetry_trace.py) instead of the simulated dynamics
+#ifndef SENSOR_MODEL_CONF_TRACE
+#define SENSOR_MODEL_TRACE 0
+#else
+#define SENSOR_MODEL_TRACE SENSOR_MODEL_CONF_TRACE
+#endif
+
+typedef struct {
+    int32_t temperature;    // Temperature (Cel / SENSOR_MODEL_SCALE)
+    int32_t humidity;       // Relative humidity (%RH / SENSOR_MODEL_SCALE)
+    int32_t co;             // CO level (ppm / SENSOR_MODEL_SCALE)
+    int32_t hvac_effect;    // Effect of the HVAC on the room (0-100 %)
+    uint32_t step;          // Number of steps since the initialization
+} sensor_model_t;
+
+void sensor_model_init(sensor_model_t *model);
+void sensor_model_step(sensor_model_t *model, bool hvac_status);
+clock_time_t sensor_model_interval(clock_time_t interval);
+
+#endif  // SENSOR_MODEL_H
@@ -0,0 +1,264 @@
+#include "contiki.h"
+#include "sys/node-id.h"
+#include "sys/log.h"
+
+#include "sensor-model.h"
+
+// Built with the sensor model, compiled only for the replay of a trace
+// (make TRACE=1 or TRACE=cfs): the trace of TRACE=1 is generated
+#if SENSOR_MODEL_TRACE
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "sensor-trace.h"
+
+#if SENSOR_TRACE_CFS
+#include "cfs/cfs.h"
+#else
+// Generated by Simulation/telemetry_trace.py
+#include "sensor-trace-data.h"
+#endif
+
+#define LOG_MODULE "App"
+#define LOG_LEVEL LOG_LEVEL_APP
+
+/*
+ * Format of the trace (little endian), generated by Simulation/telemetry_trace.py:
+ *
+ *   "VVT1"                      magic
+ *   uint16 samples              number of samples
+ *   uint16 quantum[3]           resolution of temperature, humidity and CO
+ *                               (in units of 1e-5)
+ *   samples x {
+ *     varint interval           milliseconds until the next sample
+ *     zigzag varint delta[3]    variation of temperature, humidity and CO
+ *   }                           (in quanta, from 0 for the first sample)
+ */
+#define SENSOR_TRACE_MAGIC "VVT1"
+#define SENSOR_TRACE_HEADER_SIZE 12
+#define SENSOR_TRACE_QUANTITIES 3
+
+// State of the playback
+static bool trace_open;
+static uint16_t samples;
+static uint16_t next_sample;
+static uint16_t quantum[SENSOR_TRACE_QUANTITIES];
+static int32_t values[SENSOR_TRACE_QUANTITIES];
+static uint32_t interval_ms;
+
+#if SENSOR_TRACE_CFS
+// Bytes of the trace read from the CFS at once
+#define SENSOR_TRACE_BUFFER_SIZE 16
+
+static int fd = -1;
+static uint8_t buffer[SENSOR_TRACE_BUFFER_SIZE];
+static uint8_t buffer_length;
+static uint8_t buffer_position;
+
+static int
+read_byte(void)
+{
+    if(buffer_position == buffer_length){
+        int length = cfs_read(fd, buffer, sizeof(buffer));
+        if(length <= 0){
+            return -1;
+        }
+        buffer_length = length;
+        buffer_position = 0;
+    }
+    return buffer[buffer_position++];
+}
+
+static void
+seek(uint16_t offset)
+{
+    cfs_seek(fd, offset, CFS_SEEK_SET);
+    buffer_length = 0;
+    buffer_position = 0;
+}
+#else
+static uint16_t position;
+
+static int
+read_byte(void)
+{
+    if(position >= sizeof(sensor_trace_data)){
+        return -1;
+    }
+    return sensor_trace_data[position++];
+}
+
+static void
+seek(uint16_t offset)
+{
+    position = offset;
+}
+#endif
+
+/**
+ * Reads an unsigned LEB128 varint.
+ *
+ * @param value The decoded value.
+ * @return 0 on success, -1 if the trace is truncated.
+ */
+static int
+read_varint(uint32_t *value)
+{
+    *value = 0;
+    for(uint8_t shift = 0; shift < 35; shift += 7){
+        int byte = read_byte();
+        if(byte < 0){
+            return -1;
+        }
+        *value |= (uint32_t) (byte & 0x7F) << shift;
+        if((byte & 0x80) == 0){
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int
+read_uint16(uint16_t *value)
+{
+    int low = read_byte();
+    int high = read_byte();
+    if(low < 0 || high < 0){
+        return -1;
+    }
+    *value = (uint16_t) (low | (high << 8));
+    return 0;
+}
+
+/**
+ * Decodes the next sample and restarts from the first one at the end of
+ * the trace.
+ *
+ * @return 0 on success, -1 if the trace is truncated.
+ */
+static int
+read_sample(void)
+{
+    uint32_t delta;
+
+    if(next_sample == samples){
+        seek(SENSOR_TRACE_HEADER_SIZE);
+        memset(values, 0, sizeof(values));
+        next_sample = 0;
+    }
+
+    if(read_varint(&interval_ms) < 0){
+        return -1;
+    }
+    for(int i = 0; i < SENSOR_TRACE_QUANTITIES; i++){
+        if(read_varint(&delta) < 0){
+            return -1;
+        }
+        // Zigzag decoding
+        values[i] += (int32_t) (delta >> 1) ^ -(int32_t) (delta & 1);
+    }
+    next_sample++;
+    return 0;
+}
+
+/**
+ * Opens the trace and moves to the starting point of the node.
+ *
+ * @return 0 on success, -1 if the trace is missing or invalid.
+ */
+int
+sensor_trace_open(void)
+{
+    char magic[sizeof(SENSOR_TRACE_MAGIC) - 1] = { 0 };
+
+    trace_open = false;
+#if SENSOR_TRACE_CFS
+    if(fd >= 0){
+        cfs_close(fd);
+    }
+    fd = cfs_open(SENSOR_TRACE_FILE, CFS_READ);
+    if(fd < 0){
+        LOG_ERR("[SensorTrace] Unable to open %s\n", SENSOR_TRACE_FILE);
+        return -1;
+    }
+#endif
+    seek(0);
+
+    for(int i = 0; i < sizeof(magic); i++){
+        int byte = read_byte();
+        if(byte < 0){
+            break;
+        }
+        magic[i] = byte;
+    }
+    if(memcmp(magic, SENSOR_TRACE_MAGIC, sizeof(magic)) != 0 || read_uint16(&samples) < 0 || samples == 0){
+        LOG_ERR("[SensorTrace] Invalid trace\n");
+        return -1;
+    }
+    for(int i = 0; i < SENSOR_TRACE_QUANTITIES; i++){
+        if(read_uint16(&quantum[i]) < 0){
+            LOG_ERR("[SensorTrace] Invalid trace\n");
+            return -1;
+        }
+    }
+
+    // Starting point of the node
+    next_sample = samples;
+    for(uint16_t skip = ((uint32_t) node_id * SENSOR_TRACE_NODE_OFFSET) % samples; skip > 0; skip--){
+        if(read_sample() < 0){
+            LOG_ERR("[SensorTrace] Truncated trace\n");
+            return -1;
+        }
+    }
+
+    LOG_INFO("[SensorTrace] %u samples, replayed %ux faster\n", samples, SENSOR_TRACE_SPEEDUP);
+    trace_open = true;
+    return 0;
+}
+
+/**
+ * Reads the next sample of the trace.
+ *
+ * @param temperature The temperature (Cel / 1e5).
+ * @param humidity The relative humidity (%RH / 1e5).
+ * @param co The CO level (ppm / 1e5).
+ * @return 0 on success, -1 if the trace is not open or truncated.
+ */
+int
+sensor_trace_next(int32_t *temperature, int32_t *humidity, int32_t *co)
+{
+    if(!trace_open){
+        return -1;
+    }
+    if(read_sample() < 0){
+        LOG_ERR("[SensorTrace] Truncated trace\n");
+        trace_open = false;
+        return -1;
+    }
+
+    *temperature = values[0] * quantum[0];
+    *humidity = values[1] * quantum[1];
+    *co = values[2] * quantum[2];
+    return 0;
+}
+
+/**
+ * Returns the time until the next sample, as recorded and compressed by
+ * SENSOR_TRACE_SPEEDUP.
+ *
+ * @return The interval in clock ticks, 0 if the trace is not open.
+ */
+clock_time_t
+sensor_trace_interval(void)
+{
+    clock_time_t interval;
+
+    if(!trace_open){
+        return 0;
+    }
+    interval = (clock_time_t) ((uint64_t) interval_ms * CLOCK_SECOND / (1000UL * SENSOR_TRACE_SPEEDUP));
+    return interval > 0 ? interval : 1;
+}
+
+#endif /* SENSOR_MODEL_TRACE */
@@ -0,0 +1,44 @@
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <stdint.h>
+
+#include "contiki.h"
+
+// Read the trace from the CFS of the node (make TRACE=cfs, e.g. uploaded on
+// the Filesystem interface of a Cooja mote) instead of the flash of the
+// firmware (make TRACE=1)
+#ifndef SENSOR_TRACE_CONF_CFS
+#define SENSOR_TRACE_CFS 0
+#else
+#define SENSOR_TRACE_CFS SENSOR_TRACE_CONF_CFS
+#endif
+
+// Name of the trace in the CFS
+#ifndef SENSOR_TRACE_CONF_FILE
+#define SENSOR_TRACE_FILE "trace"
+#else
+#define SENSOR_TRACE_FILE SENSOR_TRACE_CONF_FILE
+#endif
+
+// Time compression of the playback (e.g. 100 replays the trace 100 times
+// faster than it was recorded, make SPEEDUP=<n>)
+#ifndef SENSOR_TRACE_CONF_SPEEDUP
+#define SENSOR_TRACE_SPEEDUP 1
+#else
+#define SENSOR_TRACE_SPEEDUP SENSOR_TRACE_CONF_SPEEDUP
+#endif
+
+// Samples between the starting points of two nodes, so that the sensors
+// of a room do not report the same values
+#ifndef SENSOR_TRACE_CONF_NODE_OFFSET
+#define SENSOR_TRACE_NODE_OFFSET 37
+#else
+#define SENSOR_TRACE_NODE_OFFSET SENSOR_TRACE_CONF_NODE_OFFSET
+#endif
+
+int sensor_trace_open(void);
+int sensor_trace_next(int32_t *temperature, int32_t *humidity, int32_t *co);
+clock_time_t sensor_trace_interval(void);
+
+#endif  // SENSOR_TRACE_H
@@ -0,0 +1,120 @@
+#include "contiki.h"
+#include "coap-engine.h"
+#include "coap-transactions.h"
+#include "coap-observe.h"
+#include "lib/list.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "sys/ctimer.h"
+#include "sys/log.h"
+
+#include <string.h>
+
+#include "watermark.h"
+
+#define LOG_MODULE "App"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Interval between two samples of the tables
+#define WATERMARK_SAMPLE_INTERVAL CLOCK_SECOND
+// Interval between two reports of the high-water marks
+#ifndef WATERMARK_CONF_REPORT_INTERVAL
+#define WATERMARK_REPORT_INTERVAL (60 * CLOCK_SECOND)
+#else
+#define WATERMARK_REPORT_INTERVAL WATERMARK_CONF_REPORT_INTERVAL
+#endif
+
+// High-water marks since the boot of the node
+static int max_payload;
+static int max_transactions;
+static int max_observers;
+static int max_neighbors;
+static int max_routes;
+
+static struct ctimer sample_timer;
+static clock_time_t last_report;
+
+/**
+ * Counts the open CoAP transactions. The pool of the engine is not exposed,
+ * so its free slots are taken until none is left and then released.
+ */
+static int count_transactions(void) {
+
+    coap_transaction_t *taken[COAP_MAX_OPEN_TRANSACTIONS];
+    coap_endpoint_t endpoint;
+    int free_slots = 0;
+
+    memset(&endpoint, 0, sizeof(endpoint));
+    while (free_slots < COAP_MAX_OPEN_TRANSACTIONS) {
+        taken[free_slots] = coap_new_transaction(coap_get_mid(), &endpoint);
+        if (taken[free_slots] == NULL) {
+            break;
+        }
+        free_slots++;
+    }
+    for (int i = 0; i < free_slots; i++) {
+        coap_clear_transaction(taken[i]);
+    }
+
+    return COAP_MAX_OPEN_TRANSACTIONS - free_slots;
+}
+
+/**
+ * Logs the high-water marks in the format parsed by Simulation/ram_profiles.py.
+ */
+static void report(void) {
+
+    LOG_INFO("[Watermark] node=%s payload=%d transactions=%d observers=%d neighbors=%d routes=%d\n",
+             WATERMARK_NODE, max_payload, max_transactions, max_observers, max_neighbors, max_routes);
+}
+
+static void sample(void *ptr) {
+
+    int value;
+
+    value = count_transactions();
+    if (value > max_transactions) {
+        max_transactions = value;
+    }
+    value = list_length(coap_get_observers());
+    if (value > max_observers) {
+        max_observers = value;
+    }
+    value = uip_ds6_nbr_num();
+    if (value > max_neighbors) {
+        max_neighbors = value;
+    }
+    value = uip_ds6_route_num_routes();
+    if (value > max_routes) {
+        max_routes = value;
+    }
+
+    if (clock_time() - last_report >= WATERMARK_REPORT_INTERVAL) {
+        last_report = clock_time();
+        report();
+    }
+
+    ctimer_reset(&sample_timer);
+}
+
+/**
+ * Starts sampling the CoAP transactions and observers, the neighbors and the
+ * routes of the node. Must be called from the main process of the node.
+ */
+void watermark_init(void) {
+
+    last_report = clock_time();
+    ctimer_set(&sample_timer, WATERMARK_SAMPLE_INTERVAL, sample, NULL);
+}
+
+/**
+ * Records the length of a SenML payload built by the node.
+ *
+ * @param length The length of the payload.
+ */
+void watermark_payload(int length) {
+
+    if (length > max_payload) {
+        max_payload = length;
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef WATERMARK_H
+#define WATERMARK_H
+
+// Name of the firmware in the reports (set by the Makefile)
+#ifndef WATERMARK_NODE
+#define WATERMARK_NODE "node"
+#endif
+
+void watermark_init(void);
+void watermark_payload(int length);
+
+#endif  // WATERMARK_H
@@ -47,7 +47,9 @@ else
     echo "Table iot_nodes does not exist. Creating it..."
     if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE iot_nodes (
         ip VARCHAR(50) PRIMARY KEY,
-        resource_exposed VARCHAR(255) NOT NULL
+        resource_exposed VARCHAR(255) NOT NULL,
+        room INT NOT NULL DEFAULT 0,
+        INDEX (resource_exposed, room)
     )" &>/dev/null; then
         echo "Error: Failed to create table iot_nodes"
         exit 1
@@ -57,50 +59,118 @@ fi
 
 echo ""
 
-if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM temphum_sensor LIMIT 1" &>/dev/null; then
-    echo "Table temphum_sensor does not exist. Creating it..."
-    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE temphum_sensor (
-        id INT AUTO_INCREMENT PRIMARY KEY,
-        temperature DOUBLE NOT NULL,
-        humidity DOUBLE NOT NULL,
-        timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-    )" &>/dev/null; then
-        echo "Error: Failed to create table temphum_sensor"
+# Add the room column to the tables created before the introduction of the rooms
+if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT room FROM iot_nodes LIMIT 1" &>/dev/null; then
+    echo "Adding column room to table iot_nodes..."
+    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "ALTER TABLE iot_nodes ADD COLUMN room INT NOT NULL DEFAULT 0" &>/dev/null; then
+        echo "Error: Failed to add column room to table iot_nodes"
         exit 1
     fi
-    echo "Table temphum_sensor created successfully"
+    echo "Column room added to table iot_nodes successfully"
     echo ""
 fi
 
-
-
-if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM co_sensor LIMIT 1" &>/dev/null; then
-    echo "Table co_sensor does not exist. Creating it..."
-    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE co_sensor (
-        id INT AUTO_INCREMENT PRIMARY KEY,
-        co DOUBLE NOT NULL,
-        timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-    )" &>/dev/null; then
-        echo "Error: Failed to create table co_sensor"
-        exit 1
+# Sensor tables: one row per notification keyed by node and time, partitioned by
+# month (the Java Application splits the partitions of the next months from pmax).
+# The tables created before the introduction of the nodes are kept as <table>_legacy
+create_sensor_table() {
+    TABLE=$1
+    COLUMNS=$2
+
+    if mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM $TABLE LIMIT 1" &>/dev/null \
+        && ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT node FROM $TABLE LIMIT 1" &>/dev/null; then
+        echo "Renaming table $TABLE to ${TABLE}_legacy..."
+        if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "RENAME TABLE $TABLE TO ${TABLE}_legacy" &>/dev/null; then
+            echo "Error: Failed to rename table $TABLE"
+            exit 1
+        fi
     fi
-    echo "Table co_sensor created successfully"
-    echo ""
-fi
-
 
+    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM $TABLE LIMIT 1" &>/dev/null; then
+        echo "Table $TABLE does not exist. Creating it..."
+        if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE $TABLE (
+            node VARCHAR(50) NOT NULL,
+            room INT NOT NULL DEFAULT 0,
+            timestamp DATETIME(3) NOT NULL,
+            $COLUMNS,
+            device VARCHAR(64) NULL,
+            device_time DOUBLE NULL,
+            device_timestamp DATETIME(3) NULL,
+            PRIMARY KEY (node, timestamp),
+            INDEX (timestamp)
+        ) PARTITION BY RANGE COLUMNS (timestamp) (
+            PARTITION pmax VALUES LESS THAN (MAXVALUE)
+        )" &>/dev/null; then
+            echo "Error: Failed to create table $TABLE"
+            exit 1
+        fi
+        echo "Table $TABLE created successfully"
+        echo ""
+    fi
 
-if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM hvac_actuator LIMIT 1" &>/dev/null; then
-    echo "Table hvac_actuator does not exist. Creating it..."
-    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE hvac_actuator (
-        id INT AUTO_INCREMENT PRIMARY KEY,
-        status BOOLEAN NOT NULL,
-        timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    # Address of the node and its uptime at the measurement (s), with the time of
+    # the collector it is aligned to, in the tables created before they were sent
+    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT device FROM $TABLE LIMIT 1" &>/dev/null; then
+        echo "Adding the device columns to table $TABLE..."
+        if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "ALTER TABLE $TABLE
+            ADD COLUMN device VARCHAR(64) NULL,
+            ADD COLUMN device_time DOUBLE NULL,
+            ADD COLUMN device_timestamp DATETIME(3) NULL" &>/dev/null; then
+            echo "Error: Failed to alter table $TABLE"
+            exit 1
+        fi
+        echo ""
+    fi
+}
+
+create_sensor_table temphum_sensor "temperature DOUBLE NOT NULL, humidity DOUBLE NOT NULL"
+create_sensor_table co_sensor "co DOUBLE NOT NULL"
+create_sensor_table hvac_actuator "status BOOLEAN NOT NULL"
+
+# Rollups of every measurement per minute and per hour, updated at every insert
+# (metric: temperature, humidity, co or hvac; average = sum / count)
+for TABLE in sensor_rollup_1m sensor_rollup_1h; do
+    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM $TABLE LIMIT 1" &>/dev/null; then
+        echo "Table $TABLE does not exist. Creating it..."
+        if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE $TABLE (
+            metric VARCHAR(32) NOT NULL,
+            bucket DATETIME NOT NULL,
+            node VARCHAR(50) NOT NULL,
+            room INT NOT NULL DEFAULT 0,
+            min DOUBLE NOT NULL,
+            max DOUBLE NOT NULL,
+            sum DOUBLE NOT NULL,
+            count INT NOT NULL,
+            PRIMARY KEY (metric, bucket, node)
+        )" &>/dev/null; then
+            echo "Error: Failed to create table $TABLE"
+            exit 1
+        fi
+        echo "Table $TABLE created successfully"
+        echo ""
+    fi
+done
+
+# Shadow predictions of the HVAC model run by the Java Application on the values
+# of every room (-Dshadow.library), with the status notified by the HVAC of the room
+if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "SELECT 1 FROM hvac_shadow LIMIT 1" &>/dev/null; then
+    echo "Table hvac_shadow does not exist. Creating it..."
+    if ! mysql -u"$DB_USER" -p"$DB_PASS" -h"$DB_HOST" "$DB_NAME" -e "CREATE TABLE hvac_shadow (
+        room INT NOT NULL,
+        timestamp DATETIME(3) NOT NULL,
+        temperature DOUBLE NOT NULL,
+        humidity DOUBLE NOT NULL,
+        co DOUBLE NOT NULL,
+        shadow_status BOOLEAN NOT NULL,
+        node_status BOOLEAN NULL,
+        disagreement BOOLEAN NULL,
+        PRIMARY KEY (room, timestamp),
+        INDEX (disagreement, timestamp)
     )" &>/dev/null; then
-        echo "Error: Failed to create table hvac_actuator"
+        echo "Error: Failed to create table hvac_shadow"
         exit 1
     fi
-    echo "Table hvac_actuator created successfully"
+    echo "Table hvac_shadow created successfully"
     echo ""
 fi
 